@@ -23,13 +23,23 @@ CREATE TABLE Version (
 -- change this row, you should also create a git tag. See the file
 -- comments for the procedure.
 INSERT INTO Version (id, creation) VALUES
-  (1, '2025-08-15 15:51:00');
+  (6, '2026-10-16 20:00:00');
 
 CREATE TABLE Log_File (
   id SERIAL,
   filename VARCHAR(512),
   creation_ts BIGINT NOT NULL, -- timestamp, ms past the epoch
   fully_parsed BOOL NOT NULL DEFAULT FALSE,
+  -- Checkpoint of a resumable ingest; see DbPopulator::checkpoint(). Ingest resumes with the line that starts at
+  -- resume_offset, just past line number resume_line.
+  resume_offset BIGINT NOT NULL DEFAULT 0,
+  resume_line INT NOT NULL DEFAULT 0,
+  resume_ts BIGINT, -- timestamp of the last log entry ingested, ms past the epoch
+  resume_area INT, -- Area row ID of the current area, if any
+  resume_combat INT, -- Combat row ID of the combat in progress, if any
+  -- Event and Combat rows of this logfile with larger IDs were written after the checkpoint.
+  resume_last_event BIGINT NOT NULL DEFAULT 0,
+  resume_last_combat INT NOT NULL DEFAULT 0,
   PRIMARY KEY (id)
 );
 
@@ -104,6 +114,22 @@ CREATE TABLE Actor (
   FOREIGN KEY (pc) REFERENCES Actor(id)
 );
 
+-- One row per actor, so concurrent populators can add actors with INSERT ... ON CONFLICT DO NOTHING. Each type has its
+-- own key.
+CREATE UNIQUE INDEX idx_actor_pc ON Actor(name, class) WHERE type = 'pc';
+CREATE UNIQUE INDEX idx_actor_npc ON Actor(name, instance) WHERE type = 'npc';
+CREATE UNIQUE INDEX idx_actor_companion ON Actor(name, pc, instance) WHERE type = 'companion';
+
+-- Which of each PC's Actor rows was current at a logfile's checkpoint. See Log_File.resume_*.
+CREATE TABLE Log_File_Pc (
+  logfile INT NOT NULL,
+  name_id DECIMAL(20,0) NOT NULL, -- Name.name_id of the PC
+  actor INT NOT NULL,
+  PRIMARY KEY (logfile, name_id),
+  FOREIGN KEY (logfile) REFERENCES Log_File(id) ON DELETE CASCADE,
+  FOREIGN KEY (actor) REFERENCES Actor(id)
+);
+
 CREATE TABLE Area (
   id SERIAL,
   area INT NOT NULL,
@@ -118,6 +144,10 @@ CREATE TABLE Area (
 INSERT INTO Area (area, difficulty) VALUES
   (5, 4);
 
+-- Combat, Event, and Combat_Summary are partitioned by logfile, one partition per logfile, so that replacing a logfile
+-- drops its partitions rather than deleting its rows. DbPopulator attaches a logfile's partitions, named
+-- <table>_lf_<logfile id>, when it adds the Log_File row. A partitioned table's keys must include the partition key, so
+-- Combat rows are referenced by (logfile, id); id alone is still unique.
 CREATE TABLE Combat (
   id SERIAL,
   -- timestamps (ts_*) are stored as ms past the epoch
@@ -125,10 +155,10 @@ CREATE TABLE Combat (
   ts_end BIGINT,
   area INT NOT NULL,
   logfile INT NOT NULL,
-  PRIMARY KEY (id),
+  PRIMARY KEY (logfile, id),
   FOREIGN KEY (area) REFERENCES Area(id),
   FOREIGN KEY (logfile) REFERENCES Log_File(id)
-);
+) PARTITION BY LIST (logfile);
 
 CREATE TYPE Location AS (
   x FLOAT,
@@ -150,11 +180,14 @@ CREATE TABLE Action (
   PRIMARY KEY (id),
   FOREIGN KEY (verb) REFERENCES Name(id),
   FOREIGN KEY (noun) REFERENCES Name(id),
-  FOREIGN KEY (detail) REFERENCES Name(id)
+  FOREIGN KEY (detail) REFERENCES Name(id),
+  UNIQUE (verb, noun, detail)
 );
 
+-- DbPopulator may reserve blocks of IDs from event_id_seq and assign them itself, so IDs have gaps and run out faster
+-- than the row count suggests.
 CREATE TABLE Event (
-  id SERIAL,
+  id BIGSERIAL,
   ts BIGINT NOT NULL, -- ms since epoch
   combat INT,
   source INT, 
@@ -176,8 +209,9 @@ CREATE TABLE Event (
   threat_val INT,
   threat_str VARCHAR(16),
   logfile INT NOT NULL,
-  PRIMARY KEY (id),
-  FOREIGN KEY (combat) REFERENCES Combat(id),
+  PRIMARY KEY (logfile, id),
+  FOREIGN KEY (logfile) REFERENCES Log_File(id),
+  FOREIGN KEY (logfile, combat) REFERENCES Combat(logfile, id),
   FOREIGN KEY (source) REFERENCES Actor(id),
   FOREIGN KEY (target) REFERENCES Actor(id),
   FOREIGN KEY (ability) REFERENCES Name(id),
@@ -185,4 +219,32 @@ CREATE TABLE Event (
   FOREIGN KEY (value_type) REFERENCES Name(id),
   FOREIGN KEY (value_mitigation_reason) REFERENCES Name(id),
   FOREIGN KEY (value_mitigation_effect_value_name) REFERENCES Name(id)
-);
+) PARTITION BY LIST (logfile);
+
+-- Per-combat totals of the Event rows that have a value or threat, one row per source, target, ability, action, and
+-- value type within a combat. The action's noun tells damage from healing. DbPopulator keeps these while it ingests
+-- and writes a combat's rows when the combat ends, so damage, healing, and threat by actor or ability can be read
+-- without scanning Event. Partitioned like Event.
+CREATE TABLE Combat_Summary (
+  logfile INT NOT NULL,
+  combat INT NOT NULL,
+  source INT,
+  target INT,
+  ability INT,
+  action INT NOT NULL,
+  value_type INT,
+  total BIGINT NOT NULL, -- sum of value_base
+  effective BIGINT NOT NULL, -- sum of value_effective, or of value_base where there's none
+  hits INT NOT NULL, -- Event rows with a value_base
+  crits INT NOT NULL,
+  max_hit BIGINT NOT NULL, -- largest value_base; 0 if no hits
+  threat BIGINT NOT NULL, -- sum of threat_val
+  UNIQUE NULLS NOT DISTINCT (logfile, combat, source, target, ability, action, value_type),
+  FOREIGN KEY (logfile) REFERENCES Log_File(id),
+  FOREIGN KEY (logfile, combat) REFERENCES Combat(logfile, id),
+  FOREIGN KEY (source) REFERENCES Actor(id),
+  FOREIGN KEY (target) REFERENCES Actor(id),
+  FOREIGN KEY (ability) REFERENCES Name(id),
+  FOREIGN KEY (action) REFERENCES Action(id),
+  FOREIGN KEY (value_type) REFERENCES Name(id)
+) PARTITION BY LIST (logfile);
@@ -0,0 +1,425 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <variant>
+
+#include "binary_log.hpp"
+#include "logging.hpp"
+#include "timestamps.hpp"
+
+namespace lpt = LogParserTypes;
+namespace blf = BinaryLogFormat;
+
+// Fixed-width fields are copied as they are in memory.
+static_assert(std::endian::native == std::endian::little, "The binary log format is little-endian");
+
+namespace {
+    auto put_varint(std::string& out, uint64_t v) -> void {
+        while (v >= 0x80) {
+            out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+    auto put_string(std::string& out, std::string_view s) -> void {
+        put_varint(out, s.size());
+        out.append(s);
+    }
+
+    template <typename T>
+    auto put_fixed(std::string& out, T v) -> void {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &v, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    // Timestamp deltas are usually small and positive, but a log can step backwards; zigzag keeps both short.
+    auto zigzag(int64_t v) -> uint64_t {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    auto unzigzag(uint64_t v) -> int64_t {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    auto hundredths(double v) -> int32_t {
+        return static_cast<int32_t>(std::lround(v * 100));
+    }
+} // namespace
+
+auto BinaryLogWriter::add(const lpt::ParsedLogLine& entry) -> void {
+    add(lpt::view_of(entry));
+}
+
+auto BinaryLogWriter::add(const lpt::ParsedLogLineView& entry) -> void {
+    const auto* rv = entry.value ? std::get_if<lpt::RealValueView>(&*entry.value) : nullptr;
+    const auto* me = rv && rv->mitigation_effect ? &*rv->mitigation_effect : nullptr;
+
+    uint16_t flags {};
+    flags |= entry.source ? blf::SOURCE : uint16_t {0};
+    flags |= entry.target ? blf::TARGET : uint16_t {0};
+    flags |= entry.ability ? blf::ABILITY : uint16_t {0};
+    flags |= entry.action.detail ? blf::DETAIL : uint16_t {0};
+    flags |= entry.value ? blf::VALUE : uint16_t {0};
+    if (rv != nullptr) {
+        flags |= blf::REAL_VALUE;
+        flags |= rv->crit ? blf::CRIT : uint16_t {0};
+        flags |= rv->effective ? blf::EFFECTIVE : uint16_t {0};
+        flags |= rv->type ? blf::VALUE_TYPE : uint16_t {0};
+        flags |= rv->mitigation_reason ? blf::MITIGATION_REASON : uint16_t {0};
+    }
+    if (me != nullptr) {
+        flags |= blf::MITIGATION_EFFECT;
+        flags |= me->value ? blf::MITIGATION_VALUE : uint16_t {0};
+        flags |= me->effect ? blf::MITIGATION_NAME : uint16_t {0};
+    }
+    if (entry.threat) {
+        flags |= blf::THREAT;
+        flags |= std::holds_alternative<double>(*entry.threat) ? blf::THREAT_NUMBER : uint16_t {0};
+    }
+    put_fixed(m_body, flags);
+
+    const auto ts_ms = Timestamps::timestamp_to_ms_past_epoch(entry.ts);
+    put_varint(m_body, zigzag(ts_ms - m_prev_ts_ms));
+    m_prev_ts_ms = ts_ms;
+
+    if (entry.source) {
+        put_source_or_target(*entry.source);
+    }
+    if (entry.target) {
+        put_source_or_target(*entry.target);
+    }
+    if (entry.ability) {
+        put_name(*entry.ability);
+    }
+    put_name(entry.action.verb);
+    put_name(entry.action.noun);
+    if (entry.action.detail) {
+        put_name(*entry.action.detail);
+    }
+
+    if (rv != nullptr) {
+        put_varint(m_body, rv->base_value);
+        if (rv->effective) {
+            put_varint(m_body, *rv->effective);
+        }
+        if (rv->type) {
+            put_name(*rv->type);
+        }
+        if (rv->mitigation_reason) {
+            put_name(*rv->mitigation_reason);
+        }
+        if (me != nullptr && me->value) {
+            put_varint(m_body, *me->value);
+        }
+        if (me != nullptr && me->effect) {
+            put_name(*me->effect);
+        }
+    } else if (entry.value) {
+        put_string(m_body, std::get<lpt::LogInfoValueView>(*entry.value).info);
+    }
+
+    if (entry.threat) {
+        if (const auto* t = std::get_if<double>(&*entry.threat)) {
+            put_fixed(m_body, *t);
+        } else {
+            put_string(m_body, std::get<std::string_view>(*entry.threat));
+        }
+    }
+    ++m_entries;
+}
+
+auto BinaryLogWriter::put_source_or_target(const lpt::SourceOrTargetView& st) -> void {
+    if (const auto* comp = std::get_if<lpt::CompanionActorView>(&st.actor)) {
+        put_fixed(m_body, blf::ActorType::COMPANION);
+        put_name(comp->pc);
+        put_name(comp->companion.name_id);
+        put_varint(m_body, comp->companion.instance);
+    } else if (const auto* npc = std::get_if<lpt::NpcActorView>(&st.actor)) {
+        put_fixed(m_body, blf::ActorType::NPC);
+        put_name(npc->name_id);
+        put_varint(m_body, npc->instance);
+    } else {
+        put_fixed(m_body, blf::ActorType::PC);
+        put_name(std::get<lpt::PcActorView>(st.actor));
+    }
+
+    put_fixed(m_body, hundredths(st.loc.x.val()));
+    put_fixed(m_body, hundredths(st.loc.y.val()));
+    put_fixed(m_body, hundredths(st.loc.z.val()));
+    put_fixed(m_body, hundredths(st.loc.rot.val()));
+    put_fixed(m_body, static_cast<uint32_t>(st.health.current.val()));
+    put_fixed(m_body, static_cast<uint32_t>(st.health.total.val()));
+}
+
+auto BinaryLogWriter::put_name(const lpt::NameIdView& name) -> void {
+    const auto index = static_cast<uint32_t>(m_names.size());
+    auto [it, inserted] = m_name_index.try_emplace(name.id, index);
+    if (!inserted && m_names[it->second].second != name.name) {
+        // The same ID under another name. Rare, but both must survive the round trip.
+        auto [other, other_inserted] = m_other_names.try_emplace(std::pair {name.id, std::string(name.name)}, index);
+        inserted = other_inserted;
+        put_varint(m_body, other->second);
+    } else {
+        put_varint(m_body, it->second);
+    }
+    if (inserted) {
+        m_names.emplace_back(name.id, name.name);
+    }
+}
+
+auto BinaryLogWriter::finish() const -> std::string {
+    std::string out;
+    out.append(blf::MAGIC);
+    put_fixed(out, blf::VERSION);
+    put_fixed(out, static_cast<uint64_t>(m_entries));
+    put_fixed(out, static_cast<uint32_t>(m_names.size()));
+    for (const auto& [id, name] : m_names) {
+        put_fixed(out, id);
+        put_string(out, name);
+    }
+    out.append(m_body);
+    return out;
+}
+
+auto BinaryLogWriter::save(const std::string& path) const -> bool {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    const auto data = finish();
+    if (!out.write(data.data(), static_cast<std::streamsize>(data.size())) || !out.flush()) {
+        BLT(error) << "Unable to write binary log " << std::quoted(path);
+        return false;
+    }
+    return true;
+}
+
+auto BinaryLogReader::open(const std::string& path) -> std::optional<BinaryLogReader> {
+    auto src = LogFileSource::open(path);
+    if (!src) {
+        return {};
+    }
+    // Moving the reader keeps the views valid: the contents are either mapped or in a buffer too long for the small
+    // string optimization to have kept it inline, since anything shorter fails read_header().
+    BinaryLogReader reader;
+    reader.m_src = std::move(src);
+    reader.m_data = reader.m_src->contents();
+    if (!reader.read_header()) {
+        BLT(error) << std::quoted(path) << " is not a binary log of format version " << blf::VERSION;
+        return {};
+    }
+    return reader;
+}
+
+auto BinaryLogReader::from_bytes(std::string_view data) -> std::optional<BinaryLogReader> {
+    BinaryLogReader reader;
+    reader.m_data = data;
+    if (!reader.read_header()) {
+        return {};
+    }
+    return reader;
+}
+
+auto BinaryLogReader::read_header() -> bool {
+    if (!is_binary_log(m_data)) {
+        return false;
+    }
+    m_pos = blf::MAGIC.size();
+
+    uint32_t version {};
+    uint64_t entries {};
+    uint32_t names {};
+    if (!get_fixed(version) || version != blf::VERSION || !get_fixed(entries) || !get_fixed(names)) {
+        return false;
+    }
+    m_entries = entries;
+
+    // Each name takes at least 9 bytes, which bounds the count a corrupt header can make us reserve.
+    if (names > (m_data.size() - m_pos) / 9) {
+        return false;
+    }
+    m_names.reserve(names);
+    for (uint32_t i = 0; i < names; i++) {
+        lpt::NameIdView name;
+        if (!get_fixed(name.id) || !get_string(name.name)) {
+            return false;
+        }
+        m_names.push_back(name);
+    }
+    return true;
+}
+
+auto BinaryLogReader::next() -> std::optional<lpt::ParsedLogLineView> {
+    if (m_failed || m_entries_read == m_entries) {
+        return {};
+    }
+
+    uint16_t flags {};
+    uint64_t ts_delta {};
+    if (!get_fixed(flags) || !get_varint(ts_delta)) {
+        return fail("timestamp");
+    }
+    m_prev_ts_ms += unzigzag(ts_delta);
+
+    lpt::ParsedLogLineView entry;
+    entry.ts = Timestamps::timestamp(std::chrono::milliseconds(m_prev_ts_ms));
+
+    if ((flags & blf::SOURCE) != 0 && !get_source_or_target(entry.source.emplace())) {
+        return fail("source");
+    }
+    if ((flags & blf::TARGET) != 0 && !get_source_or_target(entry.target.emplace())) {
+        return fail("target");
+    }
+    if ((flags & blf::ABILITY) != 0 && !get_name(entry.ability.emplace())) {
+        return fail("ability");
+    }
+    if (!get_name(entry.action.verb) || !get_name(entry.action.noun)
+        || ((flags & blf::DETAIL) != 0 && !get_name(entry.action.detail.emplace()))) {
+        return fail("action");
+    }
+
+    if ((flags & blf::REAL_VALUE) != 0) {
+        auto& rv = std::get<lpt::RealValueView>(entry.value.emplace(lpt::RealValueView {}));
+        rv.crit = (flags & blf::CRIT) != 0;
+        bool ok = get_varint(rv.base_value);
+        if (ok && (flags & blf::EFFECTIVE) != 0) {
+            ok = get_varint(rv.effective.emplace());
+        }
+        if (ok && (flags & blf::VALUE_TYPE) != 0) {
+            ok = get_name(rv.type.emplace());
+        }
+        if (ok && (flags & blf::MITIGATION_REASON) != 0) {
+            ok = get_name(rv.mitigation_reason.emplace());
+        }
+        if (ok && (flags & blf::MITIGATION_EFFECT) != 0) {
+            auto& me = rv.mitigation_effect.emplace();
+            if ((flags & blf::MITIGATION_VALUE) != 0) {
+                ok = get_varint(me.value.emplace());
+            }
+            if (ok && (flags & blf::MITIGATION_NAME) != 0) {
+                ok = get_name(me.effect.emplace());
+            }
+        }
+        if (!ok) {
+            return fail("value");
+        }
+    } else if ((flags & blf::VALUE) != 0) {
+        auto& info = std::get<lpt::LogInfoValueView>(entry.value.emplace(lpt::LogInfoValueView {}));
+        if (!get_string(info.info)) {
+            return fail("value");
+        }
+    }
+
+    if ((flags & blf::THREAT_NUMBER) != 0) {
+        double threat {};
+        if (!get_fixed(threat)) {
+            return fail("threat");
+        }
+        entry.threat = threat;
+    } else if ((flags & blf::THREAT) != 0) {
+        std::string_view threat;
+        if (!get_string(threat)) {
+            return fail("threat");
+        }
+        entry.threat = threat;
+    }
+
+    ++m_entries_read;
+    return entry;
+}
+
+auto BinaryLogReader::get_source_or_target(lpt::SourceOrTargetView& st) -> bool {
+    blf::ActorType type {};
+    if (!get_fixed(type)) {
+        return false;
+    }
+    switch (type) {
+    case blf::ActorType::PC: {
+        lpt::PcActorView pc;
+        if (!get_name(pc)) {
+            return false;
+        }
+        st.actor = pc;
+        break;
+    }
+    case blf::ActorType::NPC: {
+        lpt::NpcActorView npc;
+        if (!get_name(npc.name_id) || !get_varint(npc.instance)) {
+            return false;
+        }
+        st.actor = npc;
+        break;
+    }
+    case blf::ActorType::COMPANION: {
+        lpt::CompanionActorView comp;
+        if (!get_name(comp.pc) || !get_name(comp.companion.name_id) || !get_varint(comp.companion.instance)) {
+            return false;
+        }
+        st.actor = comp;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    int32_t x {}, y {}, z {}, rot {};
+    uint32_t current {}, total {};
+    if (!get_fixed(x) || !get_fixed(y) || !get_fixed(z) || !get_fixed(rot) || !get_fixed(current)
+        || !get_fixed(total)) {
+        return false;
+    }
+    st.loc = lpt::Location(lpt::Location::X(x / 100.0), lpt::Location::Y(y / 100.0), lpt::Location::Z(z / 100.0),
+                           lpt::Location::Rot(rot / 100.0));
+    st.health = lpt::Health(lpt::Health::Current(current), lpt::Health::Total(total));
+    return true;
+}
+
+auto BinaryLogReader::get_name(lpt::NameIdView& name) -> bool {
+    uint64_t index {};
+    if (!get_varint(index) || index >= m_names.size()) {
+        return false;
+    }
+    name = m_names[index];
+    return true;
+}
+
+auto BinaryLogReader::get_varint(uint64_t& v) -> bool {
+    v = 0;
+    for (int shift = 0; shift < 64 && m_pos < m_data.size(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(m_data[m_pos++]);
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto BinaryLogReader::get_string(std::string_view& s) -> bool {
+    uint64_t size {};
+    if (!get_varint(size) || size > m_data.size() - m_pos) {
+        return false;
+    }
+    s = m_data.substr(m_pos, size);
+    m_pos += size;
+    return true;
+}
+
+template <typename T>
+auto BinaryLogReader::get_fixed(T& v) -> bool {
+    if (m_data.size() - m_pos < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&v, m_data.data() + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return true;
+}
+
+auto BinaryLogReader::fail(std::string_view what) -> std::optional<lpt::ParsedLogLineView> {
+    BLT(error) << "Corrupt binary log: bad " << what << " in entry " << m_entries_read + 1 << " at offset " << m_pos;
+    m_failed = true;
+    return {};
+}
@@ -0,0 +1,183 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "log_file_source.hpp"
+#include "log_parser_types.hpp"
+
+/*
+ * A compact binary form of a parsed combat log
+ *
+ * Converting a log once with BinaryLogWriter and loading it with BinaryLogReader avoids parsing its text again. The
+ * file, all little-endian, is:
+ *
+ *   header      "SWTB", format version (u32), entry count (u64), name count (u32)
+ *   names       per name: log ID (u64), length (varint), bytes. Each (ID, name) pair is stored once.
+ *   entries     per entry:
+ *                 presence flags (u16), one bit per optional field; see BinaryLogFormat
+ *                 timestamp, ms since the previous entry's (zigzag varint; the first is since the epoch)
+ *                 source and target: actor, then location (4 x i32, hundredths) and health (2 x u32)
+ *                 ability, action verb, noun, and detail: name indexes (varint)
+ *                 value: base (varint), effective (varint), then the type, mitigation reason, and effect as name
+ *                   indexes and the effect value as a varint; or the info string of a LogInfoValue
+ *                 threat: f64, or the string
+ *
+ * An actor is its type (u8) followed by its name indexes and instance (varint). Strings other than names are a varint
+ * length and bytes. Absent fields take no space.
+ */
+namespace BinaryLogFormat {
+    inline constexpr std::string_view MAGIC {"SWTB"};
+    inline constexpr uint32_t VERSION {1};
+
+    // Bits of an entry's presence flags.
+    inline constexpr uint16_t SOURCE            {1 << 0};
+    inline constexpr uint16_t TARGET            {1 << 1};
+    inline constexpr uint16_t ABILITY           {1 << 2};
+    inline constexpr uint16_t DETAIL            {1 << 3};
+    inline constexpr uint16_t VALUE             {1 << 4};
+    inline constexpr uint16_t REAL_VALUE        {1 << 5}; // else a LogInfoValue
+    inline constexpr uint16_t EFFECTIVE         {1 << 6};
+    inline constexpr uint16_t VALUE_TYPE        {1 << 7};
+    inline constexpr uint16_t MITIGATION_REASON {1 << 8};
+    inline constexpr uint16_t MITIGATION_EFFECT {1 << 9};
+    inline constexpr uint16_t MITIGATION_VALUE  {1 << 10};
+    inline constexpr uint16_t MITIGATION_NAME   {1 << 11};
+    inline constexpr uint16_t THREAT            {1 << 12};
+    inline constexpr uint16_t THREAT_NUMBER     {1 << 13}; // else a string
+    inline constexpr uint16_t CRIT              {1 << 14};
+
+    enum class ActorType : uint8_t {
+        PC,
+        NPC,
+        COMPANION
+    };
+} // namespace BinaryLogFormat
+
+/**
+ * Converts parsed log entries into the binary log format
+ *
+ * Entries are encoded as they're added; the names they use are collected into the dictionary, which is written ahead
+ * of them by finish().
+ */
+class BinaryLogWriter {
+  public:
+    /**
+     * Encode the next entry of the log
+     *
+     * The strings are copied, so the view's line needn't outlive the call.
+     */
+    auto add(const LogParserTypes::ParsedLogLineView& entry) -> void;
+    auto add(const LogParserTypes::ParsedLogLine& entry) -> void;
+
+    auto size() const -> std::size_t {
+        return m_entries;
+    }
+
+    /**
+     * The whole file: header, names, and every entry added
+     */
+    auto finish() const -> std::string;
+
+    /**
+     * Write finish() to a file, replacing it
+     *
+     * @return false if the file can't be written. The error is logged.
+     */
+    auto save(const std::string& path) const -> bool;
+
+  private:
+    auto put_source_or_target(const LogParserTypes::SourceOrTargetView& st) -> void;
+    auto put_name(const LogParserTypes::NameIdView& name) -> void;
+
+    // Encoded entries.
+    std::string m_body;
+    std::size_t m_entries {};
+    int64_t m_prev_ts_ms {};
+
+    // The dictionary in index order. An ID's first name is found with m_name_index; names that differ from it are in
+    // m_other_names.
+    std::vector<std::pair<uint64_t, std::string>> m_names;
+    std::unordered_map<uint64_t, uint32_t> m_name_index;
+    std::map<std::pair<uint64_t, std::string>, uint32_t> m_other_names;
+};
+
+/**
+ * Loads a log written by BinaryLogWriter
+ *
+ * The file is memory mapped by a LogFileSource. Entries are decoded into ParsedLogLineView, whose names refer into the
+ * mapped dictionary, so loading an entry copies nothing. The views are valid for the lifetime of the reader.
+ */
+class BinaryLogReader {
+  public:
+    /**
+     * Open and map a binary log and read its header and names
+     *
+     * @return The reader, or an empty optional if the file can't be read or isn't a binary log of this version. The
+     *     error is logged.
+     */
+    static auto open(const std::string& path) -> std::optional<BinaryLogReader>;
+
+    /**
+     * Read a binary log that's already in memory, e.g. BinaryLogWriter::finish(); `data` must outlive the reader
+     */
+    static auto from_bytes(std::string_view data) -> std::optional<BinaryLogReader>;
+
+    /**
+     * Does the file start like a binary log?
+     */
+    static auto is_binary_log(std::string_view data) -> bool {
+        return data.starts_with(BinaryLogFormat::MAGIC);
+    }
+
+    /**
+     * Decode the next entry
+     *
+     * @return The entry, or empty after the last one or if the file is corrupt; failed() tells which.
+     */
+    auto next() -> std::optional<LogParserTypes::ParsedLogLineView>;
+
+    // Number of entries in the file.
+    auto size() const -> std::size_t {
+        return m_entries;
+    }
+
+    auto failed() const -> bool {
+        return m_failed;
+    }
+
+  private:
+    BinaryLogReader() = default;
+
+    auto read_header() -> bool;
+
+    auto get_varint(uint64_t& v) -> bool;
+    auto get_string(std::string_view& s) -> bool;
+    auto get_name(LogParserTypes::NameIdView& name) -> bool;
+    auto get_source_or_target(LogParserTypes::SourceOrTargetView& st) -> bool;
+
+    template <typename T>
+    auto get_fixed(T& v) -> bool;
+
+    auto fail(std::string_view what) -> std::optional<LogParserTypes::ParsedLogLineView>;
+
+    // Holds the mapping when the reader opened the file itself.
+    std::optional<LogFileSource> m_src;
+
+    std::string_view m_data;
+    std::size_t m_pos {};
+
+    std::vector<LogParserTypes::NameIdView> m_names;
+    std::size_t m_entries {};
+    std::size_t m_entries_read {};
+    int64_t m_prev_ts_ms {};
+    bool m_failed {false};
+};
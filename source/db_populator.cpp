@@ -1,12 +1,19 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cstdio>
 #include <filesystem>
 #include <format>
 #include <iostream>
 #include <memory>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wall"
@@ -32,13 +39,17 @@ auto ScopeRuns::enter() -> void {
 }
 
 auto ScopeRuns::exit() -> void {
-    m_num_calls++;
+    record(m_enter_time);
+}
+
+auto ScopeRuns::record(const timespec& enter_time) -> void {
     timespec exit_time;
     clock_gettime(CLOCK_MONOTONIC, &exit_time);
-    int64_t sec_diff = exit_time.tv_sec - m_enter_time.tv_sec;
-    int64_t ns_diff = exit_time.tv_nsec - m_enter_time.tv_nsec;
+    int64_t sec_diff = exit_time.tv_sec - enter_time.tv_sec;
+    int64_t ns_diff = exit_time.tv_nsec - enter_time.tv_nsec;
     int64_t time_in_func = sec_diff * 1000000000 + ns_diff;
-    m_total_time_in_func += time_in_func;
+    m_num_calls.fetch_add(1, std::memory_order_relaxed);
+    m_total_time_in_func.fetch_add(time_in_func, std::memory_order_relaxed);
 }
 
 ScopeRuns measure_add_name_id("DbPopulator::add_name_id");
@@ -47,19 +58,30 @@ ScopeRuns measure_add_action("DbPopulator::add_action");
 ScopeRuns measure_add_pc_actor("DbPopulator::add_pc_actor");
 ScopeRuns measure_add_npc_actor("DbPopulator::add_npc_actor");
 ScopeRuns measure_add_companion_actor("DbPopulator::add_companion_actor");
+ScopeRuns measure_prefetch_dimensions("DbPopulator::prefetch_dimensions");
 
-class MeasureScope {
-  public:
-    MeasureScope(ScopeRuns& sr)
-        : m_sr(sr) {
-        m_sr.enter();
-    }
-    ~MeasureScope() {
-        m_sr.exit();
+// The row ID from a query01<int>() result, in the form LocalDbCache::get() wants from its lookup step.
+auto first_column(const std::optional<std::tuple<int>>& row) -> std::optional<int> {
+    if (row) {
+        return std::get<0>(*row);
     }
+    return {};
+}
 
-    ScopeRuns& m_sr;
-};
+// Add a dimension row with an `INSERT ... ON CONFLICT DO NOTHING RETURNING id`. If another connection added the same
+// row first, nothing is returned, so find that row with `lookup` instead. The SELECT is a new statement and so sees the
+// other connection's committed row.
+template <typename Lookup>
+auto insert_or_lookup(pqxx::transaction_base& tx, const std::string& insert, const pqxx::params& params,
+                      Lookup&& lookup) -> int {
+    if (auto id = first_column(tx.query01<int>(insert, params))) {
+        return *id;
+    }
+    if (auto id = std::forward<Lookup>(lookup)()) {
+        return *id;
+    }
+    throw std::runtime_error("DbPopulator: Row conflicted on insert but then couldn't be found: " + insert);
+}
 
 template <typename T>
 auto append_or_null(pqxx::params& params, std::optional<T>& maybe_val) -> void {
@@ -82,19 +104,48 @@ auto append_or_null(pqxx::params& params, const std::optional<T>& maybe_val) ->
 DbPopulator::DbPopulator(const DbPopulator::ConnStr& conn_str,
                          const DbPopulator::LogfileFilename& logfile_filename,
                          Timestamps::timestamp logfile_ts,
-                         ExistingLogfileBehavior existing_logfile_behavior) {
+                         ExistingLogfileBehavior existing_logfile_behavior)
+    : DbPopulator(conn_str, logfile_filename, logfile_ts, existing_logfile_behavior, Options{}) {
+}
+
+DbPopulator::DbPopulator(const DbPopulator::ConnStr& conn_str,
+                         const DbPopulator::LogfileFilename& logfile_filename,
+                         Timestamps::timestamp logfile_ts,
+                         ExistingLogfileBehavior existing_logfile_behavior,
+                         const Options& options)
+    : m_options(options)
+    , m_names("Name", options.cache_capacity)
+    , m_classes("Advanced_Class", options.cache_capacity)
+    , m_actions("Action", options.cache_capacity)
+    , m_npcs("NPC Actor", options.cache_capacity)
+    , m_companions("Companion Actor", options.cache_capacity) {
+    m_pending_events.reserve(m_options.bulk_load_rows);
+
     BLT(info) << "DbPopulator: Connecting to database using conn_str: " << std::quoted(conn_str.cref());
     m_cx = std::make_unique<pqxx::connection>(conn_str.val());
     BLT(info) << "DbPopulator: Successfully connected to db: " << std::quoted(m_cx->dbname());
 
-    m_tx = std::make_unique<pqxx::nontransaction>(*m_cx);
+    if (m_options.batched_commits()) {
+        m_tx = std::make_unique<pqxx::work>(*m_cx);
+        m_autocommit_cx = std::make_unique<pqxx::connection>(conn_str.val());
+        m_autocommit_tx = std::make_unique<pqxx::nontransaction>(*m_autocommit_cx);
+    } else {
+        m_tx = std::make_unique<pqxx::nontransaction>(*m_cx);
+    }
+    m_tx_start = std::chrono::steady_clock::now();
 
-    m_db_version = m_tx->query_value<std::string>("SELECT id FROM Version");
+    // Replacing a logfile changes the schema, which mustn't wait on a transaction of our own.
+    auto& tx = autocommit_tx();
+    m_db_version = tx.query_value<std::string>("SELECT id FROM Version");
     BLT(info) << "DbPopulator: Database version: " << std::quoted(m_db_version);
+
+    if (m_options.warm_start) {
+        warm_start();
+    }
     
     const auto lfn = std::filesystem::path(logfile_filename.val()).filename().string();
-    auto logfile_id = m_tx->query01<int, bool>("SELECT id, fully_parsed FROM Log_File WHERE filename = $1",
-                                         pqxx::params(lfn));
+    auto logfile_id = tx.query01<int, bool>("SELECT id, fully_parsed FROM Log_File WHERE filename = $1",
+                                            pqxx::params(lfn));
     if (logfile_id) {
         auto lf_id = std::get<0>(*logfile_id);
         auto finished = std::get<1>(*logfile_id);
@@ -102,17 +153,19 @@ DbPopulator::DbPopulator(const DbPopulator::ConnStr& conn_str,
                      << ", fully_parsed=" << finished;
         auto always_delete = (existing_logfile_behavior == ExistingLogfileBehavior::DELETE_ON_EXISTING);
         auto delete_if_unfinished = (existing_logfile_behavior == ExistingLogfileBehavior::DELETE_ON_EXISTING_UNFINISHED);
+        if (existing_logfile_behavior == ExistingLogfileBehavior::RESUME_EXISTING) {
+            BLT(info) << "DbPopulator: Requested behavior is to resume.";
+            resume_logfile(lf_id);
+            return;
+        }
         if (always_delete || (delete_if_unfinished && !finished)) {
             BLT(info) << "DbPopulator: Requested behavior is to delete.";
 
-            BLT(info) << "DbPopulator: Deleting Event entries corresponding to existing logfile.";
-            m_tx->exec("DELETE FROM Event WHERE logfile = $1", pqxx::params(lf_id));
-
-            BLT(info) << "DbPopulator: Deleting Combats that came from existing logfile.";
-            m_tx->exec("DELETE FROM Combat WHERE logfile = $1", pqxx::params(lf_id));
+            BLT(info) << "DbPopulator: Dropping the Event and Combat partitions of the existing logfile.";
+            drop_partitions(lf_id);
 
             BLT(info) << "DbPopulator: Deleting duplicate Log_File entry.";
-            m_tx->exec("DELETE FROM Log_File WHERE id = $1", pqxx::params(lf_id));
+            tx.exec("DELETE FROM Log_File WHERE id = $1", pqxx::params(lf_id));
         } else {
             BLT(fatal) << "DbPopulator: Requested behavior is to throw if the existing logfile is not fully parsed.";
             throw duplicate_logfile{"DbPopulator: Duplicate logfile in database", finished};
@@ -124,44 +177,296 @@ DbPopulator::DbPopulator(const DbPopulator::ConnStr& conn_str,
     BLT(info) << "Add new Log_File entry to database.";
     m_parsing_finished = false;
     auto logfile_creation_ms = Timestamps::timestamp_to_ms_past_epoch(logfile_ts);
-    m_logfile_id = m_tx->query_value<int>("INSERT INTO Log_File (filename, creation_ts, fully_parsed) VALUES \
-                                             ($1, $2, $3) RETURNING id",
-                                          pqxx::params(/*1*/lfn, /*2*/logfile_creation_ms, /*3*/false));
+    m_logfile_id = tx.query_value<int>("INSERT INTO Log_File (filename, creation_ts, fully_parsed) VALUES \
+                                          ($1, $2, $3) RETURNING id",
+                                       pqxx::params(/*1*/lfn, /*2*/logfile_creation_ms, /*3*/false));
+    attach_partitions(m_logfile_id);
+}
+
+namespace {
+    // The partition of `table` holding the rows of one logfile.
+    auto partition_name(std::string_view table, int logfile_id) -> std::string {
+        return std::format("{}_lf_{}", table, logfile_id);
+    }
+
+    // Event and Combat_Summary rows reference Combat rows, so Combat partitions are attached first and dropped last.
+    constexpr std::array<std::string_view, 3> PARTITIONED_TABLES {"Combat", "Event", "Combat_Summary"};
+} // namespace
+
+auto DbPopulator::attach_partitions(int logfile_id) -> void {
+    // Attaching takes a lighter lock on the parent table than CREATE TABLE ... PARTITION OF would. The partition's
+    // foreign keys still lock Combat, Log_File, Actor, Name, Action, and Area against writes, so this waits until every
+    // other populator's open transaction commits, and their next writes wait behind it. With batched commits that can
+    // stall every --jobs worker for up to a batch per logfile started.
+    auto& tx = autocommit_tx();
+    for (const auto table : PARTITIONED_TABLES) {
+        const auto part = partition_name(table, logfile_id);
+        tx.exec(std::format("CREATE TABLE {} (LIKE {} INCLUDING DEFAULTS)", part, table));
+        tx.exec(std::format("ALTER TABLE {} ATTACH PARTITION {} FOR VALUES IN ({})", table, part, logfile_id));
+    }
+}
+
+auto DbPopulator::drop_partitions(int logfile_id) -> void {
+    // Detaching concurrently doesn't lock the parent table against writes, but it waits for every transaction open on
+    // the parent to finish, including other populators' batches. Either step may be missing if an earlier attempt was
+    // interrupted.
+    auto& tx = autocommit_tx();
+    for (auto table = PARTITIONED_TABLES.rbegin(); table != PARTITIONED_TABLES.rend(); ++table) {
+        const auto part = partition_name(*table, logfile_id);
+        const auto attached = tx.query_value<bool>("SELECT EXISTS (SELECT 1 FROM pg_inherits"
+                                                   " WHERE inhrelid = to_regclass($1) AND inhparent = to_regclass($2))",
+                                                   pqxx::params(part, *table));
+        if (attached) {
+            tx.exec(std::format("ALTER TABLE {} DETACH PARTITION {} CONCURRENTLY", *table, part));
+        }
+        tx.exec(std::format("DROP TABLE IF EXISTS {}", part));
+    }
+}
+
+auto DbPopulator::resume_logfile(int logfile_id) -> void {
+    m_logfile_id = logfile_id;
+    const pqxx::params lf_params(m_logfile_id);
+
+    const auto [offset, line_num, last_ts, area, combat, last_event, last_combat] =
+        m_tx->query1<int64_t, int, std::optional<int64_t>, std::optional<int>, std::optional<int>, int64_t, int>(
+            "SELECT resume_offset, resume_line, resume_ts, resume_area, resume_combat, resume_last_event,"
+            " resume_last_combat FROM Log_File WHERE id = $1", lf_params);
+    BLT(info) << "DbPopulator: Resuming logfile id=" << m_logfile_id << " at line " << line_num << ", offset "
+              << offset;
+
+    // Rows written after the checkpoint are about to be written again. That includes the totals of the combat in
+    // progress at the checkpoint, which are only written when it ends.
+    pqxx::params summary_params(m_logfile_id, last_combat);
+    append_or_null(summary_params, combat);
+    auto deleted = m_tx->exec("DELETE FROM Combat_Summary WHERE logfile = $1 AND (combat > $2 OR combat = $3)",
+                              summary_params).affected_rows();
+    deleted += m_tx->exec("DELETE FROM Event WHERE logfile = $1 AND id > $2",
+                          pqxx::params(m_logfile_id, last_event)).affected_rows();
+    deleted += m_tx->exec("DELETE FROM Combat WHERE logfile = $1 AND id > $2",
+                          pqxx::params(m_logfile_id, last_combat)).affected_rows();
+    if (deleted > 0) {
+        BLT(warning) << "DbPopulator: Deleted " << deleted << " Combat_Summary, Event, and Combat rows written after the"
+                     << " checkpoint.";
+    }
+    if (combat) {
+        m_tx->exec("UPDATE Combat SET ts_end = NULL WHERE (logfile, id) = ($1, $2)", pqxx::params(m_logfile_id, *combat));
+
+        // Recount the combat's totals from the Event rows it kept, the same way summarize_event() counts them.
+        for (auto [source, target, ability, action, value_type, total, effective, hits, crits, max_hit, threat] :
+                 m_tx->query<int, int, int, int, int, int64_t, int64_t, int, int, int64_t, int64_t>(
+                     "SELECT COALESCE(source, 0), COALESCE(target, 0), COALESCE(ability, 0), action,"
+                     "  COALESCE(value_type, 0),"
+                     "  COALESCE(SUM(value_base), 0)::BIGINT,"
+                     "  COALESCE(SUM(COALESCE(value_effective, value_base)), 0)::BIGINT,"
+                     "  COUNT(value_base)::INT, (COUNT(*) FILTER (WHERE value_base IS NOT NULL AND value_crit))::INT,"
+                     "  COALESCE(MAX(value_base), 0), COALESCE(SUM(threat_val), 0)::BIGINT"
+                     " FROM Event WHERE (logfile, combat) = ($1, $2)"
+                     "  AND (value_base IS NOT NULL OR threat_val IS NOT NULL)"
+                     " GROUP BY 1, 2, 3, 4, 5", pqxx::params(m_logfile_id, *combat))) {
+            m_combat_summary[{source, target, ability, action, value_type}] =
+                CombatSummary {.total = total, .effective = effective, .hits = hits, .crits = crits,
+                               .max_hit = max_hit, .threat = threat};
+        }
+    }
+    m_tx->exec("UPDATE Log_File SET fully_parsed = FALSE WHERE id = $1", lf_params);
+
+    m_area_id = area;
+    m_combat_id = combat;
+    for (auto [name_id, actor, class_id] : m_tx->query<uint64_t, int, int>(
+             "SELECT p.name_id, p.actor, a.class FROM Log_File_Pc AS p JOIN Actor AS a ON p.actor = a.id"
+             " WHERE p.logfile = $1", lf_params)) {
+        m_pcs.put(name_id, ActorRowInfo {.row_id = actor, .class_id = class_id});
+    }
+
+    m_resume_point = ResumePoint {
+        .offset = static_cast<uint64_t>(offset),
+        .line_num = line_num,
+        .last_ts = last_ts ? std::make_optional(Timestamps::timestamp(std::chrono::milliseconds(*last_ts)))
+                           : std::nullopt,
+    };
+}
+
+auto DbPopulator::checkpoint(const ResumePoint& rp) -> void {
+    flush_events();
+
+    std::vector<uint64_t> pc_names;
+    std::vector<int> pc_actors;
+    m_pcs.for_each_used([&] (uint64_t name_id, const ActorRowInfo& info) {
+        pc_names.push_back(name_id);
+        pc_actors.push_back(info.row_id);
+    });
+
+    pqxx::params params(m_logfile_id, pc_names, pc_actors, static_cast<int64_t>(rp.offset), rp.line_num);
+    std::optional<int64_t> last_ts_ms;
+    if (rp.last_ts) {
+        last_ts_ms = Timestamps::timestamp_to_ms_past_epoch(*rp.last_ts);
+    }
+    append_or_null(params, last_ts_ms);
+    append_or_null(params, m_area_id);
+    append_or_null(params, m_combat_id);
+
+    // One statement, so that it's atomic even when m_tx is a nontransaction.
+    m_tx->exec("WITH pcs AS ("
+               "  INSERT INTO Log_File_Pc (logfile, name_id, actor)"
+               "  SELECT $1, * FROM unnest($2::DECIMAL(20,0)[], $3::INT[])"
+               "  ON CONFLICT (logfile, name_id) DO UPDATE SET actor = EXCLUDED.actor)"
+               " UPDATE Log_File SET resume_offset = $4, resume_line = $5, resume_ts = $6, resume_area = $7,"
+               "  resume_combat = $8,"
+               "  resume_last_event = (SELECT COALESCE(MAX(id), 0) FROM Event WHERE logfile = $1),"
+               "  resume_last_combat = (SELECT COALESCE(MAX(id), 0) FROM Combat WHERE logfile = $1)"
+               " WHERE id = $1", params);
+    commit();
+    BLT(info) << "checkpoint: line " << rp.line_num << ", offset " << rp.offset << ", " << pc_names.size() << " PCs";
+}
+
+auto DbPopulator::commit() -> void {
+    const auto start = std::chrono::steady_clock::now();
+    flush_events();
+    if (!m_options.batched_commits()) {
+        return;
+    }
+
+    m_tx->commit();
+    // A connection can only have one transaction open, so the committed one must be gone before the next begins.
+    m_tx.reset();
+    m_tx = std::make_unique<pqxx::work>(*m_cx);
+
+    m_tx_start = std::chrono::steady_clock::now();
+    ++m_commit_stats.commits;
+    m_commit_stats.events += m_uncommitted_events;
+    m_commit_stats.duration += m_tx_start - start;
+    m_uncommitted_events = 0;
+    m_combat_ended = false;
+}
+
+auto DbPopulator::event_written() -> void {
+    if (!m_options.batched_commits()) {
+        return;
+    }
+    ++m_uncommitted_events;
+    const auto& opts = m_options;
+    if ((opts.commit_every_events > 0 && m_uncommitted_events >= opts.commit_every_events) ||
+        (opts.commit_every.count() > 0 && std::chrono::steady_clock::now() - m_tx_start >= opts.commit_every) ||
+        (opts.commit_at_combat_end && m_combat_ended)) {
+        commit();
+    }
+}
+
+auto DbPopulator::autocommit_tx() -> pqxx::transaction_base& {
+    return m_autocommit_tx ? *m_autocommit_tx : *m_tx;
+}
+
+auto DbPopulator::warm_start() -> void {
+    const auto start = std::chrono::steady_clock::now();
+    auto& loaded = m_warm_start_stats.rows_loaded;
+    auto& tx = autocommit_tx();
+
+    for (auto [name_id, id] : tx.stream<uint64_t, int>("SELECT name_id, id FROM Name")) {
+        m_names.preload(name_id, id);
+        ++loaded;
+    }
+
+    for (auto [style, advanced_class, id] : tx.stream<uint64_t, uint64_t, int>(
+             "SELECT s.name_id, c.name_id, ac.id FROM Advanced_Class AS ac"
+             "  JOIN Name AS s ON ac.style = s.id"
+             "  JOIN Name AS c ON ac.class = c.id")) {
+        m_classes.preload({style, advanced_class}, id);
+        ++loaded;
+    }
+
+    // add_action() keys a missing detail by the 'n/a' row ID. Duplicate actions can exist; like the SELECT in
+    // add_action(), prefer the oldest.
+    for (auto [verb, noun, detail, id] : tx.stream<uint64_t, uint64_t, uint64_t, int>(
+             "SELECT v.name_id, n.name_id, d.name_id, a.id FROM Action AS a"
+             "  JOIN Name AS v ON a.verb = v.id"
+             "  JOIN Name AS n ON a.noun = n.id"
+             "  JOIN Name AS d ON a.detail = d.id"
+             " ORDER BY a.id DESC")) {
+        m_actions.preload({verb, noun, detail == NOT_APPLICABLE_NAME_ID ? NOT_APPLICABLE_ROW_ID : detail}, id);
+        ++loaded;
+    }
+
+    for (auto [name_id, instance, id] : tx.stream<uint64_t, uint64_t, int>(
+             std::format("SELECT n.name_id, a.instance, a.id FROM Actor AS a JOIN Name AS n ON a.name = n.id"
+                         " WHERE a.type = {} ORDER BY a.id DESC", tx.quote(ACTOR_NPC_CLASS_TYPE_NAME)))) {
+        m_npcs.preload({name_id, instance}, id);
+        ++loaded;
+    }
+
+    // A PC seen for the first time in a logfile is given its "unknown" class row, as in add_pc_actor().
+    for (auto [name_id, id] : tx.stream<uint64_t, int>(
+             std::format("SELECT n.name_id, a.id FROM Actor AS a JOIN Name AS n ON a.name = n.id"
+                         " WHERE (a.type, a.class) = ({}, {}) ORDER BY a.id DESC",
+                         tx.quote(ACTOR_PC_CLASS_TYPE_NAME), UNKNOWN_CLASS_ROW_ID))) {
+        m_pcs.preload(name_id, ActorRowInfo {.row_id = id, .class_id = UNKNOWN_CLASS_ROW_ID});
+        ++loaded;
+    }
+
+    for (auto [name_id, pc, instance, id] : tx.stream<uint64_t, int, uint64_t, int>(
+             std::format("SELECT n.name_id, a.pc, a.instance, a.id FROM Actor AS a JOIN Name AS n ON a.name = n.id"
+                         " WHERE a.type = {} ORDER BY a.id DESC", tx.quote(ACTOR_COMPANION_CLASS_TYPE_NAME)))) {
+        m_companions.preload({name_id, pc, instance}, id);
+        ++loaded;
+    }
+
+    m_warm_start_stats.duration = std::chrono::steady_clock::now() - start;
+    BLT(info) << "DbPopulator: Warm start loaded " << loaded << " rows in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(m_warm_start_stats.duration).count() << " ms.";
+}
+
+auto DbPopulator::warm_start_stats() const -> WarmStartStats {
+    auto stats = m_warm_start_stats;
+    stats.lookups_saved = 0;
+    for (const auto& cache_stats : cache_stats()) {
+        stats.lookups_saved += cache_stats.preloaded_hits;
+    }
+    return stats;
+}
+
+auto DbPopulator::cache_stats() const -> std::vector<LocalDbCacheStats> {
+    return {m_names.stats(), m_classes.stats(), m_actions.stats(), m_npcs.stats(), m_pcs.stats(),
+            m_companions.stats()};
 }
 
 DbPopulator::~DbPopulator() {
-    // Nothing special to do here, just ensure destructor implementation has access to full definition of pqxx objects -
-    // we include pqxx in this file.
+    // The destructor implementation must have access to the full definition of pqxx objects - we include pqxx in this
+    // file. Don't lose buffered or uncommitted Event rows, but don't let a database error escape the destructor either.
+    try {
+        flush_events();
+        if (m_options.batched_commits()) {
+            m_tx->commit();
+        }
+    } catch (const std::exception& e) {
+        BLT(error) << "~DbPopulator: Failed to write " << m_pending_events.size() << " buffered and "
+                   << m_uncommitted_events << " uncommitted Event rows: " << e.what();
+    }
 }
 
 auto DbPopulator::mark_fully_parsed(void) -> void {
     BLT(info) << "mark_fully_parsed";
+    flush_events();
+    if (m_combat_id) {
+        write_combat_summary();
+    }
     m_tx->exec("UPDATE Log_File SET fully_parsed = TRUE WHERE id = $1", pqxx::params(m_logfile_id));
+    commit();
 }
 
-// A simple but inefficient implementation - see if the name_id is in the database and if not populate it.
+// Check the cache, then the database, and insert the name if it's in neither.
 auto DbPopulator::add_name_id(const lpt::NameId& name_id) -> int {
     MeasureScope meas(measure_add_name_id);
 
-    // Store a reference to the key's mapped value.
-    auto& row_id = m_names[name_id.id];
-    if (row_id != int{}) { // operator[] inserts a new key with default initialized value
-        // Name is in cache.
-        return row_id;
-    }
-
-    // name is not in cache. Is it in the database?
-    auto maybe_row_id = m_tx->query01<int>("SELECT id FROM Name WHERE name_id = $1", pqxx::params(name_id.id));
-    if (maybe_row_id) {
-        // Name is in database. Add to cache.
-        row_id = std::get<0>(*maybe_row_id);
-        return row_id;
-    }
-    
-    // Name isn't in database. Add to database and cache.
-    row_id = m_tx->query_value<int>("INSERT INTO Name (name_id, name) VALUES ($1, $2) RETURNING id",
-                                    pqxx::params(name_id.id, name_id.name));
-    return row_id;
+    auto lookup = [&] {
+        return first_column(autocommit_tx().query01<int>("SELECT id FROM Name WHERE name_id = $1", pqxx::params(name_id.id)));
+    };
+    return m_names.get(
+        name_id.id,
+        lookup,
+        [&] {
+            return insert_or_lookup(autocommit_tx(), "INSERT INTO Name (name_id, name) VALUES ($1, $2)"
+                                    " ON CONFLICT (name_id) DO NOTHING RETURNING id",
+                                    pqxx::params(name_id.id, name_id.name), lookup);
+        });
 }
 
 auto DbPopulator::add_pc_class(const DbPopulator::PcClass& pc_class) -> int {
@@ -171,45 +476,48 @@ auto DbPopulator::add_pc_class(const DbPopulator::PcClass& pc_class) -> int {
               << ", advanced_class.name=" << std::quoted(pc_class.advanced_class.cref().name);
 
     auto key = std::tuple<uint64_t,uint64_t>(pc_class.style.val().id, pc_class.advanced_class.val().id);
-    auto& row_id = m_classes[key];
-    if (row_id != int{}) {
-        return row_id;
-    }
-    pqxx::params params {/*1*/pc_class.style.val().id, /*2*/pc_class.advanced_class.val().id};
-    auto cid = m_tx->query01<int>("SELECT Advanced_Class.id FROM Advanced_Class \
-                                    JOIN Name AS n1 ON Advanced_Class.style = n1.id \
-                                    JOIN Name AS n2 ON Advanced_Class.class = n2.id \
-                                    WHERE (n1.name_id, n2.name_id) = ($1, $2)", params);
-    if (cid) {
-        row_id = std::get<0>(*cid);
-        return row_id;
-    }
-
-    auto style_id = add_name_id(pc_class.style.val());
-    auto advanced_class_id = add_name_id(pc_class.advanced_class.val());
-    row_id = m_tx->query_value<int>("INSERT INTO Advanced_Class (style, class) VALUES ($1, $2) RETURNING id",
-                                              pqxx::params{style_id, advanced_class_id});
-    return row_id;
+    auto lookup = [&] {
+        pqxx::params params {/*1*/pc_class.style.val().id, /*2*/pc_class.advanced_class.val().id};
+        return first_column(autocommit_tx().query01<int>("SELECT Advanced_Class.id FROM Advanced_Class \
+                                                 JOIN Name AS n1 ON Advanced_Class.style = n1.id \
+                                                 JOIN Name AS n2 ON Advanced_Class.class = n2.id \
+                                                 WHERE (n1.name_id, n2.name_id) = ($1, $2)", params));
+    };
+    return m_classes.get(
+        key,
+        lookup,
+        [&] {
+            auto style_id = add_name_id(pc_class.style.val());
+            auto advanced_class_id = add_name_id(pc_class.advanced_class.val());
+            return insert_or_lookup(autocommit_tx(), "INSERT INTO Advanced_Class (style, class) VALUES ($1, $2)"
+                                    " ON CONFLICT (style, class) DO NOTHING RETURNING id",
+                                    pqxx::params{style_id, advanced_class_id}, lookup);
+        });
 }
 
 auto DbPopulator::add_npc_actor(const lpt::NpcActor& npc_actor) -> int {
     MeasureScope meas(measure_add_npc_actor);
     auto key = std::tuple<uint64_t, uint64_t>(npc_actor.name_id.id, npc_actor.instance);
-    auto& row_id = m_npcs[key];
-    if (row_id != int{}) {
-        return row_id;
-    }
-
-    auto npc_name_id = add_name_id(npc_actor.name_id);
-
-    pqxx::params params {/*1*/"npc", /*2*/npc_name_id, /*3*/npc_actor.instance};
-    auto o_row_id = m_tx->query01<int>("SELECT id FROM Actor WHERE (type, name, instance) = ($1, $2, $3)", params);
-    if (o_row_id) {
-        row_id = std::get<0>(*o_row_id);
-        return row_id;
-    }
-    row_id = m_tx->query_value<int>("INSERT INTO Actor (type, name, instance) VALUES ($1, $2, $3) RETURNING id", params);
-    return row_id;
+    // The name's row ID is needed by both steps, so resolve it once on a miss.
+    std::optional<pqxx::params> params;
+    auto npc_params = [&] () -> const pqxx::params& {
+        if (!params) {
+            params.emplace(/*1*/"npc", /*2*/add_name_id(npc_actor.name_id), /*3*/npc_actor.instance);
+        }
+        return *params;
+    };
+    auto lookup = [&] {
+        return first_column(autocommit_tx().query01<int>("SELECT id FROM Actor WHERE (type, name, instance) = ($1, $2, $3)",
+                                               npc_params()));
+    };
+    return m_npcs.get(
+        key,
+        lookup,
+        [&] {
+            return insert_or_lookup(autocommit_tx(), "INSERT INTO Actor (type, name, instance) VALUES ($1, $2, $3)"
+                                    " ON CONFLICT (name, instance) WHERE type = 'npc' DO NOTHING RETURNING id",
+                                    npc_params(), lookup);
+        });
 }
 
 // Possible state on entry:
@@ -229,9 +537,9 @@ auto DbPopulator::add_pc_actor(const lpt::PcActor& pc_actor) -> int {
     MeasureScope meas(measure_add_pc_actor);
     BLT(info) << "add_pc_actor: pc_actor name.id = " << pc_actor.id;
 
-    if (m_pcs.contains(pc_actor.id)) {
+    if (const auto* cached = m_pcs.find(pc_actor.id)) {
         BLT(info) << "add_pc_actor: PC name_id found in m_pcs cache.";
-        return m_pcs[pc_actor.id].row_id;
+        return cached->row_id;
     }
     BLT(info) << "add_pc_actor: PC name_id not found in m_pcs cache.";
 
@@ -240,20 +548,24 @@ auto DbPopulator::add_pc_actor(const lpt::PcActor& pc_actor) -> int {
 
     auto params = pqxx::params(ACTOR_PC_CLASS_TYPE_NAME, name_row_id, UNKNOWN_CLASS_ROW_ID);
 
-    auto res = m_tx->query01<int>("SELECT id FROM Actor WHERE (type, name, class) = ($1, $2, $3)", params);
+    auto res = autocommit_tx().query01<int>("SELECT id FROM Actor WHERE (type, name, class) = ($1, $2, $3)", params);
     if (res) {
         auto actor_id = std::get<0>(*res); 
         BLT(info) << "add_pc_actor: Found row id=" << actor_id << " for PC matching name with unknown class."
                   << " Add m_pcs cache entry.";
-        m_pcs[pc_actor.id] = ActorRowInfo {.row_id = actor_id, .class_id = UNKNOWN_CLASS_ROW_ID};
+        m_pcs.put(pc_actor.id, ActorRowInfo {.row_id = actor_id, .class_id = UNKNOWN_CLASS_ROW_ID});
         return actor_id;
     }
     BLT(info) << "add_pc_actor: Did not find Actor row for PC name with 'unknown' class. Add new one.";
 
-    auto id = m_tx->query_value<int>("INSERT INTO Actor (type, name, class) VALUES ($1, $2, $3) RETURNING id",
-                                     params);
+    auto id = insert_or_lookup(autocommit_tx(), "INSERT INTO Actor (type, name, class) VALUES ($1, $2, $3)"
+                               " ON CONFLICT (name, class) WHERE type = 'pc' DO NOTHING RETURNING id",
+                               params, [&] {
+                                   return first_column(autocommit_tx().query01<int>(
+                                       "SELECT id FROM Actor WHERE (type, name, class) = ($1, $2, $3)", params));
+                               });
     BLT(info) << "add_pc_actor: New actor row id=" << id;
-    m_pcs[pc_actor.id] = ActorRowInfo {.row_id = id, .class_id = UNKNOWN_CLASS_ROW_ID};
+    m_pcs.put(pc_actor.id, ActorRowInfo {.row_id = id, .class_id = UNKNOWN_CLASS_ROW_ID});
     return id;
 }
 
@@ -264,28 +576,38 @@ auto DbPopulator::add_companion_actor(const lpt::CompanionActor& comp_actor) ->
     BLT(info) << "add_companion_actor: comp_name_row_id = " << comp_name_row_id
               << ", pc_actor_row_id = " << pc_actor_row_id;
 
+    auto key = std::tuple<uint64_t, int, uint64_t>(comp_actor.companion.name_id.id,
+                                                   pc_actor_row_id,
+                                                   comp_actor.companion.instance);
     pqxx::params params(DbPopulator::ACTOR_COMPANION_CLASS_TYPE_NAME,
                         comp_name_row_id,
                         pc_actor_row_id,
                         comp_actor.companion.instance);
-    auto maybe_comp_id = m_tx->query01<int>("SELECT id FROM Actor WHERE (type, name, pc, instance) = ($1, $2, $3, $4)",
-                                            params);
-    if (maybe_comp_id) {
-        auto comp_id = std::get<0>(*maybe_comp_id);
-        BLT(info) << "add_companion_actor: Row for companion actor found, id = " << comp_id;
-        return comp_id;
-    }
-    BLT(info) << "add_companion_actor: Row for companion actor not found";
-
-    BLT(info) << std::format("INSERT INTO Actor (type, name, pc, instance) VALUES ({}, {}, {}, {}) RETURNING id",
-                              DbPopulator::ACTOR_COMPANION_CLASS_TYPE_NAME,
-                              comp_name_row_id,
-                              pc_actor_row_id,
-                              comp_actor.companion.instance);
-    auto comp_row_id = m_tx->query_value<int>("INSERT INTO Actor (type, name, pc, instance) VALUES ($1, $2, $3, $4) \
-                                                   RETURNING id", params);
-    BLT(info) << "add_companion_actor: Insert new row for companion actor at id = " << comp_row_id;
-    return comp_row_id;
+    auto lookup = [&] () -> std::optional<int> {
+        auto maybe_comp_id = first_column(
+            autocommit_tx().query01<int>("SELECT id FROM Actor WHERE (type, name, pc, instance) = ($1, $2, $3, $4)", params));
+        if (maybe_comp_id) {
+            BLT(info) << "add_companion_actor: Row for companion actor found, id = " << *maybe_comp_id;
+        } else {
+            BLT(info) << "add_companion_actor: Row for companion actor not found";
+        }
+        return maybe_comp_id;
+    };
+    return m_companions.get(
+        key,
+        lookup,
+        [&] {
+            BLT(info) << std::format("INSERT INTO Actor (type, name, pc, instance) VALUES ({}, {}, {}, {}) RETURNING id",
+                                      DbPopulator::ACTOR_COMPANION_CLASS_TYPE_NAME,
+                                      comp_name_row_id,
+                                      pc_actor_row_id,
+                                      comp_actor.companion.instance);
+            auto comp_row_id = insert_or_lookup(autocommit_tx(), "INSERT INTO Actor (type, name, pc, instance) VALUES ($1, $2, $3, $4)"
+                                                " ON CONFLICT (name, pc, instance) WHERE type = 'companion'"
+                                                " DO NOTHING RETURNING id", params, lookup);
+            BLT(info) << "add_companion_actor: Insert new row for companion actor at id = " << comp_row_id;
+            return comp_row_id;
+        });
 }
 
 auto DbPopulator::add_class_to_pc_actor(const lpt::PcActor& pc_actor, const DbPopulator::PcClass& pc_class) -> int {
@@ -300,7 +622,7 @@ auto DbPopulator::add_class_to_pc_actor(const lpt::PcActor& pc_actor, const DbPo
     }
 
     // Get all PC Actors that have the same name as `pc_actor`.
-    auto rows = m_tx->exec("SELECT act.id, act.class FROM Actor AS act"
+    auto rows = autocommit_tx().exec("SELECT act.id, act.class FROM Actor AS act"
                            "  JOIN Name as actn ON act.name = actn.id"
                            " WHERE (type, actn.name_id) = ($1, $2)", pqxx::params(ACTOR_PC_CLASS_TYPE_NAME, pc_actor.id));
     std::map<int, int> m_class_to_actor;
@@ -310,50 +632,75 @@ auto DbPopulator::add_class_to_pc_actor(const lpt::PcActor& pc_actor, const DbPo
 
     if (m_class_to_actor.contains(class_id)) {
         // A row for `pc_actor` already exists with class `pc_class`. Use that row.
-        m_pcs[pc_actor.id] = ActorRowInfo {.row_id = m_class_to_actor[class_id], .class_id = class_id};
-        return m_pcs[pc_actor.id].row_id;
+        m_pcs.put(pc_actor.id, ActorRowInfo {.row_id = m_class_to_actor[class_id], .class_id = class_id});
+        return m_class_to_actor[class_id];
     }
 
     if (m_class_to_actor.contains(UNKNOWN_CLASS_ROW_ID)) {
         // A row for `pc_actor` with the "unknown" class exists. Update that row with `pc_class`.
         auto row_id = m_class_to_actor[UNKNOWN_CLASS_ROW_ID];
-        m_tx->exec("UPDATE Actor SET class = $1 WHERE id = $2",
-                   pqxx::params(class_id, row_id));
-        m_pcs[pc_actor.id] = ActorRowInfo {.row_id = row_id, .class_id = class_id};
+        try {
+            autocommit_tx().exec("UPDATE Actor SET class = $1 WHERE id = $2",
+                       pqxx::params(class_id, row_id));
+        } catch (const pqxx::unique_violation&) {
+            // Another connection gave this PC the class first. Use its row.
+            row_id = autocommit_tx().query_value<int>("SELECT act.id FROM Actor AS act"
+                                            "  JOIN Name AS actn ON act.name = actn.id"
+                                            " WHERE (type, actn.name_id, act.class) = ($1, $2, $3)",
+                                            pqxx::params(ACTOR_PC_CLASS_TYPE_NAME, pc_actor.id, class_id));
+        }
+        m_pcs.put(pc_actor.id, ActorRowInfo {.row_id = row_id, .class_id = class_id});
         return row_id;
     }
 
     // The database contains neither a row with the same `pc_class` nor a row with the "unknown" class. Add a new row
     // for our `pc_actor`/`pc_class` combination.
-    auto actor_name_id = m_tx->query_value<int>("SELECT id FROM Name WHERE name_id = $1", pqxx::params(pc_actor.id));
-    auto row_id = m_tx->query_value<int>("INSERT INTO Actor (type, name, class) VALUES ($1, $2, $3) RETURNING id",
-                                         pqxx::params(ACTOR_PC_CLASS_TYPE_NAME, actor_name_id, class_id));
-    m_pcs[pc_actor.id] = ActorRowInfo {.row_id = row_id, .class_id = class_id};
+    auto actor_name_id = autocommit_tx().query_value<int>("SELECT id FROM Name WHERE name_id = $1", pqxx::params(pc_actor.id));
+    pqxx::params params(ACTOR_PC_CLASS_TYPE_NAME, actor_name_id, class_id);
+    auto row_id = insert_or_lookup(autocommit_tx(), "INSERT INTO Actor (type, name, class) VALUES ($1, $2, $3)"
+                                   " ON CONFLICT (name, class) WHERE type = 'pc' DO NOTHING RETURNING id",
+                                   params, [&] {
+                                       return first_column(autocommit_tx().query01<int>(
+                                           "SELECT id FROM Actor WHERE (type, name, class) = ($1, $2, $3)", params));
+                                   });
+    m_pcs.put(pc_actor.id, ActorRowInfo {.row_id = row_id, .class_id = class_id});
     return row_id;
 }
 
-auto DbPopulator::add_action(const lpt::Action& action) -> int {
-    MeasureScope meas(measure_add_action);
-    auto key = std::tuple<uint64_t, uint64_t, uint64_t>(action.verb.cref().id,
-                                                        action.noun.cref().id,
-                                                        action.detail.cref() ? action.detail.cref()->id : NOT_APPLICABLE_ROW_ID);
-    auto& row_id = m_actions[key];
-    if (row_id != int{}) {
-        return row_id;
-    }
-    auto verb_row_id = add_name_id(action.verb);
-    auto noun_row_id = add_name_id(action.noun);
-    auto detail_row_id = action.detail.cref() ? add_name_id(*action.detail.cref()) : NOT_APPLICABLE_ROW_ID;
-    pqxx::params params(verb_row_id, noun_row_id, detail_row_id);
-
-    auto maybe_action = m_tx->query01<int>("SELECT id FROM Action WHERE (verb, noun, detail) = ($1, $2, $3)", params);
-    if (maybe_action) {
-        row_id = std::get<0>(*maybe_action);
-        return row_id;
+namespace {
+    // Key of an action in DbPopulator::m_actions.
+    auto action_cache_key(const lpt::Action& action) -> std::tuple<uint64_t, uint64_t, uint64_t> {
+        return {action.verb.cref().id,
+                action.noun.cref().id,
+                action.detail.cref() ? action.detail.cref()->id : DbPopulator::NOT_APPLICABLE_ROW_ID};
     }
+} // namespace
 
-    row_id = m_tx->query_value<int>("INSERT INTO Action (verb, noun, detail) VALUES ($1, $2, $3) RETURNING id", params);
-    return row_id;
+auto DbPopulator::add_action(const lpt::Action& action) -> int {
+    MeasureScope meas(measure_add_action);
+    auto key = action_cache_key(action);
+    std::optional<pqxx::params> params;
+    auto action_params = [&] () -> const pqxx::params& {
+        if (!params) {
+            auto verb_row_id = add_name_id(action.verb.cref());
+            auto noun_row_id = add_name_id(action.noun.cref());
+            auto detail_row_id = action.detail.cref() ? add_name_id(*action.detail.cref()) : NOT_APPLICABLE_ROW_ID;
+            params.emplace(verb_row_id, noun_row_id, detail_row_id);
+        }
+        return *params;
+    };
+    auto lookup = [&] {
+        return first_column(autocommit_tx().query01<int>("SELECT id FROM Action WHERE (verb, noun, detail) = ($1, $2, $3)",
+                                               action_params()));
+    };
+    return m_actions.get(
+        key,
+        lookup,
+        [&] {
+            return insert_or_lookup(autocommit_tx(), "INSERT INTO Action (verb, noun, detail) VALUES ($1, $2, $3)"
+                                    " ON CONFLICT (verb, noun, detail) DO NOTHING RETURNING id",
+                                    action_params(), lookup);
+        });
 }
 
 auto DbPopulator::add_actor(const lpt::Actor& actor) -> int {
@@ -376,21 +723,27 @@ auto DbPopulator::record_area_entered(DbPopulator::AreaName area, std::optional<
     auto difficulty_id = difficulty ? add_name_id(*difficulty) : DIFFICULTY_NONE_ROW_ID;
     BLT(info) << "record_area_entered: area.name=" << std::quoted(area.cref().name);
 
-    auto row_id = m_tx->query01<int>("SELECT id FROM Area WHERE (area, difficulty) = ($1, $2)",
-                                     pqxx::params(area_id, difficulty_id));
-    if (row_id) {
-        m_area_id = std::get<0>(*row_id);
+    pqxx::params params(area_id, difficulty_id);
+    auto lookup = [&] {
+        return first_column(autocommit_tx().query01<int>("SELECT id FROM Area WHERE (area, difficulty) = ($1, $2)", params));
+    };
+    if (auto row_id = lookup()) {
+        m_area_id = *row_id;
         return *m_area_id;
     }
-    pqxx::params params(area_id, difficulty_id);
 
-    m_area_id = m_tx->query_value<int>("INSERT INTO Area (area, difficulty) VALUES ($1, $2) RETURNING id", params);
+    m_area_id = insert_or_lookup(autocommit_tx(), "INSERT INTO Area (area, difficulty) VALUES ($1, $2)"
+                                 " ON CONFLICT (area, difficulty) DO NOTHING RETURNING id", params, lookup);
     return *m_area_id;
 }
 
 auto DbPopulator::record_enter_combat(const Timestamps::timestamp& combat_begin) -> int {
     const auto begin_ms = Timestamps::timestamp_to_ms_past_epoch(combat_begin);
     BLT(info) << "record_enter_combat: ts=" << begin_ms;
+    if (m_combat_id) {
+        BLT(warning) << "record_enter_combat: Combat id=" << *m_combat_id << " never ended. Writing its totals.";
+        write_combat_summary();
+    }
     m_combat_id = m_tx->query_value<int>("INSERT INTO Combat (ts_begin, area, logfile) VALUES ($1, $2, $3) RETURNING id",
                                          pqxx::params(begin_ms, *m_area_id, m_logfile_id));
     return *m_combat_id;
@@ -403,75 +756,297 @@ auto DbPopulator::record_exit_combat(const Timestamps::timestamp& combat_end) ->
     }
     const auto end_ms = Timestamps::timestamp_to_ms_past_epoch(combat_end);
     BLT(info) << "record_exit_combat: ts=" << end_ms;
-    m_tx->exec("UPDATE Combat SET ts_end = $1 WHERE id = $2", pqxx::params(end_ms, *m_combat_id));
+    m_tx->exec("UPDATE Combat SET ts_end = $1 WHERE (logfile, id) = ($2, $3)",
+               pqxx::params(end_ms, m_logfile_id, *m_combat_id));
+    write_combat_summary();
     auto ret = *m_combat_id;
     m_combat_id.reset();
+    m_combat_ended = true;
     return ret;
 }
 
 
-auto DbPopulator::populate_from_entry(const lpt::ParsedLogLine& entry) -> int {
-    pqxx::params params;
+namespace {
+    // Has the key been resolved to a row ID? Checked without counting as a cache lookup.
+    template <typename Cache, typename Key>
+    auto is_cached(const Cache& cache, const Key& key) -> bool {
+        const auto* row_id = cache.peek(key);
+        return row_id && *row_id != int{};
+    }
+} // namespace
+
+auto DbPopulator::prefetch_dimensions(std::span<const lpt::ParsedLogLine> entries) -> void {
+    MeasureScope meas(measure_prefetch_dimensions);
+
+    // Uncached keys, in the order the add_*() methods would have encountered them. The first name seen for a name ID
+    // is the one stored, just as it would be by add_name_id().
+    std::vector<uint64_t> name_ids;
+    std::vector<std::string> names;
+    std::set<uint64_t> seen_names;
+    auto want_name = [&] (const lpt::NameId& name_id) {
+        if (!is_cached(m_names, name_id.id) && seen_names.insert(name_id.id).second) {
+            name_ids.push_back(name_id.id);
+            names.push_back(name_id.name);
+        }
+    };
+
+    // Actions are keyed in SQL by the name IDs of their parts. A missing detail is the 'n/a' Name.
+    std::vector<std::tuple<uint64_t, uint64_t, uint64_t>> action_keys;
+    std::vector<uint64_t> action_verbs, action_nouns, action_details;
+    std::set<std::tuple<uint64_t, uint64_t, uint64_t>> seen_actions;
+
+    std::vector<std::tuple<uint64_t, uint64_t>> npc_keys;
+    std::vector<uint64_t> npc_names, npc_instances;
+    std::set<std::tuple<uint64_t, uint64_t>> seen_npcs;
+
+    std::vector<uint64_t> pc_names;
+    std::set<uint64_t> seen_pcs;
+    auto want_pc = [&] (const lpt::PcActor& pc) {
+        want_name(pc);
+        if (!m_pcs.contains(pc.id) && seen_pcs.insert(pc.id).second) {
+            pc_names.push_back(pc.id);
+        }
+    };
+
+    auto want_actor = [&] (const lpt::Actor& actor) {
+        if (std::holds_alternative<lpt::NpcActor>(actor)) {
+            const auto& npc = std::get<lpt::NpcActor>(actor);
+            want_name(npc.name_id);
+            auto key = std::tuple<uint64_t, uint64_t>(npc.name_id.id, npc.instance);
+            if (!is_cached(m_npcs, key) && seen_npcs.insert(key).second) {
+                npc_keys.push_back(key);
+                npc_names.push_back(npc.name_id.id);
+                npc_instances.push_back(npc.instance);
+            }
+        } else if (std::holds_alternative<lpt::PcActor>(actor)) {
+            want_pc(std::get<lpt::PcActor>(actor));
+        } else if (std::holds_alternative<lpt::CompanionActor>(actor)) {
+            const auto& comp = std::get<lpt::CompanionActor>(actor);
+            want_name(comp.companion.name_id);
+            want_pc(comp.pc);
+        }
+    };
+
+    for (const auto& entry : entries) {
+        if (entry.source) {
+            want_actor(entry.source->actor);
+        }
+        if (entry.target) {
+            want_actor(entry.target->actor);
+        }
+        if (entry.ability) {
+            want_name(*entry.ability);
+        }
+
+        const auto& action = entry.action;
+        want_name(action.verb.cref());
+        want_name(action.noun.cref());
+        if (action.detail.cref()) {
+            want_name(*action.detail.cref());
+        }
+        auto action_key = action_cache_key(action);
+        if (!is_cached(m_actions, action_key) && seen_actions.insert(action_key).second) {
+            action_keys.push_back(action_key);
+            action_verbs.push_back(action.verb.cref().id);
+            action_nouns.push_back(action.noun.cref().id);
+            action_details.push_back(action.detail.cref() ? action.detail.cref()->id : NOT_APPLICABLE_NAME_ID);
+        }
+
+        if (entry.value && std::holds_alternative<lpt::RealValue>(*entry.value)) {
+            const auto& v = std::get<lpt::RealValue>(*entry.value);
+            if (v.type) {
+                want_name(*v.type);
+            }
+            if (v.mitigation_reason) {
+                want_name(*v.mitigation_reason);
+            }
+            if (v.mitigation_effect && v.mitigation_effect->effect) {
+                want_name(*v.mitigation_effect->effect);
+            }
+        }
+    }
+
+    BLT(info) << "prefetch_dimensions: " << entries.size() << " entries reference " << name_ids.size() << " names, "
+              << action_keys.size() << " actions, " << npc_keys.size() << " NPCs, and " << pc_names.size()
+              << " PCs that aren't cached.";
+
+    // pqxx::pipeline doesn't take parameters, so keys are passed as quoted array literals and matched back to the keys
+    // above by their ordinality. The statements run in order on the server, so each one sees the rows inserted by the
+    // ones before it.
+    auto& tx = autocommit_tx();
+    const auto pc_type = tx.quote(ACTOR_PC_CLASS_TYPE_NAME);
+    const auto npc_type = tx.quote(ACTOR_NPC_CLASS_TYPE_NAME);
+    pqxx::pipeline pipe(tx);
+    std::optional<pqxx::pipeline::query_id> names_q, actions_q, npcs_q, pcs_q;
+
+    if (!name_ids.empty()) {
+        const auto ids = tx.quote(name_ids);
+        pipe.insert(std::format("INSERT INTO Name (name_id, name)"
+                                " SELECT k.name_id, k.name FROM unnest({}::DECIMAL(20,0)[], {}::VARCHAR[]) AS k(name_id, name)"
+                                " ON CONFLICT (name_id) DO NOTHING",
+                                ids, tx.quote(names)));
+        names_q = pipe.insert(std::format("SELECT k.ord, n.id FROM unnest({}::DECIMAL(20,0)[]) WITH ORDINALITY AS k(name_id, ord)"
+                                          " JOIN Name AS n ON n.name_id = k.name_id",
+                                          ids));
+    }
+
+    if (!action_keys.empty()) {
+        const auto keys = std::format("unnest({}::DECIMAL(20,0)[], {}::DECIMAL(20,0)[], {}::DECIMAL(20,0)[])"
+                                      " WITH ORDINALITY AS k(verb, noun, detail, ord)"
+                                      " JOIN Name AS v ON v.name_id = k.verb"
+                                      " JOIN Name AS n ON n.name_id = k.noun"
+                                      " JOIN Name AS d ON d.name_id = k.detail",
+                                      tx.quote(action_verbs), tx.quote(action_nouns), tx.quote(action_details));
+        pipe.insert(std::format("INSERT INTO Action (verb, noun, detail) SELECT v.id, n.id, d.id FROM {}"
+                                " ON CONFLICT (verb, noun, detail) DO NOTHING",
+                                keys));
+        actions_q = pipe.insert(std::format("SELECT DISTINCT ON (k.ord) k.ord, a.id FROM {}"
+                                            " JOIN Action AS a ON (a.verb, a.noun, a.detail) = (v.id, n.id, d.id)"
+                                            " ORDER BY k.ord, a.id",
+                                            keys));
+    }
+
+    if (!npc_keys.empty()) {
+        const auto keys = std::format("unnest({}::DECIMAL(20,0)[], {}::DECIMAL(20,0)[]) WITH ORDINALITY AS k(name_id, instance, ord)"
+                                      " JOIN Name AS n ON n.name_id = k.name_id",
+                                      tx.quote(npc_names), tx.quote(npc_instances));
+        pipe.insert(std::format("INSERT INTO Actor (type, name, instance) SELECT {}, n.id, k.instance FROM {}"
+                                " ON CONFLICT (name, instance) WHERE type = 'npc' DO NOTHING",
+                                npc_type, keys));
+        npcs_q = pipe.insert(std::format("SELECT DISTINCT ON (k.ord) k.ord, a.id FROM {}"
+                                         " JOIN Actor AS a ON (a.type, a.name, a.instance) = ({}, n.id, k.instance)"
+                                         " ORDER BY k.ord, a.id",
+                                         keys, npc_type));
+    }
+
+    if (!pc_names.empty()) {
+        // A PC that isn't in m_pcs is given the Actor row with the "unknown" class, exactly as add_pc_actor() does.
+        const auto keys = std::format("unnest({}::DECIMAL(20,0)[]) WITH ORDINALITY AS k(name_id, ord)"
+                                      " JOIN Name AS n ON n.name_id = k.name_id",
+                                      tx.quote(pc_names));
+        pipe.insert(std::format("INSERT INTO Actor (type, name, class) SELECT {}, n.id, {} FROM {}"
+                                " ON CONFLICT (name, class) WHERE type = 'pc' DO NOTHING",
+                                pc_type, UNKNOWN_CLASS_ROW_ID, keys));
+        pcs_q = pipe.insert(std::format("SELECT DISTINCT ON (k.ord) k.ord, a.id FROM {}"
+                                        " JOIN Actor AS a ON (a.type, a.name, a.class) = ({}, n.id, {})"
+                                        " ORDER BY k.ord, a.id",
+                                        keys, pc_type, UNKNOWN_CLASS_ROW_ID));
+    }
+
+    // ord is 1-based.
+    if (names_q) {
+        for (auto row : pipe.retrieve(*names_q)) {
+            auto [ord, id] = row.as<std::size_t, int>();
+            m_names.put(name_ids.at(ord - 1), id);
+        }
+    }
+    if (actions_q) {
+        for (auto row : pipe.retrieve(*actions_q)) {
+            auto [ord, id] = row.as<std::size_t, int>();
+            m_actions.put(action_keys.at(ord - 1), id);
+        }
+    }
+    if (npcs_q) {
+        for (auto row : pipe.retrieve(*npcs_q)) {
+            auto [ord, id] = row.as<std::size_t, int>();
+            m_npcs.put(npc_keys.at(ord - 1), id);
+        }
+    }
+    if (pcs_q) {
+        for (auto row : pipe.retrieve(*pcs_q)) {
+            auto [ord, id] = row.as<std::size_t, int>();
+            m_pcs.put(pc_names.at(ord - 1), ActorRowInfo {.row_id = id, .class_id = UNKNOWN_CLASS_ROW_ID});
+        }
+    }
+    pipe.complete();
+
+    // Companions are keyed by the Actor row of their owning PC, which is only known now.
+    std::vector<std::tuple<uint64_t, int, uint64_t>> comp_keys;
+    std::vector<uint64_t> comp_names, comp_instances;
+    std::vector<int> comp_pcs;
+    std::set<std::tuple<uint64_t, int, uint64_t>> seen_comps;
+    auto want_comp = [&] (const std::optional<lpt::SourceOrTarget>& st) {
+        if (!st || !std::holds_alternative<lpt::CompanionActor>(st->actor)) {
+            return;
+        }
+        const auto& comp = std::get<lpt::CompanionActor>(st->actor);
+        const auto* pc = m_pcs.peek(comp.pc.id);
+        if (!pc) {
+            return;
+        }
+        auto key = std::tuple<uint64_t, int, uint64_t>(comp.companion.name_id.id, pc->row_id,
+                                                       comp.companion.instance);
+        if (!is_cached(m_companions, key) && seen_comps.insert(key).second) {
+            comp_keys.push_back(key);
+            comp_names.push_back(comp.companion.name_id.id);
+            comp_pcs.push_back(pc->row_id);
+            comp_instances.push_back(comp.companion.instance);
+        }
+    };
+    for (const auto& entry : entries) {
+        want_comp(entry.source);
+        want_comp(entry.target);
+    }
+    if (comp_keys.empty()) {
+        return;
+    }
 
-    // 1 - timestamp
-    // 2 - combat
-    // 3 - source actor
-    // 4 - source_location
-    // 5 - source_health
-    // 6 - target actor
-    // 7 - target_location
-    // 8 - target_health
+    const auto comp_type = tx.quote(ACTOR_COMPANION_CLASS_TYPE_NAME);
+    const auto keys = std::format("unnest({}::DECIMAL(20,0)[], {}::INT[], {}::DECIMAL(20,0)[])"
+                                  " WITH ORDINALITY AS k(name_id, pc, instance, ord)"
+                                  " JOIN Name AS n ON n.name_id = k.name_id",
+                                  tx.quote(comp_names), tx.quote(comp_pcs), tx.quote(comp_instances));
+    pqxx::pipeline comp_pipe(tx);
+    comp_pipe.insert(std::format("INSERT INTO Actor (type, name, pc, instance) SELECT {}, n.id, k.pc, k.instance FROM {}"
+                                 " ON CONFLICT (name, pc, instance) WHERE type = 'companion' DO NOTHING",
+                                 comp_type, keys));
+    auto comps_q = comp_pipe.insert(std::format("SELECT DISTINCT ON (k.ord) k.ord, a.id FROM {}"
+                                                " JOIN Actor AS a ON (a.type, a.name, a.pc, a.instance) = ({}, n.id, k.pc, k.instance)"
+                                                " ORDER BY k.ord, a.id",
+                                                keys, comp_type));
+    for (auto row : comp_pipe.retrieve(comps_q)) {
+        auto [ord, id] = row.as<std::size_t, int>();
+        m_companions.put(comp_keys.at(ord - 1), id);
+    }
+    comp_pipe.complete();
+}
 
-    // Fill in event row in the order of the SQL declaration. We'll pass in everything, so we'll set NULLs for fields we
-    // don't have.
-    params.append(/*1*/Timestamps::timestamp_to_ms_past_epoch(entry.ts));
+auto DbPopulator::make_event_row(const lpt::ParsedLogLine& entry) -> EventRow {
+    EventRow row;
+
+    // Fill in event row in the order of the SQL declaration. Fields we don't have are left as NULLs.
+    if (m_options.event_id_block > 0) {
+        row.id = next_event_id();
+    }
+    row.ts = Timestamps::timestamp_to_ms_past_epoch(entry.ts);
 
     // These actions have handling that must occur before we can populate the event values. Specifically, if this is
     // event enters combat, we need to know the ID of the current Combat row.
-    if (entry.action.noun.cref().id == ENTER_COMBAT_ID) {
+    if (entry.action.noun.cref().id == LogParserTypes::ENTER_COMBAT_ID) {
         record_enter_combat(entry.ts);
-    } else if (entry.action.noun.cref().id == EXIT_COMBAT_ID) {
+    } else if (entry.action.noun.cref().id == LogParserTypes::EXIT_COMBAT_ID) {
         record_exit_combat(entry.ts);
     }
 
-    std::optional<int> src_actor_id {};
+    row.combat = m_combat_id;
 
-    append_or_null(params, /*2*/m_combat_id);
-
-    int source_pc_actor_row_id {};
     if (entry.source) {
-        source_pc_actor_row_id = add_actor(entry.source->actor);
-        params.append(/*3*/source_pc_actor_row_id);
-        params.append(/*4*/entry.source->loc);
-        params.append(/*5*/entry.source->health);
-    } else {
-        params.append(/*3*/);
-        params.append(/*4*/);
-        params.append(/*5*/);
+        row.source = add_actor(entry.source->actor);
+        row.source_location = entry.source->loc;
+        row.source_health = entry.source->health;
     }
 
     if (entry.target) {
-        params.append(/*6*/add_actor(entry.target->actor));
-        params.append(/*7*/entry.target->loc);
-        params.append(/*8*/entry.target->health);
-    } else {
-        params.append(/*6*/);
-        params.append(/*7*/);
-        params.append(/*8*/);
+        row.target = add_actor(entry.target->actor);
+        row.target_location = entry.target->loc;
+        row.target_health = entry.target->health;
     }
-        
-    // 9 - ability
-    // 10- action
 
-    int ability_row_id {};
     if (entry.ability) {
-        ability_row_id = add_name_id(*entry.ability);
-        params.append(/*9*/ability_row_id);
-    } else {
-        params.append(/*9*/);
+        row.ability = add_name_id(*entry.ability);
     }
 
-    params.append(/*10*/add_action(entry.action));
+    row.action = add_action(entry.action);
 
     // Handle special cases which require tables other than Event to be updated. These also manage some local state.
     if (entry.action.verb.cref().id == DISCIPLINE_CHANGED_ID) {
@@ -479,81 +1054,129 @@ auto DbPopulator::populate_from_entry(const lpt::ParsedLogLine& entry) -> int {
         auto pc_class = PcClass {CombatStyle(entry.action.noun.cref()), AdvancedClass(*entry.action.detail.cref())};
         // This must be done *after* we've encountered the actor's name (as a source or target).
         add_class_to_pc_actor(actor, pc_class);
-    } else if (entry.action.verb.cref().id == AREA_ENTERED_ID) {
+    } else if (entry.action.verb.cref().id == LogParserTypes::AREA_ENTERED_ID) {
         record_area_entered(AreaName(entry.action.noun.cref()),
                             std::optional<DifficultyName>{entry.action.detail.val()});
     } 
-    
-    // 11- value_version
-    // 12- value_base
-    // 13- value_crit
-    // 14- value_effective
-    // 15- value_type
-    // 16- value_mitigation_reason
-    // 17- value_mitigation_effect_value
-    // 18- value_mitigation_effect_value_name
 
     if (entry.value) {
         if (std::holds_alternative<LogParserTypes::LogInfoValue>(*entry.value)) {
-            params.append(/*11*/std::get<LogParserTypes::LogInfoValue>(*entry.value).info);
-            params.append(/*12*/);
-            params.append(/*13*/);
-            params.append(/*14*/);
-            params.append(/*15*/);
-            params.append(/*16*/);
-            params.append(/*17*/);
-            params.append(/*18*/);
+            row.value_version = std::get<LogParserTypes::LogInfoValue>(*entry.value).info;
         } else {
-            params.append(/*11*/);
             auto& v = std::get<LogParserTypes::RealValue>(*entry.value);
-            params.append(/*12*/v.base_value);
-            params.append(/*13*/v.crit);
-            append_or_null(params, /*14*/(v.effective));
-            /*15*/ if (v.type) params.append(add_name_id(*v.type)); else params.append();
-            /*16*/ if (v.mitigation_reason) params.append(add_name_id(*v.mitigation_reason)); else params.append();
+            row.value_base = v.base_value;
+            row.value_crit = v.crit;
+            row.value_effective = v.effective;
+            if (v.type) {
+                row.value_type = add_name_id(*v.type);
+            }
+            if (v.mitigation_reason) {
+                row.value_mitigation_reason = add_name_id(*v.mitigation_reason);
+            }
             if (v.mitigation_effect) {
-                append_or_null(params, /*17*/v.mitigation_effect->value);
+                row.value_mitigation_effect_value = v.mitigation_effect->value;
                 if (v.mitigation_effect->effect) {
-                    params.append(/*18*/add_name_id(*v.mitigation_effect->effect));
-                } else {
-                    params.append(/*18*/);
+                    row.value_mitigation_effect_value_name = add_name_id(*v.mitigation_effect->effect);
                 }
-            } else {
-                params.append(/*17*/);
-                params.append(/*18*/);
             }
         }
-    } else {
-        params.append(/*11*/);
-        params.append(/*12*/);
-        params.append(/*13*/);
-        params.append(/*14*/);
-        params.append(/*15*/);
-        params.append(/*16*/);
-        params.append(/*17*/);
-        params.append(/*18*/);
-    }
-        
-    // 19- threat_val
-    // 20- threat_str
+    }
 
     if (entry.threat) {
         if (std::holds_alternative<double>(*entry.threat)) {
-            params.append(/*19*/static_cast<int>(std::get<double>(*entry.threat)));
-            params.append(/*20*/);
+            row.threat_val = static_cast<int>(std::get<double>(*entry.threat));
         } else {
-            params.append(/*19*/);
-            params.append(/*20*/std::get<std::string>(*entry.threat));
+            row.threat_str = std::get<std::string>(*entry.threat);
         }
-    } else {
-        params.append(/*19*/);
-        params.append(/*20*/);
-    }        
+    }
+
+    row.logfile = m_logfile_id;
+
+    if (row.combat) {
+        summarize_event(row);
+    }
 
-    // 21- logfile
-    params.append(m_logfile_id);
+    return row;
+}
+
+auto DbPopulator::summarize_event(const EventRow& row) -> void {
+    if (!row.value_base && !row.threat_val) {
+        return;
+    }
 
-    auto ins = "INSERT INTO Event "
+    auto& sum = m_combat_summary[{row.source.value_or(0), row.target.value_or(0), row.ability.value_or(0), row.action,
+                                  row.value_type.value_or(0)}];
+    if (row.value_base) {
+        const auto base = static_cast<int64_t>(*row.value_base);
+        sum.total += base;
+        sum.effective += static_cast<int64_t>(row.value_effective.value_or(*row.value_base));
+        ++sum.hits;
+        sum.crits += row.value_crit.value_or(false) ? 1 : 0;
+        sum.max_hit = std::max(sum.max_hit, base);
+    }
+    sum.threat += row.threat_val.value_or(0);
+}
+
+auto DbPopulator::write_combat_summary() -> void {
+    if (m_combat_summary.empty()) {
+        return;
+    }
+
+    std::vector<int> sources, targets, abilities, actions, value_types, hits, crits;
+    std::vector<int64_t> totals, effectives, max_hits, threats;
+    for (const auto& [key, sum] : m_combat_summary) {
+        const auto& [source, target, ability, action, value_type] = key;
+        sources.push_back(source);
+        targets.push_back(target);
+        abilities.push_back(ability);
+        actions.push_back(action);
+        value_types.push_back(value_type);
+        totals.push_back(sum.total);
+        effectives.push_back(sum.effective);
+        hits.push_back(sum.hits);
+        crits.push_back(sum.crits);
+        max_hits.push_back(sum.max_hit);
+        threats.push_back(sum.threat);
+    }
+
+    // In m_tx, so with batched commits the totals are committed along with the combat's Event rows.
+    m_tx->exec("INSERT INTO Combat_Summary (logfile, combat, source, target, ability, action, value_type,"
+               "  total, effective, hits, crits, max_hit, threat)"
+               " SELECT $1, $2, NULLIF(s, 0), NULLIF(t, 0), NULLIF(ab, 0), ac, NULLIF(vt, 0), tot, eff, h, c, mh, th"
+               " FROM unnest($3::INT[], $4::INT[], $5::INT[], $6::INT[], $7::INT[], $8::BIGINT[], $9::BIGINT[],"
+               "  $10::INT[], $11::INT[], $12::BIGINT[], $13::BIGINT[]) AS u(s, t, ab, ac, vt, tot, eff, h, c, mh, th)",
+               pqxx::params(m_logfile_id, *m_combat_id, sources, targets, abilities, actions, value_types, totals,
+                            effectives, hits, crits, max_hits, threats));
+    BLT(info) << "write_combat_summary: " << m_combat_summary.size() << " rows for combat id=" << *m_combat_id;
+    m_combat_summary.clear();
+}
+
+auto DbPopulator::insert_event_row(const EventRow& row) -> int64_t {
+    pqxx::params params;
+
+    params.append(/*1 */row.ts);
+    append_or_null(params, /*2 */row.combat);
+    append_or_null(params, /*3 */row.source);
+    append_or_null(params, /*4 */row.source_location);
+    append_or_null(params, /*5 */row.source_health);
+    append_or_null(params, /*6 */row.target);
+    append_or_null(params, /*7 */row.target_location);
+    append_or_null(params, /*8 */row.target_health);
+    append_or_null(params, /*9 */row.ability);
+    params.append(/*10*/row.action);
+    append_or_null(params, /*11*/row.value_version);
+    append_or_null(params, /*12*/row.value_base);
+    append_or_null(params, /*13*/row.value_crit);
+    append_or_null(params, /*14*/row.value_effective);
+    append_or_null(params, /*15*/row.value_type);
+    append_or_null(params, /*16*/row.value_mitigation_reason);
+    append_or_null(params, /*17*/row.value_mitigation_effect_value);
+    append_or_null(params, /*18*/row.value_mitigation_effect_value_name);
+    append_or_null(params, /*19*/row.threat_val);
+    append_or_null(params, /*20*/row.threat_str);
+    params.append(/*21*/row.logfile);
+
+    const std::string ins = "INSERT INTO Event "
         /*1 */"(ts"
         /*2 */",combat"
         /*3 */",source"
@@ -574,7 +1197,8 @@ auto DbPopulator::populate_from_entry(const lpt::ParsedLogLine& entry) -> int {
         /*18*/",value_mitigation_effect_value_name"
         /*19*/",threat_val"
         /*20*/",threat_str"
-        /*21*/",logfile) VALUES"
+        /*21*/",logfile";
+    const std::string values = ") VALUES"
         "($1"
         ",$2"
         ",$3"
@@ -595,9 +1219,97 @@ auto DbPopulator::populate_from_entry(const lpt::ParsedLogLine& entry) -> int {
         ",$18"
         ",$19"
         ",$20"
-        ",$21) RETURNING id";
+        ",$21";
 
-    auto event_id = m_tx->query_value<int>(ins, params);
+    // A reserved ID needn't come back from the server.
+    if (row.id) {
+        params.append(/*22*/*row.id);
+        m_tx->exec(ins + ",id" + values + ",$22)", params);
+        return *row.id;
+    }
+    return m_tx->query_value<int64_t>(ins + values + ") RETURNING id", params);
+}
+
+auto DbPopulator::flush_events() -> void {
+    if (m_pending_events.empty()) {
+        return;
+    }
+    BLT(info) << "flush_events: Streaming " << m_pending_events.size() << " Event rows.";
+
+    // COPY takes over the connection until it's complete, so no other query may run while the stream is open. This is
+    // why rows are buffered rather than streamed as they're produced - producing a row may require dimension lookups.
+    //
+    // Either every buffered row has a reserved ID or none do, since Options::event_id_block doesn't change.
+    const bool with_ids = m_pending_events.front().id.has_value();
+    auto stream = pqxx::stream_to::raw_table(*m_tx, "Event",
+                                             std::string(with_ids ? "id, " : "") +
+                                             "ts, combat,"
+                                             " source, source_location, source_health,"
+                                             " target, target_location, target_health,"
+                                             " ability, action,"
+                                             " value_version, value_base, value_crit, value_effective,"
+                                             " value_type, value_mitigation_reason,"
+                                             " value_mitigation_effect_value, value_mitigation_effect_value_name,"
+                                             " threat_val, threat_str,"
+                                             " logfile");
+    for (const auto& row : m_pending_events) {
+        // Location and Health are encoded by the string_traits in db_custom_types.hpp.
+        const auto values = std::tie(row.ts, row.combat,
+                                     row.source, row.source_location, row.source_health,
+                                     row.target, row.target_location, row.target_health,
+                                     row.ability, row.action,
+                                     row.value_version, row.value_base, row.value_crit, row.value_effective,
+                                     row.value_type, row.value_mitigation_reason,
+                                     row.value_mitigation_effect_value, row.value_mitigation_effect_value_name,
+                                     row.threat_val, row.threat_str,
+                                     row.logfile);
+        std::apply([&] (const auto&... v) {
+            if (with_ids) {
+                stream.write_values(*row.id, v...);
+            } else {
+                stream.write_values(v...);
+            }
+        }, values);
+    }
+    stream.complete();
+    m_pending_events.clear();
+}
 
-    return event_id;
+auto DbPopulator::next_event_id() -> int64_t {
+    if (m_event_ids_used == m_event_ids.size()) {
+        // Other connections may take IDs from the sequence at the same time, so the block needn't be contiguous, but
+        // each ID is larger than any reserved before it.
+        m_event_ids.clear();
+        m_event_ids_used = 0;
+        for (auto [id] : m_tx->query<int64_t>("SELECT nextval('event_id_seq') AS id FROM generate_series(1, $1)"
+                                              " ORDER BY id", pqxx::params(m_options.event_id_block))) {
+            m_event_ids.push_back(id);
+        }
+    }
+    return m_event_ids[m_event_ids_used++];
+}
+
+auto DbPopulator::populate_from_entry(const lpt::ParsedLogLine& entry) -> int64_t {
+    auto row = make_event_row(entry);
+
+    if (m_options.bulk_load_rows == 0) {
+        const auto id = insert_event_row(row);
+        event_written();
+        return id;
+    }
+
+    const auto id = row.id.value_or(0);
+    m_pending_events.push_back(std::move(row));
+    if (m_pending_events.size() >= m_options.bulk_load_rows) {
+        flush_events();
+    }
+    event_written();
+    return id;
+}
+
+auto DbPopulator::populate_from_entries(std::span<const lpt::ParsedLogLine> entries) -> void {
+    prefetch_dimensions(entries);
+    for (const auto& entry : entries) {
+        populate_from_entry(entry);
+    }
 }
@@ -1,12 +1,22 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <map>
+#include <span>
 #include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
+#include "local_db_cache.hpp"
 #include "log_parser_types.hpp"
 #include "timestamps.hpp"
 #include "wrapper.hpp"
@@ -14,19 +24,40 @@
 class ScopeRuns {
   public:
     ScopeRuns(const std::string& function_name);
+
+    // Time a scope on one thread. Not thread safe.
     auto enter() -> void;
     auto exit() -> void;
 
+    // Count a call that began at `enter_time`, from CLOCK_MONOTONIC. Thread safe.
+    auto record(const timespec& enter_time) -> void;
+
     std::string m_func_name;
-    uint32_t m_num_calls {};
+    std::atomic<uint32_t> m_num_calls {};
+    timespec m_enter_time;
+    std::atomic<int64_t> m_total_time_in_func {};
+};
+
+// Records the time until the end of the enclosing scope in a ScopeRuns. The enter time is kept here rather than in the
+// ScopeRuns, so scopes on different threads can share one.
+class MeasureScope {
+  public:
+    MeasureScope(ScopeRuns& sr)
+        : m_sr(sr) {
+        clock_gettime(CLOCK_MONOTONIC, &m_enter_time);
+    }
+    ~MeasureScope() {
+        m_sr.record(m_enter_time);
+    }
+
+    ScopeRuns& m_sr;
     timespec m_enter_time;
-    int64_t m_total_time_in_func {};
 };
 
 // Forward references
 namespace pqxx {
     class connection;
-    class nontransaction;
+    class transaction_base;
 } // namespace pqxx
 
 extern ScopeRuns measure_add_name_id;
@@ -35,6 +66,7 @@ extern ScopeRuns measure_add_action;
 extern ScopeRuns measure_add_pc_actor;
 extern ScopeRuns measure_add_npc_actor;
 extern ScopeRuns measure_add_companion_actor;
+extern ScopeRuns measure_prefetch_dimensions;
 
 class DbPopulator {
   public:
@@ -45,7 +77,24 @@ class DbPopulator {
 
     enum class ExistingLogfileBehavior {
         DELETE_ON_EXISTING,
-        DELETE_ON_EXISTING_UNFINISHED
+        DELETE_ON_EXISTING_UNFINISHED,
+        RESUME_EXISTING
+    };
+
+    /**
+     * Where a resumable ingest left off
+     *
+     * Stored in the Log_File row by checkpoint() and read back by the constructor for RESUME_EXISTING.
+     */
+    struct ResumePoint {
+        // Offset just past the last line ingested, i.e. where the next line starts.
+        uint64_t offset {};
+
+        // Line number of the last line ingested; 0 if none.
+        int line_num {};
+
+        // Timestamp of the last log entry ingested, for Timestamps::resume().
+        std::optional<Timestamps::timestamp> last_ts;
     };
 
     struct duplicate_logfile : std::runtime_error {
@@ -55,6 +104,112 @@ class DbPopulator {
 
         bool m_fully_parsed {false};
     };
+
+    /**
+     * Tunables that change how rows are written to the database
+     *
+     * The defaults reproduce the original behavior: one round trip per Event row.
+     */
+    struct Options {
+        /**
+         * Number of Event rows to buffer before streaming them to the database with COPY
+         *
+         * 0 disables bulk loading and each Event row is written with its own INSERT. When non-zero,
+         * populate_from_entry() no longer returns the Event row ID because the row isn't written until the buffer is
+         * flushed, unless event_id_block is also set.
+         */
+        std::size_t bulk_load_rows {0};
+
+        /**
+         * Number of Event row IDs to reserve from the Event table's sequence at a time
+         *
+         * IDs are reserved with a single round trip and assigned to Event rows as they're produced, so an Event row's
+         * ID is known before it's written and no INSERT has to wait for one to come back. IDs left unused when the
+         * DbPopulator is destroyed are lost, leaving gaps.
+         *
+         * 0 lets the database assign each Event row's ID as it's written.
+         */
+        std::size_t event_id_block {0};
+
+        /**
+         * Preload the dimension caches from the database before populating anything
+         *
+         * Loads every Name, Action, Advanced_Class, and NPC and companion Actor row, plus each PC's Actor row with the
+         * "unknown" class, so that keys ingested from earlier logfiles are found without a SELECT. Worthwhile once the
+         * database holds a few logfiles; see warm_start_stats().
+         */
+        bool warm_start {false};
+
+        /**
+         * Maximum number of entries in each of the name, class, action, NPC, and companion caches
+         *
+         * 0 leaves them unbounded. When bounded, the least-recently used entry is evicted to make room. The PC cache is
+         * never bounded because it records which of a PC's Actor rows is current.
+         */
+        std::size_t cache_capacity {0};
+
+        /**
+         * Commit the rows written for the logfile after this many Event rows
+         *
+         * With this, commit_every, and commit_at_combat_end all left unset, every statement commits on its own. If any
+         * of them is set, the Combat and Event rows, and updates to the Log_File row, are written in a transaction
+         * that's committed as soon as any of the set conditions is met, and by commit(), checkpoint(),
+         * mark_fully_parsed(), and the destructor. A commit is only made between Event rows, so Event rows committed
+         * together are consecutive in the log.
+         *
+         * Name, Action, Advanced_Class, Area, and Actor rows are shared between logfiles, so they're written on a
+         * second connection that commits each statement. Otherwise a concurrent populator wanting the same row would
+         * have to wait for this one's transaction, and two such populators could deadlock. The Log_File row and its
+         * partitions are created there too. Attaching the partitions of a new logfile has to wait until every other
+         * populator commits its open transaction, and their further writes wait behind it, so populators running side
+         * by side each stall for up to a transaction whenever one of them starts a logfile.
+         *
+         * 0 never commits because of the number of rows.
+         */
+        std::size_t commit_every_events {0};
+
+        /**
+         * Commit once a transaction has been open this long, checked after each Event row. 0 never commits because of
+         * the time.
+         */
+        std::chrono::milliseconds commit_every {0};
+
+        /**
+         * Commit after the Event row that ends a combat
+         */
+        bool commit_at_combat_end {false};
+
+        auto batched_commits() const -> bool {
+            return commit_every_events > 0 || commit_every.count() > 0 || commit_at_combat_end;
+        }
+    };
+
+    /**
+     * Commits made because of Options::commit_every_events, commit_every, or commit_at_combat_end, or on request
+     */
+    struct CommitStats {
+        std::size_t commits {};
+
+        // Event rows committed.
+        std::size_t events {};
+
+        // Wall time spent in COMMIT, flushing buffered Event rows included.
+        std::chrono::nanoseconds duration {};
+    };
+
+    /**
+     * What the warm start cost and what it bought
+     */
+    struct WarmStartStats {
+        // Wall time spent preloading the caches.
+        std::chrono::nanoseconds duration {};
+
+        // Rows copied into the caches.
+        std::size_t rows_loaded {};
+
+        // Preloaded keys that were later looked up, across all caches. Each one is a SELECT that didn't have to be made.
+        std::size_t lookups_saved {};
+    };
     
   public:
     /**
@@ -70,6 +225,11 @@ class DbPopulator {
      * 2. DELETE_ON_EXISTING_UNFINISHED
      *    If existing Log_File entry is not completely parsed (`fully_parsed` attribute is false), delete as per
      *    DELETE_ON_EXISTING. If Log_File entry is fully parsed, throw.
+     * 3. RESUME_EXISTING
+     *    Keep the existing Log_File entry and pick up where its last checkpoint() left off: Event and Combat rows
+     *    written after the checkpoint are deleted, and the current area, the combat in progress and its totals, and
+     *    which Actor row is current for each PC are restored. resume_point() tells the caller where in the logfile to
+     *    carry on from.
      *
      * Retrieve the schema version from the database.
      *
@@ -91,24 +251,111 @@ class DbPopulator {
                 Timestamps::timestamp logfile_ts,
                 ExistingLogfileBehavior existing_logfile_behavior);
 
+    /**
+     * Create a DbPopulator object with non-default tuning
+     *
+     * Identical to the constructor above but rows are written as described by `options`.
+     */
+    DbPopulator(const ConnStr& conn_str,
+                const LogfileFilename& logfile_filename,
+                Timestamps::timestamp logfile_ts,
+                ExistingLogfileBehavior existing_logfile_behavior,
+                const Options& options);
+
     /**
      * Destroy a DbPopulator object
      *
-     * Free local state and close the database connection.
+     * Free local state and close the database connection. Any Event rows still buffered for bulk loading are
+     * flushed and, with batched commits, the open transaction is committed; errors while doing so are logged but not
+     * thrown.
      * 
      * @note This is required because the destructor must have access to the full definition of pqxx::connection, which
      * is forward-declared to avoid letting pqxx leak into the caller.
      */
      ~DbPopulator();
 
-    auto populate_from_entry(const LogParserTypes::ParsedLogLine& entry) -> int;
+    /**
+     * Add a parsed log entry to the database
+     *
+     * Ensures all names, actors, and the action referenced by `entry` are in the database and then writes the Event
+     * row.
+     *
+     * @returns The Event row ID; if bulk loading is enabled the row is buffered instead and 0 is returned, unless the
+     *     ID was reserved (see Options::event_id_block).
+     */
+    auto populate_from_entry(const LogParserTypes::ParsedLogLine& entry) -> int64_t;
+
+    /**
+     * Add a window of parsed log entries to the database
+     *
+     * Equivalent to calling populate_from_entry() for each entry in order, except that the names, actions, and actors
+     * the window references that aren't cached yet are first resolved together in a single pipelined round trip (see
+     * prefetch_dimensions()). Only then are the Event rows produced.
+     *
+     * @param[in] entries Consecutive log entries, in log order
+     */
+    auto populate_from_entries(std::span<const LogParserTypes::ParsedLogLine> entries) -> void;
+
+    /**
+     * Write all buffered Event rows to the database with a single COPY
+     *
+     * Does nothing if bulk loading is disabled or no rows are buffered.
+     */
+    auto flush_events() -> void;
 
+    /**
+     * Make everything written so far visible to other connections
+     *
+     * Flushes any buffered Event rows and, if Options::batched_commits(), commits the transaction and starts another.
+     */
+    auto commit() -> void;
+
+    /**
+     * Mark the logfile as completely ingested
+     *
+     * Flushes any buffered Event rows and commits them along with the update, so the logfile is never seen as fully
+     * parsed without all of its events. If the log ended during a combat, that combat's totals are written to
+     * Combat_Summary too.
+     */
     auto mark_fully_parsed(void) -> void;
 
+    /**
+     * Record that every log entry up to `rp` is in the database
+     *
+     * Flushes any buffered Event rows, then saves `rp` along with the current area, combat, and PC Actor rows in the
+     * Log_File row with a single statement, so a checkpoint is either completely written or not at all. With batched
+     * commits, the checkpoint is committed along with the rows it covers. A later DbPopulator constructed with
+     * RESUME_EXISTING carries on from here.
+     *
+     * @param[in] rp Position just past the last log entry given to populate_from_entry() or populate_from_entries()
+     */
+    auto checkpoint(const ResumePoint& rp) -> void;
+
+    /**
+     * The checkpoint this DbPopulator resumed from
+     *
+     * @return The resume point if the constructor resumed an existing logfile with RESUME_EXISTING; otherwise empty,
+     *     and the logfile is ingested from the start.
+     */
+    auto resume_point() const -> std::optional<ResumePoint> {
+        return m_resume_point;
+    }
+
     auto db_version() const -> std::string {
         return m_db_version;
     }
 
+    auto warm_start_stats() const -> WarmStartStats;
+
+    auto commit_stats() const -> CommitStats {
+        return m_commit_stats;
+    }
+
+    /**
+     * Hit, miss, insert, and eviction counters of each dimension cache
+     */
+    auto cache_stats() const -> std::vector<LocalDbCacheStats>;
+
     auto in_combat() const -> bool {
         return m_combat_id.has_value();
     }
@@ -149,9 +396,6 @@ class DbPopulator {
     
     // TODO: These are extracted from a log. They should probably move into a configuration file.
     inline static constexpr uint64_t DISCIPLINE_CHANGED_ID {836045448953665};
-    inline static constexpr uint64_t AREA_ENTERED_ID       {836045448953664};
-    inline static constexpr uint64_t ENTER_COMBAT_ID       {836045448945489};
-    inline static constexpr uint64_t EXIT_COMBAT_ID        {836045448945490};
 
     inline static constexpr std::string ACTOR_PC_CLASS_TYPE_NAME {"pc"};
     inline static constexpr std::string ACTOR_NPC_CLASS_TYPE_NAME {"npc"};
@@ -163,6 +407,46 @@ class DbPopulator {
         int class_id;
     };
 
+    // One row of the Event table, with all foreign keys already resolved to row IDs. Empty optionals are NULLs.
+    struct EventRow {
+        // Reserved ID; empty if the database assigns it.
+        std::optional<int64_t> id;
+        int64_t ts {};
+        std::optional<int> combat;
+        std::optional<int> source;
+        std::optional<LogParserTypes::Location> source_location;
+        std::optional<LogParserTypes::Health> source_health;
+        std::optional<int> target;
+        std::optional<LogParserTypes::Location> target_location;
+        std::optional<LogParserTypes::Health> target_health;
+        std::optional<int> ability;
+        int action {};
+        std::optional<std::string> value_version;
+        std::optional<uint64_t> value_base;
+        std::optional<bool> value_crit;
+        std::optional<uint64_t> value_effective;
+        std::optional<int> value_type;
+        std::optional<int> value_mitigation_reason;
+        std::optional<uint64_t> value_mitigation_effect_value;
+        std::optional<int> value_mitigation_effect_value_name;
+        std::optional<int> threat_val;
+        std::optional<std::string> threat_str;
+        int logfile {};
+    };
+
+    // Totals of the combat in progress for one CombatSummaryKey. Written as a Combat_Summary row when the combat ends.
+    struct CombatSummary {
+        int64_t total {};
+        int64_t effective {};
+        int hits {};
+        int crits {};
+        int64_t max_hit {};
+        int64_t threat {};
+    };
+
+    // source, target, ability, action, and value_type row IDs. 0 stands for NULL; no row has ID 0.
+    using CombatSummaryKey = std::tuple<int, int, int, int, int>;
+
   protected:
     /**
      * Ensure name and ID are in database
@@ -414,7 +698,7 @@ class DbPopulator {
     /**
      * End the current combat
      *
-     * This updates the current combat and sets the end timestamp. 
+     * This updates the current combat and sets the end timestamp, and writes the combat's totals to Combat_Summary.
      *
      * @note m_combat_id is cleared indicating we're no longer in combat
      *
@@ -427,10 +711,116 @@ class DbPopulator {
      */
     auto record_exit_combat(const Timestamps::timestamp& combat_end) -> int;
 
+    /**
+     * Restore the state saved by the logfile's last checkpoint()
+     *
+     * Called by the constructor for RESUME_EXISTING.
+     *
+     * @param[in] logfile_id Row ID of the existing Log_File entry
+     */
+    auto resume_logfile(int logfile_id) -> void;
+
+    /**
+     * Fill the dimension caches from the database
+     *
+     * Called by the constructor when Options::warm_start is set. Each table is copied out with a single streamed query
+     * and its rows are preloaded into the cache, which counts how many of them are later used.
+     */
+    auto warm_start() -> void;
+
+    /**
+     * Bring every dimension row referenced by a window of log entries into the local caches
+     *
+     * Collects the keys of the names, actions, NPCs, and PCs the entries reference that aren't in m_names, m_actions,
+     * m_npcs, or m_pcs and resolves all of them with one pqxx::pipeline: missing rows are inserted and all row IDs are
+     * selected, with the statements batched into a single round trip. Companions depend on the PC Actor row of their
+     * owner, so they're resolved in a second, smaller round trip once the PCs are known.
+     *
+     * Rows are inserted exactly as the add_*() methods would have inserted them had they seen the keys one at a time,
+     * so this is purely an optimization - anything it misses is handled by the add_*() methods as usual.
+     *
+     * @param[in] entries Log entries whose references should be cached
+     */
+    auto prefetch_dimensions(std::span<const LogParserTypes::ParsedLogLine> entries) -> void;
+
+    /**
+     * Resolve all references in a parsed log entry into an Event row
+     *
+     * This is where names, actors, and actions are added to the database and where combat and area state is updated,
+     * so it must be called exactly once per log entry and in log order.
+     *
+     * @param[in] entry The parsed log entry
+     * @returns The Event row ready to be written
+     */
+    auto make_event_row(const LogParserTypes::ParsedLogLine& entry) -> EventRow;
+
+    /**
+     * Write a single Event row with an INSERT
+     *
+     * @param[in] row The row to write
+     * @returns The row ID of the new Event
+     */
+    auto insert_event_row(const EventRow& row) -> int64_t;
+
+    /**
+     * The next reserved Event row ID, reserving another Options::event_id_block of them if they've run out
+     */
+    auto next_event_id() -> int64_t;
+
+    /**
+     * Count an Event row written, and commit if Options says it's time to
+     */
+    auto event_written() -> void;
+
+    /**
+     * Add an Event row of the combat in progress to the combat's totals
+     *
+     * Rows with neither a value nor a threat aren't counted.
+     */
+    auto summarize_event(const EventRow& row) -> void;
+
+    /**
+     * Write the totals of the combat in progress to Combat_Summary with a single statement, then clear them
+     */
+    auto write_combat_summary() -> void;
+
+    /**
+     * Where dimension rows are read and written, and where the logfile's Log_File row and partitions are set up
+     *
+     * Each statement commits on its own: m_autocommit_tx with batched commits, else m_tx.
+     */
+    auto autocommit_tx() -> pqxx::transaction_base&;
+
+    /**
+     * Give a new logfile its own partitions of the Combat, Event, and Combat_Summary tables
+     *
+     * Each is created as a table of its own and then attached. Attaching waits for the open transactions of every
+     * other populator writing to the database; see Options::commit_every_events.
+     */
+    auto attach_partitions(int logfile_id) -> void;
+
+    /**
+     * Drop a logfile's partitions, and with them all of its Combat, Event, and Combat_Summary rows
+     */
+    auto drop_partitions(int logfile_id) -> void;
+
     // The connection. Made a pointer so we can delay construction until the body of our constructor and avoid throwing
     // exceptions in the initialization list.
     std::unique_ptr<pqxx::connection> m_cx;
-    std::unique_ptr<pqxx::nontransaction> m_tx;
+
+    // A pqxx::work with batched commits, else a pqxx::nontransaction.
+    std::unique_ptr<pqxx::transaction_base> m_tx;
+
+    // Only opened with batched commits. See autocommit_tx().
+    std::unique_ptr<pqxx::connection> m_autocommit_cx;
+    std::unique_ptr<pqxx::transaction_base> m_autocommit_tx;
+
+    // Event rows written, and when, since the last commit. m_combat_ended is set by record_exit_combat().
+    std::size_t m_uncommitted_events {};
+    std::chrono::steady_clock::time_point m_tx_start {};
+    bool m_combat_ended {false};
+
+    CommitStats m_commit_stats;
 
     std::string m_db_version;
 
@@ -462,7 +852,7 @@ class DbPopulator {
      * key: name ID of PC
      * value: most-recent row ID in Actor table for PC
      */
-    std::map<uint64_t, ActorRowInfo> m_pcs;
+    LocalDbCache<uint64_t, ActorRowInfo> m_pcs {"PC Actor"};
 
     /**
      * Is the logfile parsing and population complete
@@ -472,11 +862,31 @@ class DbPopulator {
      */
     bool m_parsing_finished {false};
 
-    std::map<uint64_t, int> m_names;
+    // Set if the constructor resumed an existing logfile.
+    std::optional<ResumePoint> m_resume_point;
+
+    Options m_options;
+
+    // Event rows waiting to be streamed with COPY. Only used when m_options.bulk_load_rows is non-zero.
+    std::vector<EventRow> m_pending_events;
+
+    // Event row IDs reserved by next_event_id(), in ascending order, and how many of them have been used.
+    std::vector<int64_t> m_event_ids;
+    std::size_t m_event_ids_used {};
+
+    // Totals of the combat in progress, kept by summarize_event().
+    std::unordered_map<CombatSummaryKey, CombatSummary, LocalDbCacheHash<CombatSummaryKey>> m_combat_summary;
+
+    LocalDbCache<uint64_t, int> m_names;
+
+    LocalDbCache<std::tuple<uint64_t,uint64_t>, int> m_classes;
+
+    LocalDbCache<std::tuple<uint64_t,uint64_t,uint64_t>, int> m_actions;
 
-    std::map<std::tuple<uint64_t,uint64_t>, int> m_classes;
+    LocalDbCache<std::tuple<uint64_t,uint64_t>, int> m_npcs;
 
-    std::map<std::tuple<uint64_t,uint64_t,uint64_t>, int> m_actions;
+    // key: companion name ID, Actor row ID of the owning PC, companion instance
+    LocalDbCache<std::tuple<uint64_t,int,uint64_t>, int> m_companions;
 
-    std::map<std::tuple<uint64_t,uint64_t>, int> m_npcs;
+    WarmStartStats m_warm_start_stats;
 };
@@ -0,0 +1,102 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <array>
+#include <cstring>
+#include <functional>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "delimiter_index.hpp"
+
+namespace {
+    constexpr auto WORD_BITS = DelimiterIndex::WORD_BITS;
+
+    /*
+     * The delimiters are found with five comparisons rather than nine: '[' and '{', and ']' and '}', differ only in bit
+     * 0x20; '(' and ')' only in bit 0x01; and '<' and '>' only in bit 0x02. No other byte matches once those bits are
+     * masked.
+     */
+#if defined(__AVX2__)
+    // Delimiter bits of 32 bytes.
+    auto chunk_mask(const char* p) -> uint64_t {
+        const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto folded = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+        const auto brackets = _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                                              _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+        const auto parens = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, _mm256_set1_epi8(~0x01)), _mm256_set1_epi8('('));
+        const auto angles = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, _mm256_set1_epi8(~0x02)), _mm256_set1_epi8('<'));
+        const auto pipes = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('|'));
+        const auto hits = _mm256_or_si256(_mm256_or_si256(brackets, parens), _mm256_or_si256(angles, pipes));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+    }
+    constexpr std::size_t CHUNK {32};
+#elif defined(__SSE2__)
+    // Delimiter bits of 16 bytes.
+    auto chunk_mask(const char* p) -> uint64_t {
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto folded = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        const auto brackets = _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                                           _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+        const auto parens = _mm_cmpeq_epi8(_mm_and_si128(bytes, _mm_set1_epi8(~0x01)), _mm_set1_epi8('('));
+        const auto angles = _mm_cmpeq_epi8(_mm_and_si128(bytes, _mm_set1_epi8(~0x02)), _mm_set1_epi8('<'));
+        const auto pipes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('|'));
+        const auto hits = _mm_or_si128(_mm_or_si128(brackets, parens), _mm_or_si128(angles, pipes));
+        return static_cast<uint16_t>(_mm_movemask_epi8(hits));
+    }
+    constexpr std::size_t CHUNK {16};
+#else
+    constexpr auto DELIMITER_TABLE = [] {
+        std::array<uint8_t, 256> table {};
+        for (const auto c : DelimiterIndex::DELIMITERS) {
+            table[static_cast<unsigned char>(c)] = 1;
+        }
+        return table;
+    }();
+
+    // Delimiter bits of 64 bytes.
+    auto chunk_mask(const char* p) -> uint64_t {
+        uint64_t mask {};
+        for (std::size_t i = 0; i < WORD_BITS; i++) {
+            mask |= static_cast<uint64_t>(DELIMITER_TABLE[static_cast<unsigned char>(p[i])]) << i;
+        }
+        return mask;
+    }
+    constexpr std::size_t CHUNK {WORD_BITS};
+#endif
+
+    // Delimiter bits of 64 bytes.
+    auto word_mask(const char* p) -> uint64_t {
+        uint64_t mask {};
+        for (std::size_t shift = 0; shift < WORD_BITS; shift += CHUNK) {
+            mask |= chunk_mask(p + shift) << shift;
+        }
+        return mask;
+    }
+} // namespace
+
+auto DelimiterIndex::build(std::string_view line) -> void {
+    m_line = line;
+    m_bits.resize((line.size() + WORD_BITS - 1) / WORD_BITS);
+
+    const auto whole_words = line.size() / WORD_BITS;
+    for (std::size_t w = 0; w < whole_words; w++) {
+        m_bits[w] = word_mask(line.data() + w * WORD_BITS);
+    }
+    // The vector loads would read past the end of the line, so the partial word at the end is copied out first. NUL
+    // isn't a delimiter.
+    if (const auto tail = line.size() % WORD_BITS; tail != 0) {
+        std::array<char, WORD_BITS> padded {};
+        std::memcpy(padded.data(), line.data() + whole_words * WORD_BITS, tail);
+        m_bits[whole_words] = word_mask(padded.data());
+    }
+}
+
+auto DelimiterIndex::covers(std::string_view part) const -> bool {
+    // std::less, since pointers into different strings can't be compared with <.
+    const std::less<const char*> before;
+    return m_line.data() != nullptr && part.data() != nullptr && !before(part.data(), m_line.data())
+        && !before(m_line.data() + m_line.size(), part.data() + part.size());
+}
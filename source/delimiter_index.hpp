@@ -0,0 +1,104 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Positions of the field delimiters in a log line
+ *
+ * A line is split into fields and subfields by the bracket pairs and '|'. Rather than scanning the rest of the line for
+ * the next delimiter each time a field is extracted, build() makes one pass over the whole line, marking each
+ * delimiter with a bit, and a Cursor then steps from one delimiter to the next. The pass compares 32 bytes at a time
+ * with AVX2 or 16 at a time with SSE2 when the compiler targets them, and a byte at a time otherwise; see VECTORIZED.
+ *
+ * The index refers to the line it was built from, which must outlive its use.
+ */
+class DelimiterIndex {
+  public:
+    inline static constexpr std::string_view DELIMITERS {"[]()<>{}|"};
+
+    // Characters per word of the index.
+    inline static constexpr std::size_t WORD_BITS {64};
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    inline static constexpr bool VECTORIZED {true};
+#else
+    // Built a byte at a time, the index costs more than the scans it saves.
+    inline static constexpr bool VECTORIZED {false};
+#endif
+
+    static constexpr auto is_delimiter(char c) -> bool {
+        switch (c) {
+        case '[': case ']': case '(': case ')': case '<': case '>': case '{': case '}': case '|':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Visits the delimiters of part of the indexed line in order
+     */
+    class Cursor {
+      public:
+        /**
+         * @param[in] part A view into the indexed line; see covers()
+         */
+        Cursor(const DelimiterIndex& index, std::string_view part)
+            : m_words(index.m_bits.data()),
+              m_offset(static_cast<std::size_t>(part.data() - index.m_line.data())),
+              m_size(part.size())
+        {
+            if (m_size != 0) {
+                m_bits = m_words[m_offset / WORD_BITS] & (~uint64_t {0} << (m_offset % WORD_BITS));
+            }
+        }
+
+        /**
+         * The position in the part of the next delimiter, or its size if there are no more
+         */
+        auto next() -> std::size_t {
+            while (m_bits == 0) {
+                if (++m_word * WORD_BITS >= m_offset + m_size) {
+                    return m_size;
+                }
+                m_bits = m_words[m_word];
+            }
+            const auto found = m_word * WORD_BITS + static_cast<std::size_t>(std::countr_zero(m_bits));
+            m_bits &= m_bits - 1;
+            return found < m_offset + m_size ? found - m_offset : m_size;
+        }
+
+      private:
+        const uint64_t* m_words;
+        std::size_t m_offset;
+        std::size_t m_size;
+        std::size_t m_word {m_offset / WORD_BITS};
+        // The delimiters of m_word not yet visited.
+        uint64_t m_bits {};
+    };
+
+    /**
+     * Index a line, replacing whatever was indexed before
+     */
+    auto build(std::string_view line) -> void;
+
+    auto clear() -> void {
+        m_line = {};
+    }
+
+    /**
+     * Is `part` the indexed line or a view into it?
+     */
+    auto covers(std::string_view part) const -> bool;
+
+  private:
+    std::string_view m_line;
+
+    // Bit i % 64 of word i / 64 is set if m_line[i] is a delimiter.
+    std::vector<uint64_t> m_bits;
+};
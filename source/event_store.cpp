@@ -0,0 +1,163 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <variant>
+
+#include "event_store.hpp"
+
+namespace lpt = LogParserTypes;
+
+EventStore::EventStore() {
+    m_names.emplace_back("n/a");
+    m_actors.emplace_back();
+    m_actions.emplace_back();
+}
+
+auto EventStore::add(const lpt::ParsedLogLine& entry) -> void {
+    add(lpt::view_of(entry));
+}
+
+auto EventStore::add(const lpt::ParsedLogLineView& entry) -> void {
+    const auto row = static_cast<uint32_t>(size());
+    const auto ts = Timestamps::timestamp_to_ms_past_epoch(entry.ts);
+
+    const auto& action = entry.action;
+    if (action.noun.id == LogParserTypes::ENTER_COMBAT_ID) {
+        if (m_in_combat) {
+            // Never ended. Leave ts_end at 0.
+            m_combats.back().end_row = row;
+        }
+        m_combats.push_back(CombatInfo {.ts_begin = ts, .first_row = row, .end_row = row});
+        m_in_combat = true;
+    } else if (action.noun.id == LogParserTypes::EXIT_COMBAT_ID && m_in_combat) {
+        m_combats.back().ts_end = ts;
+        m_in_combat = false;
+    }
+
+    m_ts.push_back(ts);
+    if (m_in_combat) {
+        m_combat.push_back(static_cast<uint32_t>(m_combats.size()));
+        m_combats.back().end_row = row + 1;
+    } else {
+        m_combat.push_back(0);
+    }
+
+    m_source.push_back(entry.source ? intern_actor(entry.source->actor) : NOT_APPLICABLE);
+    m_target.push_back(entry.target ? intern_actor(entry.target->actor) : NOT_APPLICABLE);
+    if (entry.ability) {
+        m_ability.push_back(intern_name(entry.ability->id, entry.ability->name));
+    } else {
+        m_ability.push_back(NOT_APPLICABLE);
+    }
+
+    const auto detail_log_id = action.detail ? action.detail->id : 0;
+    auto [action_it, new_action] = m_action_ids.try_emplace({action.verb.id, action.noun.id, detail_log_id},
+                                                            static_cast<DictId>(m_actions.size()));
+    if (new_action) {
+        m_actions.push_back(ActionInfo {.verb = intern_name(action.verb.id, action.verb.name),
+                                        .noun = intern_name(action.noun.id, action.noun.name),
+                                        .detail = action.detail ? intern_name(action.detail->id, action.detail->name)
+                                                                : NOT_APPLICABLE});
+    }
+    m_action.push_back(action_it->second);
+
+    uint8_t flags {};
+    int64_t value {};
+    int64_t effective {};
+    DictId value_type {NOT_APPLICABLE};
+    if (const auto* rv = entry.value ? std::get_if<lpt::RealValueView>(&*entry.value) : nullptr) {
+        flags |= HAS_VALUE;
+        if (rv->crit) {
+            flags |= CRIT;
+        }
+        value = static_cast<int64_t>(rv->base_value);
+        effective = static_cast<int64_t>(rv->effective.value_or(rv->base_value));
+        if (rv->type) {
+            value_type = intern_name(rv->type->id, rv->type->name);
+        }
+    }
+    double threat {};
+    // A string here is the version of the log's first line.
+    if (const auto* t = entry.threat ? std::get_if<double>(&*entry.threat) : nullptr) {
+        flags |= HAS_THREAT;
+        threat = *t;
+    }
+    m_value.push_back(value);
+    m_effective.push_back(effective);
+    m_value_type.push_back(value_type);
+    m_threat.push_back(threat);
+    m_flags.push_back(flags);
+}
+
+auto EventStore::intern_name(uint64_t log_id, std::string_view name) -> DictId {
+    auto [it, inserted] = m_name_ids.try_emplace(log_id, static_cast<DictId>(m_names.size()));
+    if (inserted) {
+        m_names.emplace_back(name);
+    }
+    return it->second;
+}
+
+auto EventStore::intern_actor(const lpt::ActorView& actor) -> DictId {
+    auto intern = [this] (ActorType type, lpt::NameIdView name, uint64_t instance, uint64_t owner_log_id,
+                          DictId owner) {
+        auto [it, inserted] = m_actor_ids.try_emplace({type, name.id, instance, owner_log_id},
+                                                      static_cast<DictId>(m_actors.size()));
+        if (inserted) {
+            m_actors.push_back(ActorInfo {.type = type, .name = intern_name(name.id, name.name),
+                                          .instance = instance, .owner = owner});
+        }
+        return it->second;
+    };
+
+    if (const auto* comp = std::get_if<lpt::CompanionActorView>(&actor)) {
+        const auto owner = intern(ActorType::PC, comp->pc, 0, 0, NOT_APPLICABLE);
+        return intern(ActorType::COMPANION, comp->companion.name_id, comp->companion.instance, comp->pc.id, owner);
+    }
+    if (const auto* npc = std::get_if<lpt::NpcActorView>(&actor)) {
+        return intern(ActorType::NPC, npc->name_id, npc->instance, 0, NOT_APPLICABLE);
+    }
+    return intern(ActorType::PC, std::get<lpt::PcActorView>(actor), 0, 0, NOT_APPLICABLE);
+}
+
+auto EventStore::find_name(uint64_t log_id) const -> DictId {
+    const auto it = m_name_ids.find(log_id);
+    return it == m_name_ids.end() ? NOT_APPLICABLE : it->second;
+}
+
+auto EventStore::all() const -> Selection {
+    Selection rows(size());
+    std::iota(rows.begin(), rows.end(), 0U);
+    return rows;
+}
+
+auto EventStore::rows_of_combat(uint32_t combat) const -> Selection {
+    if (combat == 0 || combat > m_combats.size()) {
+        return {};
+    }
+    const auto& info = m_combats[combat - 1];
+    Selection rows(info.end_row - info.first_row);
+    std::iota(rows.begin(), rows.end(), info.first_row);
+    return rows;
+}
+
+auto EventStore::add_to_totals(Totals& totals, uint32_t row) const -> void {
+    ++totals.events;
+    const auto flags = m_flags[row];
+    if ((flags & HAS_VALUE) != 0) {
+        ++totals.hits;
+        totals.crits += (flags & CRIT) != 0 ? 1 : 0;
+        totals.total += m_value[row];
+        totals.effective += m_effective[row];
+        totals.max_hit = std::max(totals.max_hit, m_value[row]);
+    }
+    totals.threat += m_threat[row];
+}
+
+auto EventStore::totals(const Selection& rows) const -> Totals {
+    Totals t;
+    for (const auto row : rows) {
+        add_to_totals(t, row);
+    }
+    return t;
+}
@@ -0,0 +1,267 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "local_db_cache.hpp"
+#include "log_parser_types.hpp"
+
+/**
+ * Parsed log entries held in memory, one column per field
+ *
+ * An alternative to populating a database for analyzing a night's logs. Each entry added becomes one row. Names,
+ * actors, and actions are dictionary encoded: each distinct one is given a dense ID, and the columns hold only the IDs,
+ * so a scan touches a few bytes per row. ID 0 of every dictionary is "n/a", for a field the entry doesn't have, like
+ * the pseudo-null rows of the database.
+ *
+ * Combats are tracked from the EnterCombat and ExitCombat events, as DbPopulator does, and numbered from 1 in the order
+ * they began.
+ *
+ * Queries are built from three primitives: filter() selects rows, scan() visits them, and group_by() totals their
+ * values the way Combat_Summary does.
+ */
+class EventStore {
+  public:
+    // Dense ID in one of the dictionaries.
+    using DictId = uint32_t;
+
+    // Row numbers, in ascending order.
+    using Selection = std::vector<uint32_t>;
+
+    inline static constexpr DictId NOT_APPLICABLE {0};
+
+    enum class ActorType : uint8_t {
+        NONE,
+        PC,
+        NPC,
+        COMPANION
+    };
+
+    struct ActorInfo {
+        ActorType type {ActorType::NONE};
+
+        // Name dictionary ID of the actor's name.
+        DictId name {NOT_APPLICABLE};
+
+        // NPCs and companions only.
+        uint64_t instance {};
+
+        // Companions only: the actor ID of the owning PC.
+        DictId owner {NOT_APPLICABLE};
+    };
+
+    // Name dictionary IDs of the parts of an action.
+    struct ActionInfo {
+        DictId verb {NOT_APPLICABLE};
+        DictId noun {NOT_APPLICABLE};
+        DictId detail {NOT_APPLICABLE};
+    };
+
+    struct CombatInfo {
+        int64_t ts_begin {};
+
+        // 0 if the combat hadn't ended when the last entry was added.
+        int64_t ts_end {};
+
+        // Rows [first_row, end_row) were added during the combat.
+        uint32_t first_row {};
+        uint32_t end_row {};
+    };
+
+    // Bits of flags().
+    inline static constexpr uint8_t HAS_VALUE  {1 << 0};
+    inline static constexpr uint8_t CRIT       {1 << 1};
+    inline static constexpr uint8_t HAS_THREAT {1 << 2};
+
+    /**
+     * Totals of a group of rows, as kept in the database's Combat_Summary table
+     */
+    struct Totals {
+        std::size_t events {};
+
+        // Rows with a value, and of those the critical ones.
+        std::size_t hits {};
+        std::size_t crits {};
+
+        // Sum of the base values, and of the effective values where given, else the base values.
+        int64_t total {};
+        int64_t effective {};
+
+        int64_t max_hit {};
+        double threat {};
+    };
+
+    EventStore();
+
+    /**
+     * Add a parsed log entry as the next row
+     *
+     * Must be called in log order so that combats are tracked correctly. Names are copied, so the view's line needn't
+     * outlive the call.
+     */
+    auto add(const LogParserTypes::ParsedLogLineView& entry) -> void;
+    auto add(const LogParserTypes::ParsedLogLine& entry) -> void;
+
+    auto size() const -> std::size_t {
+        return m_ts.size();
+    }
+
+    /*
+     * The columns, indexed by row. ts is ms past the epoch. combat is 0 outside of a combat, else an index + 1 into
+     * combats(). value and effective are 0 unless flags() has HAS_VALUE; effective is the base value if the entry
+     * didn't give one. threat is 0 unless flags() has HAS_THREAT.
+     */
+    auto ts() const -> std::span<const int64_t> { return m_ts; }
+    auto combat() const -> std::span<const uint32_t> { return m_combat; }
+    auto source() const -> std::span<const DictId> { return m_source; }
+    auto target() const -> std::span<const DictId> { return m_target; }
+    auto ability() const -> std::span<const DictId> { return m_ability; }
+    auto action() const -> std::span<const DictId> { return m_action; }
+    auto value() const -> std::span<const int64_t> { return m_value; }
+    auto effective() const -> std::span<const int64_t> { return m_effective; }
+    auto value_type() const -> std::span<const DictId> { return m_value_type; }
+    auto threat() const -> std::span<const double> { return m_threat; }
+    auto flags() const -> std::span<const uint8_t> { return m_flags; }
+
+    auto combats() const -> std::span<const CombatInfo> {
+        return m_combats;
+    }
+
+    /*
+     * Dictionary lookups
+     */
+    auto name(DictId id) const -> std::string_view {
+        return m_names[id];
+    }
+    auto actor(DictId id) const -> const ActorInfo& {
+        return m_actors[id];
+    }
+    auto actor_name(DictId id) const -> std::string_view {
+        return name(m_actors[id].name);
+    }
+    auto action_info(DictId id) const -> const ActionInfo& {
+        return m_actions[id];
+    }
+
+    /**
+     * Dictionary ID of the name with the given ID from the log
+     *
+     * @return The ID, or NOT_APPLICABLE if no entry added has used the name.
+     */
+    auto find_name(uint64_t log_id) const -> DictId;
+
+    /**
+     * Every row
+     */
+    auto all() const -> Selection;
+
+    /**
+     * The rows added during a combat
+     *
+     * @param[in] combat Index + 1 into combats(), as in the combat() column
+     */
+    auto rows_of_combat(uint32_t combat) const -> Selection;
+
+    /**
+     * The rows of `rows` for which `keep(row)` is true
+     */
+    template <typename Pred>
+    auto filter(const Selection& rows, Pred&& keep) const -> Selection {
+        Selection kept;
+        for (const auto row : rows) {
+            if (keep(row)) {
+                kept.push_back(row);
+            }
+        }
+        return kept;
+    }
+
+    /**
+     * The rows of the whole store for which `keep(row)` is true
+     */
+    template <typename Pred>
+    auto filter(Pred&& keep) const -> Selection {
+        Selection kept;
+        for (uint32_t row = 0; row < size(); row++) {
+            if (keep(row)) {
+                kept.push_back(row);
+            }
+        }
+        return kept;
+    }
+
+    /**
+     * Call `visit(row)` for each row of `rows`, in order
+     */
+    template <typename Visit>
+    auto scan(const Selection& rows, Visit&& visit) const -> void {
+        for (const auto row : rows) {
+            visit(row);
+        }
+    }
+
+    /**
+     * Total the rows of `rows` by the key `key_of(row)` returns
+     *
+     * @tparam KeyFn Returns a key hashable by LocalDbCacheHash, e.g. a DictId or a std::tuple of them
+     */
+    template <typename KeyFn>
+    auto group_by(const Selection& rows, KeyFn&& key_of) const {
+        using Key = std::decay_t<std::invoke_result_t<KeyFn&, uint32_t>>;
+        std::unordered_map<Key, Totals, LocalDbCacheHash<Key>> groups;
+        for (const auto row : rows) {
+            add_to_totals(groups[key_of(row)], row);
+        }
+        return groups;
+    }
+
+    /**
+     * Total all of `rows`
+     */
+    auto totals(const Selection& rows) const -> Totals;
+
+  private:
+    auto add_to_totals(Totals& totals, uint32_t row) const -> void;
+
+    auto intern_name(uint64_t log_id, std::string_view name) -> DictId;
+    auto intern_actor(const LogParserTypes::ActorView& actor) -> DictId;
+
+    // Columns
+    std::vector<int64_t> m_ts;
+    std::vector<uint32_t> m_combat;
+    std::vector<DictId> m_source;
+    std::vector<DictId> m_target;
+    std::vector<DictId> m_ability;
+    std::vector<DictId> m_action;
+    std::vector<int64_t> m_value;
+    std::vector<int64_t> m_effective;
+    std::vector<DictId> m_value_type;
+    std::vector<double> m_threat;
+    std::vector<uint8_t> m_flags;
+
+    // Dictionaries. Each vector is indexed by DictId; the maps find the ID of a key.
+    std::vector<std::string> m_names;
+    std::unordered_map<uint64_t, DictId> m_name_ids;
+
+    std::vector<ActorInfo> m_actors;
+    // key: type, name's log ID, instance, owning PC name's log ID
+    std::unordered_map<std::tuple<ActorType, uint64_t, uint64_t, uint64_t>, DictId,
+                       LocalDbCacheHash<std::tuple<ActorType, uint64_t, uint64_t, uint64_t>>> m_actor_ids;
+
+    std::vector<ActionInfo> m_actions;
+    // key: verb, noun, and detail log IDs; 0 for no detail
+    std::unordered_map<std::tuple<uint64_t, uint64_t, uint64_t>, DictId,
+                       LocalDbCacheHash<std::tuple<uint64_t, uint64_t, uint64_t>>> m_action_ids;
+
+    std::vector<CombatInfo> m_combats;
+    bool m_in_combat {false};
+};
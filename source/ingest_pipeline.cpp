@@ -0,0 +1,92 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <algorithm>
+#include <exception>
+#include <optional>
+#include <thread>
+
+#include "ingest_pipeline.hpp"
+#include "log_file_source.hpp"
+#include "log_parser.hpp"
+#include "logging.hpp"
+#include "spsc_queue.hpp"
+
+namespace sc = std::chrono;
+
+IngestPipeline::IngestPipeline(Options options) : m_options(options) {
+    m_options.batch_lines = std::max<std::size_t>(m_options.batch_lines, 1);
+    m_options.queue_batches = std::max<std::size_t>(m_options.queue_batches, 1);
+}
+
+auto IngestPipeline::run(std::string_view contents, Timestamps& ts_parser, const Writer& write) const -> Stats {
+    SpscQueue<Batch> queue {m_options.queue_batches};
+    Stats stats;
+    std::exception_ptr parse_error;
+
+    // The parser only touches the queue's producer side, `ts_parser`, and these until it's joined.
+    sc::nanoseconds parse_elapsed {};
+    auto parse = [&] {
+        const auto start = sc::steady_clock::now();
+        try {
+            LogParser lp;
+            Batch batch;
+            batch.reserve(m_options.batch_lines);
+            for (const auto& line : LogFileSource::lines(contents, m_options.first_line_num, 0)) {
+                stats.lines = line.line_num;
+                if (line.text.empty()) {
+                    continue;
+                }
+                auto parsed = lp.parse_line(line.text, line.line_num, ts_parser);
+                if (!parsed) {
+                    ++stats.failed_lines;
+                    continue;
+                }
+                ++stats.parsed_lines;
+                batch.push_back(std::move(*parsed));
+                if (batch.size() >= m_options.batch_lines) {
+                    if (!queue.push(std::move(batch))) {
+                        // The writer gave up.
+                        break;
+                    }
+                    batch = Batch {};
+                    batch.reserve(m_options.batch_lines);
+                }
+            }
+            if (!batch.empty()) {
+                queue.push(std::move(batch));
+            }
+        } catch (...) {
+            parse_error = std::current_exception();
+        }
+        queue.close();
+        parse_elapsed = sc::steady_clock::now() - start;
+    };
+
+    std::thread parser {parse};
+    try {
+        while (auto batch = queue.pop()) {
+            const auto start = sc::steady_clock::now();
+            write(*batch);
+            stats.write_busy += sc::steady_clock::now() - start;
+            ++stats.batches;
+        }
+    } catch (...) {
+        BLT(debug) << "Writer failed. Stopping the parser.";
+        queue.close();
+        parser.join();
+        throw;
+    }
+    parser.join();
+
+    const auto& qs = queue.stats();
+    stats.parse_stall = qs.push_stall;
+    stats.parse_busy = parse_elapsed - qs.push_stall;
+    stats.write_stall = qs.pop_stall;
+    stats.mean_queue_occupancy = qs.mean_occupancy();
+    stats.max_queue_occupancy = qs.max_occupancy;
+    stats.queue_capacity = queue.capacity();
+
+    if (parse_error) {
+        std::rethrow_exception(parse_error);
+    }
+    return stats;
+}
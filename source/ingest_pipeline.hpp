@@ -0,0 +1,79 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "log_parser_types.hpp"
+#include "timestamps.hpp"
+
+/**
+ * Parses a log on one thread while another writes the parsed lines out
+ *
+ * A parser thread parses the log into batches of lines and hands them to the writer over a bounded SpscQueue. The
+ * writer runs on the thread that calls run(), so whatever it writes to (e.g. a DbPopulator and its connection) needn't
+ * be shared between threads. When the writer falls behind the queue fills and the parser waits, so at most
+ * queue_batches batches are ever in flight.
+ */
+class IngestPipeline {
+public:
+    using Batch = std::vector<LogParserTypes::ParsedLogLine>;
+
+    /**
+     * Called on the run() thread with each batch of parsed lines, in log order
+     */
+    using Writer = std::function<void(Batch& batch)>;
+
+    struct Options {
+        // Parsed lines per batch.
+        std::size_t batch_lines {256};
+
+        // Most batches queued between the parser and the writer.
+        std::size_t queue_batches {8};
+
+        // Line number of the first line of the contents given to run(), for when it's part of a log.
+        int first_line_num {1};
+    };
+
+    struct Stats {
+        // Number of the last line read, and of the non-blank lines that did and didn't parse.
+        int lines {};
+        std::size_t parsed_lines {};
+        std::size_t failed_lines {};
+        std::size_t batches {};
+
+        // Time each stage spent working, and waiting on the other: the parser for room in the queue, the writer for a
+        // batch.
+        std::chrono::nanoseconds parse_busy {};
+        std::chrono::nanoseconds parse_stall {};
+        std::chrono::nanoseconds write_busy {};
+        std::chrono::nanoseconds write_stall {};
+
+        // Batches queued when the writer took one, including that one.
+        double mean_queue_occupancy {};
+        std::size_t max_queue_occupancy {};
+        std::size_t queue_capacity {};
+    };
+
+    explicit IngestPipeline(Options options);
+    IngestPipeline() : IngestPipeline(Options {}) {
+    }
+
+    /**
+     * Parse every non-blank line of a log and write them out
+     *
+     * If the writer throws, the parser is stopped and the exception is rethrown once it has. If parsing throws, the
+     * batches already parsed are written and then the exception is rethrown.
+     *
+     * @param[in] contents The log, e.g. LogFileSource::contents(), or the part of it starting with line first_line_num
+     * @param[in,out] ts_parser The log's timestamps. Only the parser thread uses it until run() returns.
+     * @param[in] write Called with each batch
+     */
+    auto run(std::string_view contents, Timestamps& ts_parser, const Writer& write) const -> Stats;
+
+private:
+    Options m_options;
+};
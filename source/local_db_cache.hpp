@@ -0,0 +1,403 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * Hash used by LocalDbCache
+ *
+ * std::hash, extended to std::tuple so that the composite keys of the dimension tables can be used directly.
+ */
+template <typename T>
+struct LocalDbCacheHash {
+    auto operator()(const T& v) const noexcept -> std::size_t {
+        return std::hash<T>{}(v);
+    }
+};
+
+template <typename... T>
+struct LocalDbCacheHash<std::tuple<T...>> {
+    auto operator()(const std::tuple<T...>& v) const noexcept -> std::size_t {
+        std::size_t h {};
+        std::apply([&h] (const auto&... elem) {
+            ((h ^= LocalDbCacheHash<std::decay_t<decltype(elem)>>{}(elem) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)),
+             ...);
+        }, v);
+        return h;
+    }
+};
+
+/**
+ * Counters kept by each LocalDbCache
+ */
+struct LocalDbCacheStats {
+    std::string name;
+
+    // Lookups answered from the cache.
+    std::size_t hits {};
+
+    // Lookups that had to go to the database.
+    std::size_t misses {};
+
+    // Misses that weren't in the database either, so a row was written through.
+    std::size_t inserts {};
+
+    // Entries dropped to stay within the capacity.
+    std::size_t evictions {};
+
+    // Entries added with preload() that were later hit. Each is a database lookup that was saved.
+    std::size_t preloaded_hits {};
+
+    // Entries currently cached.
+    std::size_t size {};
+};
+
+/**
+ * A read-through/write-through cache of database row IDs
+ *
+ * This is the cache strategy from docs/notes.txt: check the cache, then check the database, then insert into the
+ * database, caching whatever row ID results. get() implements it given the lookup and insert steps.
+ *
+ * Entries live in a flat, open-addressed hash table (linear probing, power-of-two size) rather than a node-based map.
+ * If a capacity is given, the least-recently used entry is evicted to make room for a new one; otherwise the cache
+ * grows without bound.
+ *
+ * References returned by operator[]() and put() are invalidated by any later insertion.
+ *
+ * @tparam Key Hashable, equality-comparable, default-constructible key
+ * @tparam Value Default-constructible cached value, typically a row ID
+ */
+template <typename Key, typename Value, typename Hash = LocalDbCacheHash<Key>>
+class LocalDbCache {
+  public:
+    /**
+     * @param[in] name Name reported with the statistics
+     * @param[in] capacity Maximum number of entries, 0 for unbounded
+     */
+    explicit LocalDbCache(std::string name, std::size_t capacity = 0)
+        : m_capacity(capacity) {
+        m_stats.name = std::move(name);
+    }
+
+    /**
+     * Look up a key, counting a hit or miss
+     *
+     * @return Pointer to the cached value, or nullptr. Invalidated by any later insertion.
+     */
+    auto find(const Key& key) -> Value* {
+        auto idx = find_index(key);
+        if (idx == NPOS) {
+            ++m_stats.misses;
+            return nullptr;
+        }
+        ++m_stats.hits;
+        auto& slot = m_slots[idx];
+        if (slot.preloaded) {
+            slot.preloaded = false;
+            ++m_stats.preloaded_hits;
+        }
+        touch(idx);
+        return &slot.value;
+    }
+
+    /**
+     * Look up a key without affecting the statistics or the LRU order
+     */
+    auto peek(const Key& key) const -> const Value* {
+        auto idx = find_index(key);
+        return idx == NPOS ? nullptr : &m_slots[idx].value;
+    }
+
+    auto contains(const Key& key) const -> bool {
+        return find_index(key) != NPOS;
+    }
+
+    /**
+     * Read-through/write-through lookup
+     *
+     * @param[in] key Key to look up
+     * @param[in] lookup Callable returning std::optional<Value>; called on a cache miss to find an existing row
+     * @param[in] insert Callable returning Value; called when `lookup` finds nothing, to add the row
+     *
+     * @return The cached, found, or inserted value
+     */
+    template <typename Lookup, typename Insert>
+    auto get(const Key& key, Lookup&& lookup, Insert&& insert) -> Value {
+        if (const auto* cached = find(key)) {
+            return *cached;
+        }
+        std::optional<Value> value = std::forward<Lookup>(lookup)();
+        if (!value) {
+            value = std::forward<Insert>(insert)();
+            ++m_stats.inserts;
+        }
+        put(key, *value);
+        return *value;
+    }
+
+    /**
+     * Cache a value, replacing any existing value for the key
+     */
+    auto put(const Key& key, Value value) -> Value& {
+        auto idx = find_index(key);
+        if (idx == NPOS) {
+            idx = emplace(key, std::move(value));
+        } else {
+            m_slots[idx].value = std::move(value);
+            touch(idx);
+        }
+        return m_slots[idx].value;
+    }
+
+    /**
+     * Cache a value loaded ahead of time
+     *
+     * Like put(), but the first hit on the entry is counted in LocalDbCacheStats::preloaded_hits.
+     */
+    auto preload(const Key& key, Value value) -> void {
+        auto idx = find_index(key);
+        if (idx == NPOS) {
+            idx = emplace(key, std::move(value));
+        } else {
+            m_slots[idx].value = std::move(value);
+        }
+        m_slots[idx].preloaded = true;
+    }
+
+    /**
+     * Access the value for a key, default-constructing it if absent
+     *
+     * Doesn't count as a hit or miss.
+     */
+    auto operator[](const Key& key) -> Value& {
+        auto idx = find_index(key);
+        if (idx == NPOS) {
+            return m_slots[emplace(key, Value{})].value;
+        }
+        touch(idx);
+        return m_slots[idx].value;
+    }
+
+    /**
+     * Call `f(key, value)` for each entry that's been cached by use rather than by preload()
+     *
+     * Preloaded entries are skipped until they're first found. Doesn't affect the statistics or the LRU order.
+     */
+    template <typename F>
+    auto for_each_used(F&& f) const -> void {
+        for (const auto& slot : m_slots) {
+            if (slot.state == SlotState::FULL && !slot.preloaded) {
+                f(slot.key, slot.value);
+            }
+        }
+    }
+
+    auto size() const -> std::size_t {
+        return m_size;
+    }
+
+    auto capacity() const -> std::size_t {
+        return m_capacity;
+    }
+
+    auto stats() const -> LocalDbCacheStats {
+        auto s = m_stats;
+        s.size = m_size;
+        return s;
+    }
+
+    auto clear() -> void {
+        m_slots.clear();
+        m_size = 0;
+        m_tombstones = 0;
+        m_head = NPOS;
+        m_tail = NPOS;
+    }
+
+  private:
+    static constexpr uint32_t NPOS {UINT32_MAX};
+    static constexpr std::size_t MIN_SLOTS {16};
+
+    enum class SlotState : uint8_t { EMPTY, FULL, TOMBSTONE };
+
+    struct Slot {
+        Key key {};
+        Value value {};
+        // LRU list links, only maintained when the capacity is bounded. m_head is the most recently used.
+        uint32_t prev {NPOS};
+        uint32_t next {NPOS};
+        SlotState state {SlotState::EMPTY};
+        bool preloaded {false};
+    };
+
+    auto bounded() const -> bool {
+        return m_capacity > 0;
+    }
+
+    // The standard library hashes integers to themselves, which clusters badly under a power-of-two mask. Mix the
+    // bits (the splitmix64 finalizer) before masking.
+    static auto mix(std::size_t h) -> std::size_t {
+        uint64_t x = h;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<std::size_t>(x ^ (x >> 31));
+    }
+
+    auto home(const Key& key) const -> std::size_t {
+        return mix(Hash{}(key)) & (m_slots.size() - 1);
+    }
+
+    auto find_index(const Key& key) const -> uint32_t {
+        if (m_slots.empty()) {
+            return NPOS;
+        }
+        const auto mask = m_slots.size() - 1;
+        for (auto i = home(key); ; i = (i + 1) & mask) {
+            const auto& slot = m_slots[i];
+            if (slot.state == SlotState::EMPTY) {
+                return NPOS;
+            }
+            if (slot.state == SlotState::FULL && slot.key == key) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+    }
+
+    // Add a key known to be absent. Returns its slot index.
+    auto emplace(const Key& key, Value value) -> uint32_t {
+        if (bounded() && m_size >= m_capacity) {
+            evict_lru();
+        }
+        // Keep the load, tombstones included, under 70% so probe sequences stay short and always end.
+        if ((m_size + m_tombstones + 1) * 10 > m_slots.size() * 7) {
+            rehash();
+        }
+
+        const auto mask = m_slots.size() - 1;
+        auto i = home(key);
+        while (m_slots[i].state == SlotState::FULL) {
+            i = (i + 1) & mask;
+        }
+        auto& slot = m_slots[i];
+        if (slot.state == SlotState::TOMBSTONE) {
+            --m_tombstones;
+        }
+        slot.key = key;
+        slot.value = std::move(value);
+        slot.state = SlotState::FULL;
+        slot.preloaded = false;
+        ++m_size;
+
+        const auto idx = static_cast<uint32_t>(i);
+        if (bounded()) {
+            link_front(idx);
+        }
+        return idx;
+    }
+
+    auto evict_lru() -> void {
+        const auto idx = m_tail;
+        unlink(idx);
+        auto& slot = m_slots[idx];
+        slot.state = SlotState::TOMBSTONE;
+        slot.key = Key{};
+        slot.value = Value{};
+        --m_size;
+        ++m_tombstones;
+        ++m_stats.evictions;
+    }
+
+    // Rebuild the table, sized for the live entries, dropping tombstones. The LRU order is preserved.
+    auto rehash() -> void {
+        auto old = std::move(m_slots);
+        const auto old_tail = m_tail;
+        m_slots.assign(std::max(MIN_SLOTS, std::bit_ceil((m_size + 1) * 2)), Slot{});
+        m_size = 0;
+        m_tombstones = 0;
+        m_head = NPOS;
+        m_tail = NPOS;
+
+        auto reinsert = [this] (Slot& from) {
+            const auto mask = m_slots.size() - 1;
+            auto i = home(from.key);
+            while (m_slots[i].state == SlotState::FULL) {
+                i = (i + 1) & mask;
+            }
+            auto& slot = m_slots[i];
+            slot.key = std::move(from.key);
+            slot.value = std::move(from.value);
+            slot.state = SlotState::FULL;
+            slot.preloaded = from.preloaded;
+            ++m_size;
+            if (bounded()) {
+                link_front(static_cast<uint32_t>(i));
+            }
+        };
+
+        if (bounded()) {
+            // Oldest first, so that the most recently used ends up at the head again.
+            for (auto idx = old_tail; idx != NPOS; idx = old[idx].prev) {
+                reinsert(old[idx]);
+            }
+        } else {
+            for (auto& slot : old) {
+                if (slot.state == SlotState::FULL) {
+                    reinsert(slot);
+                }
+            }
+        }
+    }
+
+    auto touch(uint32_t idx) -> void {
+        if (bounded() && idx != m_head) {
+            unlink(idx);
+            link_front(idx);
+        }
+    }
+
+    auto link_front(uint32_t idx) -> void {
+        auto& slot = m_slots[idx];
+        slot.prev = NPOS;
+        slot.next = m_head;
+        if (m_head != NPOS) {
+            m_slots[m_head].prev = idx;
+        }
+        m_head = idx;
+        if (m_tail == NPOS) {
+            m_tail = idx;
+        }
+    }
+
+    auto unlink(uint32_t idx) -> void {
+        auto& slot = m_slots[idx];
+        if (slot.prev != NPOS) {
+            m_slots[slot.prev].next = slot.next;
+        } else {
+            m_head = slot.next;
+        }
+        if (slot.next != NPOS) {
+            m_slots[slot.next].prev = slot.prev;
+        } else {
+            m_tail = slot.prev;
+        }
+        slot.prev = NPOS;
+        slot.next = NPOS;
+    }
+
+    std::size_t m_capacity {};
+    std::vector<Slot> m_slots;
+    std::size_t m_size {};
+    std::size_t m_tombstones {};
+    uint32_t m_head {NPOS};
+    uint32_t m_tail {NPOS};
+    LocalDbCacheStats m_stats;
+};
@@ -0,0 +1,132 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_file_source.hpp"
+#include "logging.hpp"
+
+namespace {
+    // Closes the descriptor when it goes out of scope. A mapping outlives its descriptor.
+    struct FdCloser {
+        int fd;
+        ~FdCloser() {
+            ::close(fd);
+        }
+    };
+
+    auto read_all(int fd, std::string& buffer) -> bool {
+        constexpr std::size_t CHUNK {1 << 16};
+        for (;;) {
+            const auto old_size = buffer.size();
+            buffer.resize(old_size + CHUNK);
+            const auto n = ::read(fd, buffer.data() + old_size, CHUNK);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    buffer.resize(old_size);
+                    continue;
+                }
+                return false;
+            }
+            buffer.resize(old_size + static_cast<std::size_t>(n));
+            if (n == 0) {
+                return true;
+            }
+        }
+    }
+} // namespace
+
+auto LogFileSource::open(const std::string& path, Mode mode) -> std::optional<LogFileSource> {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        BLT(error) << "Unable to open " << std::quoted(path) << ": " << std::strerror(errno);
+        return {};
+    }
+    FdCloser closer {fd};
+
+    LogFileSource src;
+
+    struct stat st {};
+    if (mode == Mode::MMAP && ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        const auto size = static_cast<std::size_t>(st.st_size);
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // Logs are parsed front to back, once.
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+            src.m_data = static_cast<const char*>(addr);
+            src.m_size = size;
+            src.m_mapped = true;
+            return src;
+        }
+        BLT(warning) << "Unable to mmap " << std::quoted(path) << ": " << std::strerror(errno) << ". Reading instead.";
+    }
+
+    if (mode == Mode::READ && ::fstat(fd, &st) == 0 && st.st_size > 0) {
+        src.m_buffer.reserve(static_cast<std::size_t>(st.st_size));
+    }
+    if (!read_all(fd, src.m_buffer)) {
+        BLT(error) << "Unable to read " << std::quoted(path) << ": " << std::strerror(errno);
+        return {};
+    }
+    src.m_data = src.m_buffer.data();
+    src.m_size = src.m_buffer.size();
+    return src;
+}
+
+LogFileSource::LogFileSource(LogFileSource&& other) noexcept {
+    *this = std::move(other);
+}
+
+auto LogFileSource::operator=(LogFileSource&& other) noexcept -> LogFileSource& {
+    if (this != &other) {
+        release();
+        m_mapped = std::exchange(other.m_mapped, false);
+        m_size = std::exchange(other.m_size, 0);
+        m_buffer = std::move(other.m_buffer);
+        // A moved std::string may have had its characters in the small-string buffer, so point into our own copy.
+        m_data = m_mapped ? std::exchange(other.m_data, nullptr) : m_buffer.data();
+        other.m_data = nullptr;
+        other.m_buffer.clear();
+    }
+    return *this;
+}
+
+LogFileSource::~LogFileSource() {
+    release();
+}
+
+auto LogFileSource::release() -> void {
+    if (m_mapped && m_data != nullptr) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+}
+
+auto LogFileSource::find_line_end(std::string_view data, std::size_t pos) -> std::size_t {
+    // memchr is vectorized in any libc worth using; it's much faster than a byte loop or getline().
+    const auto* nl = static_cast<const char*>(std::memchr(data.data() + pos, '\n', data.size() - pos));
+    return nl == nullptr ? data.size() : static_cast<std::size_t>(nl - data.data());
+}
+
+auto LogFileSource::lines() const -> Generator<LogLine> {
+    return lines(contents(), 1, 0);
+}
+
+auto LogFileSource::lines(std::string_view data, int first_line_num, uint64_t first_offset) -> Generator<LogLine> {
+    std::size_t pos {};
+    int line_num {first_line_num};
+    while (pos < data.size()) {
+        const auto end = find_line_end(data, pos);
+        co_yield LogLine {chomp(data.substr(pos, end - pos)), line_num++, first_offset + pos};
+        pos = end + 1;
+    }
+}
@@ -0,0 +1,111 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "generator.hpp"
+
+/**
+ * One line of a combat log, as produced by LogFileSource::lines()
+ */
+struct LogLine {
+    // The line without its terminating LF or CRLF. A view into the LogFileSource's contents.
+    std::string_view text;
+
+    // 1-based line number, for logging.
+    int line_num {};
+
+    // Offset of the start of the line from the start of the file.
+    uint64_t offset {};
+};
+
+/**
+ * The contents of a combat log, read in one go
+ *
+ * The file is memory mapped if possible. If it can't be mapped - it's empty, not a regular file, or mmap() fails - it
+ * is read into a buffer instead. Either way the lines are handed out as views into the contents, so nothing is copied
+ * per line. The views are valid for the lifetime of the LogFileSource.
+ */
+class LogFileSource {
+public:
+    enum class Mode {
+        MMAP, // mmap() the file, falling back to READ if that fails.
+        READ, // read() the whole file into a buffer.
+    };
+
+    /**
+     * Open and map or read a logfile
+     *
+     * @return The source, or an empty optional if the file can't be opened or read. The error is logged.
+     */
+    static auto open(const std::string& path, Mode mode = Mode::MMAP) -> std::optional<LogFileSource>;
+
+    LogFileSource(const LogFileSource&) = delete;
+    auto operator=(const LogFileSource&) -> LogFileSource& = delete;
+    LogFileSource(LogFileSource&& other) noexcept;
+    auto operator=(LogFileSource&& other) noexcept -> LogFileSource&;
+    ~LogFileSource();
+
+    /**
+     * The whole file
+     */
+    auto contents() const -> std::string_view {
+        return {m_data, m_size};
+    }
+
+    /**
+     * true if the contents are memory mapped rather than read into a buffer
+     */
+    auto is_mapped() const -> bool {
+        return m_mapped;
+    }
+
+    /**
+     * Each line of the file in order, blank lines included
+     *
+     * Lines may end in LF or CRLF, and the last line needn't end in either.
+     */
+    auto lines() const -> Generator<LogLine>;
+
+    /**
+     * Each line of `data`, which must begin at the start of a line
+     *
+     * @param[in] data Part of a log's contents
+     * @param[in] first_line_num Line number of the first line in `data`
+     * @param[in] first_offset Offset of `data` from the start of the file
+     */
+    static auto lines(std::string_view data, int first_line_num, uint64_t first_offset) -> Generator<LogLine>;
+
+    /**
+     * Find the end of the line starting at `pos`
+     *
+     * @return Index of the line's LF, or data.size() if the last line isn't terminated.
+     */
+    static auto find_line_end(std::string_view data, std::size_t pos) -> std::size_t;
+
+    /**
+     * Strip a line's trailing CR, if any
+     */
+    static auto chomp(std::string_view line) -> std::string_view {
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        return line;
+    }
+
+private:
+    LogFileSource() = default;
+
+    auto release() -> void;
+
+    const char* m_data {nullptr};
+    std::size_t m_size {};
+    bool m_mapped {false};
+
+    // Holds the contents when they're read rather than mapped.
+    std::string m_buffer;
+};
@@ -0,0 +1,178 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_follower.hpp"
+#include "logging.hpp"
+
+namespace sc = std::chrono;
+
+namespace {
+    // Without inotify, check the file this often.
+    constexpr sc::milliseconds POLL_INTERVAL {50};
+} // namespace
+
+auto LogFollower::open(const std::string& path, uint64_t offset, int line_num) -> std::optional<LogFollower> {
+    LogFollower lf;
+    lf.m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lf.m_fd < 0) {
+        BLT(error) << "Unable to open " << std::quoted(path) << ": " << std::strerror(errno);
+        return {};
+    }
+
+    struct stat st {};
+    char before = '\n';
+    if (::fstat(lf.m_fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < offset ||
+        (offset > 0 && ::pread(lf.m_fd, &before, 1, static_cast<off_t>(offset - 1)) != 1) || before != '\n') {
+        BLT(error) << "Offset " << offset << " isn't the start of a line in " << std::quoted(path) << ".";
+        return {};
+    }
+    lf.m_offset = offset;
+    lf.m_line_num = line_num;
+
+    lf.m_inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (lf.m_inotify_fd >= 0 &&
+        ::inotify_add_watch(lf.m_inotify_fd, path.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF) < 0) {
+        ::close(lf.m_inotify_fd);
+        lf.m_inotify_fd = -1;
+    }
+    if (lf.m_inotify_fd < 0) {
+        BLT(warning) << "Unable to watch " << std::quoted(path) << " with inotify: " << std::strerror(errno)
+                     << ". Polling instead.";
+    }
+    return lf;
+}
+
+LogFollower::LogFollower(LogFollower&& other) noexcept {
+    *this = std::move(other);
+}
+
+auto LogFollower::operator=(LogFollower&& other) noexcept -> LogFollower& {
+    if (this != &other) {
+        release();
+        m_fd = std::exchange(other.m_fd, -1);
+        m_inotify_fd = std::exchange(other.m_inotify_fd, -1);
+        m_offset = other.m_offset;
+        m_line_num = other.m_line_num;
+        m_buffer = std::move(other.m_buffer);
+        m_handed_out = std::exchange(other.m_handed_out, 0);
+        m_finished = other.m_finished;
+    }
+    return *this;
+}
+
+LogFollower::~LogFollower() {
+    release();
+}
+
+auto LogFollower::release() -> void {
+    if (m_inotify_fd >= 0) {
+        ::close(m_inotify_fd);
+        m_inotify_fd = -1;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+auto LogFollower::next(sc::milliseconds timeout) -> Chunk {
+    // The lines handed out last time are done with.
+    m_buffer.erase(0, m_handed_out);
+    m_handed_out = 0;
+
+    const auto deadline = sc::steady_clock::now() + timeout;
+    for (;;) {
+        read_appended();
+        if (const auto last_lf = m_buffer.rfind('\n'); last_lf != std::string::npos) {
+            m_handed_out = last_lf + 1;
+            const Chunk chunk {std::string_view(m_buffer).substr(0, m_handed_out), m_line_num + 1, m_offset};
+            m_offset += m_handed_out;
+            m_line_num += static_cast<int>(std::count(chunk.text.begin(), chunk.text.end(), '\n'));
+            return chunk;
+        }
+
+        const auto now = sc::steady_clock::now();
+        if (m_finished || now >= deadline) {
+            break;
+        }
+        if (!wait_for_change(sc::ceil<sc::milliseconds>(deadline - now))) {
+            break;
+        }
+    }
+    return Chunk {.text = {}, .first_line_num = m_line_num + 1, .offset = m_offset};
+}
+
+auto LogFollower::read_appended() -> bool {
+    constexpr std::size_t CHUNK {1 << 16};
+    bool appended {false};
+    for (;;) {
+        const auto old_size = m_buffer.size();
+        m_buffer.resize(old_size + CHUNK);
+        const auto n = ::pread(m_fd, m_buffer.data() + old_size, CHUNK, static_cast<off_t>(m_offset + old_size));
+        m_buffer.resize(old_size + static_cast<std::size_t>(std::max<ssize_t>(n, 0)));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        appended = true;
+    }
+
+    struct stat st {};
+    if (!m_finished && ::fstat(m_fd, &st) == 0) {
+        if (static_cast<uint64_t>(st.st_size) < m_offset + m_buffer.size()) {
+            BLT(warning) << "Logfile was truncated. No longer following it.";
+            m_finished = true;
+        } else if (st.st_nlink == 0) {
+            // Deleted. Our descriptor keeps it from being freed, so there's no IN_DELETE_SELF; the link count change
+            // raised IN_ATTRIB.
+            BLT(info) << "Logfile was deleted. No longer following it.";
+            m_finished = true;
+        }
+    }
+    return appended;
+}
+
+auto LogFollower::wait_for_change(sc::milliseconds timeout) -> bool {
+    if (m_inotify_fd < 0) {
+        return ::poll(nullptr, 0, static_cast<int>(std::min(timeout, POLL_INTERVAL).count())) >= 0;
+    }
+
+    pollfd pfd {.fd = m_inotify_fd, .events = POLLIN, .revents = 0};
+    const auto ready = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+    if (ready < 0) {
+        return false;
+    }
+    if (ready == 0) {
+        return true;
+    }
+
+    // Drain the events. Appends and deletion are picked up by the next read; only a move needs handling here.
+    alignas(inotify_event) char events[4096];
+    for (;;) {
+        const auto n = ::read(m_inotify_fd, events, sizeof(events));
+        if (n <= 0) {
+            break;
+        }
+        for (ssize_t pos = 0; pos < n; ) {
+            const auto* ev = reinterpret_cast<const inotify_event*>(events + pos);
+            if ((ev->mask & IN_MOVE_SELF) != 0) {
+                BLT(info) << "Logfile was moved. No longer following it.";
+                m_finished = true;
+            }
+            pos += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,102 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * Reads the lines appended to a combat log while the game is still writing it
+ *
+ * Each call to next() returns the complete lines written since the last call. A line is complete once its LF has been
+ * written; a partial line at the end of the file is held back until the rest of it arrives. next() waits for the file
+ * to change with inotify, so new lines are seen as soon as the game writes them. If inotify isn't available it polls.
+ */
+class LogFollower {
+public:
+    /**
+     * Lines appended to the log, as returned by next()
+     */
+    struct Chunk {
+        // Complete lines, each ending with LF. Empty if there were none. Valid until the next call to next().
+        std::string_view text;
+
+        // Line number of the first line of `text`.
+        int first_line_num {};
+
+        // Offset of `text` from the start of the file.
+        uint64_t offset {};
+    };
+
+    /**
+     * Start following a logfile
+     *
+     * @param[in] path The logfile
+     * @param[in] offset Where to start reading; must be 0 or just past a LF, e.g. DbPopulator::ResumePoint::offset
+     * @param[in] line_num Number of the line that ends at `offset`; 0 if `offset` is 0
+     *
+     * @return The follower, or an empty optional if the file can't be opened or `offset` isn't the start of a line in
+     *     it. The error is logged.
+     */
+    static auto open(const std::string& path, uint64_t offset = 0, int line_num = 0) -> std::optional<LogFollower>;
+
+    LogFollower(const LogFollower&) = delete;
+    auto operator=(const LogFollower&) -> LogFollower& = delete;
+    LogFollower(LogFollower&& other) noexcept;
+    auto operator=(LogFollower&& other) noexcept -> LogFollower&;
+    ~LogFollower();
+
+    /**
+     * Wait up to `timeout` for complete lines to be appended, and return them
+     *
+     * Returns as soon as there are any, or at once if some were already waiting. A signal also cuts the wait short.
+     */
+    auto next(std::chrono::milliseconds timeout) -> Chunk;
+
+    /**
+     * Offset just past the last complete line returned by next()
+     */
+    auto offset() const -> uint64_t {
+        return m_offset;
+    }
+
+    /**
+     * Number of the last complete line returned by next(); 0 if none
+     */
+    auto line_num() const -> int {
+        return m_line_num;
+    }
+
+    /**
+     * true once the file has been deleted, moved, or truncated. The game never does this to a log it's writing.
+     */
+    auto finished() const -> bool {
+        return m_finished;
+    }
+
+private:
+    LogFollower() = default;
+
+    // Read whatever has been appended since the last read into m_buffer. Returns false if nothing was.
+    auto read_appended() -> bool;
+
+    // Wait for the file to change, or for `timeout`. Returns false if a signal interrupted the wait.
+    auto wait_for_change(std::chrono::milliseconds timeout) -> bool;
+
+    auto release() -> void;
+
+    int m_fd {-1};
+    int m_inotify_fd {-1};
+
+    // m_offset is just past the last complete line handed out. m_buffer holds the first m_handed_out bytes before it,
+    // which are the lines the last next() returned, followed by whatever has been read after it: a partial line, if
+    // any.
+    uint64_t m_offset {};
+    int m_line_num {};
+    std::string m_buffer;
+    std::size_t m_handed_out {};
+
+    bool m_finished {false};
+};
@@ -0,0 +1,205 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+#include "log_index.hpp"
+#include "log_parser.hpp"
+#include "logging.hpp"
+
+namespace {
+    // First line of the sidecar file, with the format version.
+    constexpr std::string_view SIDECAR_HEADER {"swtor_combat_explorer log index 1"};
+
+    constexpr std::string_view KIND_CODES {"CAEX"};
+
+    auto ms_of_day(int64_t ts_ms) -> int64_t {
+        constexpr int64_t MS_PER_DAY {24 * 60 * 60 * 1000};
+        return ((ts_ms % MS_PER_DAY) + MS_PER_DAY) % MS_PER_DAY;
+    }
+} // namespace
+
+LogIndex::LogIndex(int checkpoint_lines)
+    : m_checkpoint_lines(std::max(checkpoint_lines, 1))
+{
+}
+
+auto LogIndex::load_or_build(const std::string& log_path, int checkpoint_lines) -> std::optional<LogIndex> {
+    auto src = LogFileSource::open(log_path);
+    if (!src) {
+        return {};
+    }
+
+    const auto sidecar = sidecar_path(log_path);
+    auto index = load(sidecar);
+    auto saved_line_num = index ? index->m_last_line_num : -1;
+    if (!index || !index->extend(*src, log_path)) {
+        if (index) {
+            BLT(warning) << std::quoted(sidecar) << " doesn't match " << std::quoted(log_path) << ". Rebuilding it.";
+        }
+        saved_line_num = -1;
+        index.emplace(checkpoint_lines);
+        index->extend(*src, log_path);
+    }
+    if (index->m_last_line_num != saved_line_num) {
+        index->save(sidecar);
+    }
+    return index;
+}
+
+auto LogIndex::extend(const LogFileSource& src, const std::string& log_path) -> bool {
+    const auto contents = src.contents();
+
+    Timestamps ts {Timestamps::log_file_creation_time(log_path)};
+    uint64_t start {};
+    int start_line_num {1};
+    if (m_last_line_num > 0) {
+        // The last line indexed must still be there, with the same time.
+        if (m_last_line_offset >= contents.size()) {
+            return false;
+        }
+        const auto rest = contents.substr(m_last_line_offset);
+        const auto time = Timestamps::parse_log_entry_time(rest.substr(1, 12));
+        if (!rest.starts_with('[') || !time || time->count() != ms_of_day(m_last_ts_ms)) {
+            return false;
+        }
+        start = m_last_line_offset;
+        start_line_num = m_last_line_num;
+        ts.resume(Timestamps::timestamp(std::chrono::milliseconds(m_last_ts_ms)));
+    }
+
+    LogParser lp;
+    const auto before = m_last_line_num;
+    for (const auto& ll : LogFileSource::lines(contents.substr(start), start_line_num, start)) {
+        if (ll.text.empty() || ll.line_num <= m_last_line_num) {
+            continue;
+        }
+        if (ll.offset + ll.text.size() == contents.size()) {
+            // Unterminated; the rest of it may be yet to come.
+            break;
+        }
+        if (auto entry = lp.parse_line_view(ll.text, ll.line_num, ts)) {
+            add(ll, *entry);
+        }
+    }
+    BLT(info) << "Indexed lines " << before + 1 << " to " << m_last_line_num << " of " << std::quoted(log_path);
+    return true;
+}
+
+auto LogIndex::add(const LogLine& line, const LogParserTypes::ParsedLogLineView& entry) -> void {
+    if (line.line_num <= m_last_line_num) {
+        return;
+    }
+
+    const auto ts_ms = Timestamps::timestamp_to_ms_past_epoch(entry.ts);
+    if (entry.action.verb.id == LogParserTypes::AREA_ENTERED_ID) {
+        add_mark(Kind::AREA_ENTERED, line, ts_ms);
+    } else if (entry.action.noun.id == LogParserTypes::ENTER_COMBAT_ID) {
+        add_mark(Kind::ENTER_COMBAT, line, ts_ms);
+    } else if (entry.action.noun.id == LogParserTypes::EXIT_COMBAT_ID) {
+        add_mark(Kind::EXIT_COMBAT, line, ts_ms);
+    } else if (line.line_num - m_last_checkpoint_line_num >= m_checkpoint_lines) {
+        add_mark(Kind::CHECKPOINT, line, ts_ms);
+    }
+
+    m_last_line_offset = line.offset;
+    m_last_line_num = line.line_num;
+    m_last_ts_ms = ts_ms;
+}
+
+auto LogIndex::add_mark(Kind kind, const LogLine& line, int64_t ts_ms) -> void {
+    m_marks.push_back(Mark {.kind = kind, .offset = line.offset, .line_num = line.line_num, .ts_ms = ts_ms});
+    // Any mark will do to resume from, so the next checkpoint is counted from here.
+    m_last_checkpoint_line_num = line.line_num;
+}
+
+auto LogIndex::combat_count() const -> std::size_t {
+    return static_cast<std::size_t>(std::count_if(m_marks.begin(), m_marks.end(), [] (const Mark& m) {
+        return m.kind == Kind::ENTER_COMBAT;
+    }));
+}
+
+auto LogIndex::find_combat(std::size_t combat) const -> std::optional<CombatRange> {
+    if (combat == 0) {
+        return {};
+    }
+    std::size_t seen {};
+    for (auto it = m_marks.begin(); it != m_marks.end(); ++it) {
+        if (it->kind != Kind::ENTER_COMBAT || ++seen < combat) {
+            continue;
+        }
+        CombatRange range {.enter = *it, .exit = {}};
+        for (auto next = std::next(it); next != m_marks.end() && next->kind != Kind::ENTER_COMBAT; ++next) {
+            if (next->kind == Kind::EXIT_COMBAT) {
+                range.exit = *next;
+                break;
+            }
+        }
+        return range;
+    }
+    return {};
+}
+
+auto LogIndex::seek(int64_t ts_ms) const -> std::optional<Mark> {
+    // Marks are in log order, and so in time order.
+    const auto it = std::upper_bound(m_marks.begin(), m_marks.end(), ts_ms, [] (int64_t t, const Mark& m) {
+        return t < m.ts_ms;
+    });
+    if (it == m_marks.begin()) {
+        return {};
+    }
+    return *std::prev(it);
+}
+
+auto LogIndex::save(const std::string& path) const -> bool {
+    std::ofstream out(path, std::ios::trunc);
+    out << SIDECAR_HEADER << "\n"
+        << "checkpoint_lines " << m_checkpoint_lines << "\n"
+        << "last " << m_last_line_offset << " " << m_last_line_num << " " << m_last_ts_ms << "\n"
+        << "marks " << m_marks.size() << "\n";
+    for (const auto& m : m_marks) {
+        out << KIND_CODES[static_cast<std::size_t>(m.kind)] << " " << m.offset << " " << m.line_num << " " << m.ts_ms
+            << "\n";
+    }
+    if (!out.flush()) {
+        BLT(error) << "Unable to write log index " << std::quoted(path);
+        return false;
+    }
+    return true;
+}
+
+auto LogIndex::load(const std::string& path) -> std::optional<LogIndex> {
+    std::ifstream in(path);
+    std::string header;
+    if (!std::getline(in, header) || header != SIDECAR_HEADER) {
+        return {};
+    }
+
+    std::string checkpoint_tag, last_tag, marks_tag;
+    int checkpoint_lines {};
+    std::size_t count {};
+    LogIndex index;
+    if (!(in >> checkpoint_tag >> checkpoint_lines >> last_tag >> index.m_last_line_offset >> index.m_last_line_num
+          >> index.m_last_ts_ms >> marks_tag >> count)
+        || checkpoint_tag != "checkpoint_lines" || last_tag != "last" || marks_tag != "marks") {
+        BLT(warning) << "Malformed log index " << std::quoted(path);
+        return {};
+    }
+    index.m_checkpoint_lines = std::max(checkpoint_lines, 1);
+
+    for (std::size_t i = 0; i < count; i++) {
+        char code {};
+        Mark m;
+        if (!(in >> code >> m.offset >> m.line_num >> m.ts_ms) || KIND_CODES.find(code) == std::string_view::npos) {
+            BLT(warning) << "Malformed log index " << std::quoted(path);
+            return {};
+        }
+        m.kind = static_cast<Kind>(KIND_CODES.find(code));
+        index.m_marks.push_back(m);
+    }
+    if (!index.m_marks.empty()) {
+        index.m_last_checkpoint_line_num = index.m_marks.back().line_num;
+    }
+    return index;
+}
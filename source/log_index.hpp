@@ -0,0 +1,155 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "log_file_source.hpp"
+#include "log_parser_types.hpp"
+#include "timestamps.hpp"
+
+/**
+ * Where things happen in a combat log, so that parsing can start part way through it
+ *
+ * The index holds a mark for each AreaEntered, EnterCombat, and ExitCombat event, and a checkpoint mark every so many
+ * lines. A mark gives the byte offset, line number, and timestamp of its line. To parse from a mark, resume a
+ * Timestamps at the mark's timestamp and hand LogFileSource::lines() the contents from the mark's offset: the mark's
+ * line is parsed again, so the day base comes out the same as it would from the start of the file.
+ *
+ * The index is kept beside the log in a small text file, sidecar_path(). It's built once and extended as the log grows,
+ * by load_or_build() or by add()ing lines while following the log.
+ */
+class LogIndex {
+  public:
+    inline static constexpr int DEFAULT_CHECKPOINT_LINES {10000};
+
+    enum class Kind : uint8_t {
+        CHECKPOINT,
+        AREA_ENTERED,
+        ENTER_COMBAT,
+        EXIT_COMBAT
+    };
+
+    struct Mark {
+        Kind kind {Kind::CHECKPOINT};
+
+        // Start of the line, from the start of the file.
+        uint64_t offset {};
+        int line_num {};
+
+        // The line's timestamp, in ms past the epoch.
+        int64_t ts_ms {};
+    };
+
+    /**
+     * A combat's EnterCombat mark, and its ExitCombat mark if it has ended
+     */
+    struct CombatRange {
+        Mark enter;
+        std::optional<Mark> exit;
+    };
+
+    explicit LogIndex(int checkpoint_lines = DEFAULT_CHECKPOINT_LINES);
+
+    /**
+     * The sidecar file of a log
+     */
+    static auto sidecar_path(const std::string& log_path) -> std::string {
+        return log_path + ".idx";
+    }
+
+    /**
+     * Load a log's index, bring it up to date with the log, and save it if anything was added
+     *
+     * If the sidecar is missing, unreadable, or doesn't match the log, the index is built from the start of the log.
+     * An unterminated last line isn't indexed, since the game may still be writing it.
+     *
+     * @return The index, or an empty optional if the log can't be read. The error is logged.
+     */
+    static auto load_or_build(const std::string& log_path, int checkpoint_lines = DEFAULT_CHECKPOINT_LINES)
+        -> std::optional<LogIndex>;
+
+    /**
+     * Read an index written by save()
+     *
+     * @return The index, or an empty optional if the file is missing or malformed.
+     */
+    static auto load(const std::string& path) -> std::optional<LogIndex>;
+
+    /**
+     * Write the index, replacing the file
+     *
+     * @return false if the file can't be written. The error is logged.
+     */
+    auto save(const std::string& path) const -> bool;
+
+    /**
+     * Index the log's lines from just past the last one indexed to its end
+     *
+     * @param[in] src The whole log
+     * @param[in] log_path Used for the log's creation time if nothing has been indexed yet
+     *
+     * @return false if the index doesn't fit the log, e.g. it's of a longer or different log. Nothing is added.
+     */
+    auto extend(const LogFileSource& src, const std::string& log_path) -> bool;
+
+    /**
+     * Index a parsed line
+     *
+     * Lines must be added in order. A line at or before the last one indexed is ignored, so a follower may start again
+     * from last_line_offset().
+     */
+    auto add(const LogLine& line, const LogParserTypes::ParsedLogLineView& entry) -> void;
+
+    auto marks() const -> std::span<const Mark> {
+        return m_marks;
+    }
+
+    /*
+     * The last line indexed, from which to carry on indexing. Line 0 if there hasn't been one.
+     */
+    auto last_line_offset() const -> uint64_t { return m_last_line_offset; }
+    auto last_line_num() const -> int { return m_last_line_num; }
+    auto last_ts_ms() const -> int64_t { return m_last_ts_ms; }
+
+    auto combat_count() const -> std::size_t;
+
+    /**
+     * Where a combat begins and ends
+     *
+     * @param[in] combat 1 for the log's first combat, 2 for its second, and so on
+     *
+     * @return The range, or an empty optional if the log has no such combat.
+     */
+    auto find_combat(std::size_t combat) const -> std::optional<CombatRange>;
+
+    /**
+     * The last mark at or before a time; parsing from it reaches the time soonest
+     *
+     * @return The mark, or an empty optional if the time is before every mark, so parsing must start at the top.
+     */
+    auto seek(int64_t ts_ms) const -> std::optional<Mark>;
+
+    /**
+     * Set up a Timestamps to parse from a mark
+     */
+    static auto resume_at(const Mark& mark, Timestamps& ts) -> void {
+        ts.resume(Timestamps::timestamp(std::chrono::milliseconds(mark.ts_ms)));
+    }
+
+  private:
+    auto add_mark(Kind kind, const LogLine& line, int64_t ts_ms) -> void;
+
+    int m_checkpoint_lines;
+    std::vector<Mark> m_marks;
+
+    uint64_t m_last_line_offset {};
+    int m_last_line_num {};
+    int64_t m_last_ts_ms {};
+    int m_last_checkpoint_line_num {};
+};
@@ -13,10 +13,30 @@
 
 using sv = std::string_view;
 
+namespace {
+    // A malformed log can fail every line the same way. Don't let that flood the log.
+    RateLimitedLog parse_failure_log;
+} // namespace
+
 auto LogParser::parse_line(sv line, int line_num, Timestamps& ts_parser) -> std::optional<LogParserTypes::ParsedLogLine> {
-    m_lph.set_line_num(line_num);
-    // Still need to keep the line num here. ::sigh::
-    BLT_LINE(error, line_num) << "Parsing log line " << std::quoted(line);
+    return LogParserTypes::materialize(parse_line_view(line, line_num, ts_parser));
+}
+
+auto LogParser::parse_line_view(sv line, int line_num, Timestamps& ts_parser) -> std::optional<LogParserTypes::ParsedLogLineView> {
+    return parse_line_projected<ParseFields::ALL>(line, line_num, ts_parser);
+}
+
+template <uint32_t Fields>
+auto LogParser::parse_line_projected(sv line, int line_num, Timestamps& ts_parser)
+    -> std::optional<LogParserTypes::ParsedLogLineView> {
+    // The helpers log against this line number. It's per thread, so parsers on different threads don't interfere.
+    LogLineScope line_scope {line_num};
+    BLT_LINE(trace, line_num) << "Parsing log line " << std::quoted(line);
+    // Without the source and target, only a few fields are split, and indexing the whole line costs more than it saves.
+    std::optional<LogParserHelpers::IndexedLine> indexed;
+    if constexpr ((Fields & (ParseFields::SOURCE | ParseFields::TARGET)) != 0) {
+        indexed.emplace(m_lph, line);
+    }
 
     // There are some special case log entries that it might be worth
     // it to segregate and handle in a non-standard way. AreaEntered
@@ -26,34 +46,99 @@ auto LogParser::parse_line(sv line, int line_num, Timestamps& ts_parser) -> std:
     uint64_t dist_beyond_field_delimiter {};
     auto ts_field = m_lph.get_next_field(line, '[', ']', &dist_beyond_field_delimiter);
     if (!ts_field) {
-        BLT_LINE(fatal, line_num) << "Unable to extract timestamp field (#1) from the log line. Skipping.";
+        BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Unable to extract timestamp field (#1) from the log line. Skipping.";
         return {};
     }
-    // Currently doesn't handle errors, lol.
     // Looks like ts field is always present and has a fixed format.
-    ts_parser.update_from_log_entry(*ts_field);
-    auto ts = ts_parser.current_log_timestamp();
+    auto ts = ts_parser.update_from_log_entry(*ts_field);
     if (!ts) {
-        BLT_LINE(fatal, line_num) << "Unable to parse timestamp string into valid timestamp. Skipping.";
+        BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Unable to parse timestamp string into valid timestamp. Skipping.";
         return {};
     }
     // BLT_LINE(error, line_num) << "ts field = " << std::quoted(*ts_field);
     line.remove_prefix(dist_beyond_field_delimiter);
 
+    return parse_fields_view<Fields>(line, line_num, *ts);
+}
+
+template auto LogParser::parse_line_projected<ParseFields::ALL>(sv, int, Timestamps&)
+    -> std::optional<LogParserTypes::ParsedLogLineView>;
+template auto LogParser::parse_line_projected<ParseFields::TIMELINE>(sv, int, Timestamps&)
+    -> std::optional<LogParserTypes::ParsedLogLineView>;
+template auto LogParser::parse_line_projected<ParseFields::DAMAGE>(sv, int, Timestamps&)
+    -> std::optional<LogParserTypes::ParsedLogLineView>;
+template auto LogParser::parse_line_projected<ParseFields::MOVEMENT>(sv, int, Timestamps&)
+    -> std::optional<LogParserTypes::ParsedLogLineView>;
+
+auto LogParser::parse_line_filtered(sv line, int line_num, Timestamps& ts_parser, const ActionFilter& filter)
+    -> std::optional<LogParserTypes::ParsedLogLineView> {
+    LogLineScope line_scope {line_num};
+    LogParserHelpers::IndexedLine indexed {m_lph, line};
+    ++m_filter_stats.lines;
+
+    uint64_t dist_beyond_field_delimiter {};
+    const auto ts_field = m_lph.get_next_field(line, '[', ']', &dist_beyond_field_delimiter);
+    const auto ts = ts_field ? ts_parser.update_from_log_entry(*ts_field) : std::nullopt;
+    if (!ts) {
+        BLT_LINE_LIMITED(parse_failure_log, error, line_num) << "Unable to parse timestamp field (#1). Skipping.";
+        ++m_filter_stats.bad_timestamp;
+        return {};
+    }
+    line.remove_prefix(dist_beyond_field_delimiter);
+
+    // Step over the source, target, and ability fields to the action field.
+    auto rest = line;
+    std::optional<sv> field;
+    for (int field_num = 2; field_num <= 5; field_num++) {
+        field = m_lph.get_next_field(rest, '[', ']', &dist_beyond_field_delimiter);
+        if (!field) {
+            break;
+        }
+        rest.remove_prefix(dist_beyond_field_delimiter);
+    }
+    const auto action_ids = field ? m_lph.scan_action_ids(*field) : std::nullopt;
+    if (!action_ids) {
+        BLT_LINE_LIMITED(parse_failure_log, error, line_num) << "Unable to find the action field (#5). Skipping.";
+        ++m_filter_stats.no_action;
+        return {};
+    }
+    if (!filter.matches(action_ids->first, action_ids->second)) {
+        ++m_filter_stats.rejected;
+        return {};
+    }
+
+    auto ret = parse_fields_view<ParseFields::ALL>(line, line_num, *ts);
+    ++(ret ? m_filter_stats.parsed : m_filter_stats.parse_failed);
+    return ret;
+}
+
+template <uint32_t Fields>
+auto LogParser::parse_fields_view(sv line, int line_num, Timestamps::timestamp ts)
+    -> std::optional<LogParserTypes::ParsedLogLineView> {
+    namespace pf = ParseFields;
+    constexpr bool want_source = (Fields & pf::SOURCE) != 0;
+    constexpr bool want_target = (Fields & pf::TARGET) != 0;
+    // A target of "=" is a copy of the source, so the source is needed for either.
+    constexpr bool decode_source = want_source || want_target;
+    constexpr bool want_location = (Fields & pf::LOCATION) != 0;
+    constexpr bool want_health = (Fields & pf::HEALTH) != 0;
+
+    uint64_t dist_beyond_field_delimiter {};
+
     // source field is always present and has 4 formats:
     // Empty/PC/NPC/Comp. The non-empty have the same trailing subfields: location health
     auto source_field = m_lph.get_next_field(line, '[', ']', &dist_beyond_field_delimiter);
     if (!source_field) {
-        BLT_LINE(fatal, line_num) << "Unable to extract the source field (#2) from the log line. Skipping.";
+        BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Unable to extract the source field (#2) from the log line. Skipping.";
         return {};
     }
-    decltype(LogParserTypes::ParsedLogLine::source) source;
+    std::optional<LogParserTypes::SourceOrTargetView> source;
     if (source_field->empty()) {
-        BLT_LINE(info, line_num) << "Source is empty. Continuing.";
-    } else {
-        source = m_lph.parse_source_target_field(*source_field);
+        BLT_LINE(debug, line_num) << "Source is empty. Continuing.";
+    } else if constexpr (decode_source) {
+        source = m_lph.parse_source_target_field_view<want_location, want_health>(*source_field);
         if (!source) {
-            BLT_LINE(fatal, line_num) << "Unable to parse source field. Skipping.";
+            BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Unable to parse source field. Skipping.";
             return {};
         }
     }
@@ -64,21 +149,21 @@ auto LogParser::parse_line(sv line, int line_num, Timestamps& ts_parser) -> std:
     // target field is always present and is either empty, the character =, or a full source/target specification.
     auto target_field = m_lph.get_next_field(line, '[', ']', &dist_beyond_field_delimiter);
     if (!target_field) {
-        BLT_LINE(fatal, line_num) << "Unable to extract target field (#3) from the log line. Skipping.";
+        BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Unable to extract target field (#3) from the log line. Skipping.";
         return {};
     }
     // BLT_LINE(error, line_num) << "target_field = " << std::quoted(*target_field);
 
     decltype(source) target;
     if (*target_field == "=") {
-        BLT_LINE(info, line_num) << "target is the same as the source.";
+        BLT_LINE(debug, line_num) << "target is the same as the source.";
         target = source;
     } else if (target_field->empty()) {
-        BLT_LINE(info, line_num) << "empty (no) target specified.";
-    } else {
-        target = m_lph.parse_source_target_field(*target_field);
+        BLT_LINE(debug, line_num) << "empty (no) target specified.";
+    } else if constexpr (want_target) {
+        target = m_lph.parse_source_target_field_view<want_location, want_health>(*target_field);
         if (!target) {
-            BLT_LINE(fatal, line_num) << "Unable to parse target field. Skipping.";
+            BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Unable to parse target field. Skipping.";
             return {};
         }
     }
@@ -87,18 +172,18 @@ auto LogParser::parse_line(sv line, int line_num, Timestamps& ts_parser) -> std:
     // ability may not be present but can be in 3 forms: empty, name/ID, and empty name with ID. WTF?
     auto ability_field = m_lph.get_next_field(line, '[', ']', &dist_beyond_field_delimiter);
     if (!ability_field) {
-        BLT_LINE(fatal, line_num) << "Unable to extract ability field (#4) from log line. Skipping.";
+        BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Unable to extract ability field (#4) from log line. Skipping.";
         return {};
     }
 
 
-    decltype(m_lph.parse_name_and_id(*ability_field)) ability;
+    std::optional<LogParserTypes::AbilityView> ability;
     if (ability_field == "") {
-        BLT_LINE(info, line_num) << "Ability field is empty. Ignoring and continuing.";
-    } else {
-        ability = m_lph.parse_name_and_id(*ability_field);
+        BLT_LINE(debug, line_num) << "Ability field is empty. Ignoring and continuing.";
+    } else if constexpr ((Fields & pf::ABILITY) != 0) {
+        ability = m_lph.parse_name_and_id_view(*ability_field);
         if (!ability) {
-            BLT_LINE(fatal, line_num) << "Failed to successfully parse ability field.";
+            BLT_LINE_LIMITED(parse_failure_log, fatal, line_num) << "Failed to successfully parse ability field.";
             return {};
         }
     }
@@ -113,45 +198,58 @@ auto LogParser::parse_line(sv line, int line_num, Timestamps& ts_parser) -> std:
     
     auto action_field = m_lph.get_next_field(line, '[', ']', &dist_beyond_field_delimiter);
     if (!action_field) {
-        BLT_LINE(error, line_num) << "Unable to extract action field (#5) from log line. Skipping.";
+        BLT_LINE_LIMITED(parse_failure_log, error, line_num) << "Unable to extract action field (#5) from log line. Skipping.";
         return {};
     }
-    auto action = m_lph.parse_action_field(*action_field);
+    auto action = m_lph.parse_action_field_view(*action_field);
     if (!action) {
-        BLT_LINE(error, line_num) << "Unable to parse action field from log line. Skipping.";
+        BLT_LINE_LIMITED(parse_failure_log, error, line_num) << "Unable to parse action field from log line. Skipping.";
         return {};
     }
-    BLT_LINE(info, line_num) << "Action: verb=" << action->verb.ref().name << ", noun=" << action->noun.ref().name;
+    BLT_LINE(trace, line_num) << "Action: verb=" << action->verb.name << ", noun=" << action->noun.name;
     line.remove_prefix(dist_beyond_field_delimiter);
-    BLT_LINE(info, line_num) << "Line after action: " << std::quoted(line);
+    BLT_LINE(trace, line_num) << "Line after action: " << std::quoted(line);
 
-    LogParserTypes::ParsedLogLine ret;
-    ret.ts = *ts;
-    ret.source = source;
-    ret.target = target;
+    LogParserTypes::ParsedLogLineView ret;
+    ret.ts = ts;
+    if constexpr (want_source) {
+        ret.source = source;
+    }
+    if constexpr (want_target) {
+        ret.target = target;
+    }
     ret.ability = ability;
     ret.action = *action;
     
+    if constexpr ((Fields & (pf::VALUE | pf::THREAT)) == 0) {
+        // Both are optional, so there's nothing about them to check.
+        return ret;
+    }
+
     auto value_field = m_lph.get_next_field(line, '(', ')', &dist_beyond_field_delimiter);
     if (!value_field) {
-        BLT_LINE(info, line_num) << "Optional value field (#6) not present in log line. Ignoring.";
+        BLT_LINE(debug, line_num) << "Optional value field (#6) not present in log line. Ignoring.";
     } else {
-        ret.value = m_lph.parse_value_field(*value_field);
-        BLT_LINE(info, line_num) << "parse_value_field returns '" << (ret.value ? "true'" : "false'");
-        if (!ret.value) {
-            BLT_LINE(error, line_num) << "Value field (#6) present but could not be parsed. Ignoring.";
+        if constexpr ((Fields & pf::VALUE) != 0) {
+            ret.value = m_lph.parse_value_field_view(*value_field);
+            BLT_LINE(trace, line_num) << "parse_value_field returns '" << (ret.value ? "true'" : "false'");
+            if (!ret.value) {
+                BLT_LINE_LIMITED(parse_failure_log, error, line_num) << "Value field (#6) present but could not be parsed. Ignoring.";
+            }
         }
         line.remove_prefix(dist_beyond_field_delimiter);
     }
-    BLT_LINE(info, line_num) << "Line after value: " << std::quoted(line);
+    BLT_LINE(trace, line_num) << "Line after value: " << std::quoted(line);
 
-    auto threat_field = m_lph.get_next_field(line, '<', '>', &dist_beyond_field_delimiter);
-    if (!threat_field) {
-        BLT_LINE(info, line_num) << "Optional threat field (#7) not present in log line. Ignoring.";
-    } else {
-        ret.threat = m_lph.parse_threat_field(*threat_field);
-        if (!ret.threat) {
-            BLT_LINE(error, line_num) << "Threat field (#7) present but could not be parsed. Ignoring.";
+    if constexpr ((Fields & pf::THREAT) != 0) {
+        auto threat_field = m_lph.get_next_field(line, '<', '>', &dist_beyond_field_delimiter);
+        if (!threat_field) {
+            BLT_LINE(debug, line_num) << "Optional threat field (#7) not present in log line. Ignoring.";
+        } else {
+            ret.threat = m_lph.parse_threat_field_view(*threat_field);
+            if (!ret.threat) {
+                BLT_LINE_LIMITED(parse_failure_log, error, line_num) << "Threat field (#7) present but could not be parsed. Ignoring.";
+            }
         }
     }
 
@@ -1,20 +1,135 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 #include <optional>
+#include <vector>
 
 #include "log_parser_types.hpp"
 #include "log_parser_helpers.hpp"
 #include "timestamps.hpp"
 
+/**
+ * Fields of a log line for LogParser::parse_line_projected() to decode
+ *
+ * The timestamp and action are always decoded. A field left out of a mask is still found and its delimiters checked,
+ * so a line with a malformed structure fails the same way, but its contents aren't decoded: the result has an empty
+ * optional for it, or for LOCATION and HEALTH, zeros.
+ */
+namespace ParseFields {
+    enum : uint32_t {
+        SOURCE   = 1 << 0,
+        TARGET   = 1 << 1,
+        LOCATION = 1 << 2, // of the source and target, if decoded
+        HEALTH   = 1 << 3, // likewise
+        ABILITY  = 1 << 4,
+        VALUE    = 1 << 5,
+        THREAT   = 1 << 6,
+    };
+
+    inline constexpr uint32_t ALL {SOURCE | TARGET | LOCATION | HEALTH | ABILITY | VALUE | THREAT};
+
+    // Which actions happened when, e.g. for a combat timeline.
+    inline constexpr uint32_t TIMELINE {0};
+
+    // Who did how much with what, e.g. for a DPS meter.
+    inline constexpr uint32_t DAMAGE {SOURCE | ABILITY | VALUE};
+
+    // Where everyone was.
+    inline constexpr uint32_t MOVEMENT {SOURCE | TARGET | LOCATION};
+} // namespace ParseFields
+
+/**
+ * Action IDs kept by LogParser::parse_line_filtered()
+ *
+ * A line is kept if its action's verb or noun ID is one of `ids`: ApplyEffect's keeps every effect applied, say, while
+ * Damage's and Heal's keep only damage and healing.
+ */
+struct ActionFilter {
+    std::vector<uint64_t> ids;
+
+    auto matches(uint64_t verb_id, uint64_t noun_id) const -> bool {
+        return std::find(ids.begin(), ids.end(), verb_id) != ids.end()
+            || std::find(ids.begin(), ids.end(), noun_id) != ids.end();
+    }
+};
+
 class LogParser {
 public:
+    /**
+     * What parse_line_filtered() has done with the lines it was given, by the stage at which each was dropped
+     */
+    struct FilterStats {
+        std::size_t lines {};
+
+        // Dropped before the filter: the timestamp couldn't be read, or the action field or its IDs couldn't be found.
+        std::size_t bad_timestamp {};
+        std::size_t no_action {};
+
+        // Dropped by the filter, with only the timestamp and action IDs decoded.
+        std::size_t rejected {};
+
+        // Kept by the filter and then parsed in full, or not.
+        std::size_t parse_failed {};
+        std::size_t parsed {};
+    };
+
     LogParser() = default;
 
     // The line number is used to populate logging messages.
     auto parse_line(std::string_view line, int line_num, Timestamps& ts_parser) -> std::optional<LogParserTypes::ParsedLogLine>;
 
+    /**
+     * Parse a log line without copying any of its strings
+     *
+     * Same as parse_line(), but the names and other strings in the result are views into `line`, so nothing is
+     * allocated. The result must not outlive the buffer `line` refers to; LogParserTypes::materialize() it to keep it
+     * longer.
+     */
+    auto parse_line_view(std::string_view line, int line_num, Timestamps& ts_parser) -> std::optional<LogParserTypes::ParsedLogLineView>;
+
+    /**
+     * Parse only some of the fields of a log line
+     *
+     * Same as parse_line_view(), which decodes ParseFields::ALL, but the fields not in `Fields` are skipped over rather
+     * than decoded. Instantiated in log_parser.cpp for each of the masks ParseFields names; add one there to use
+     * another.
+     *
+     * @tparam Fields Bitwise or of ParseFields
+     */
+    template <uint32_t Fields>
+    auto parse_line_projected(std::string_view line, int line_num, Timestamps& ts_parser)
+        -> std::optional<LogParserTypes::ParsedLogLineView>;
+
+    /**
+     * Parse a log line only if its action passes a filter
+     *
+     * Same as parse_line_view() for a line that passes. For one that doesn't, the source, target, and ability fields
+     * are stepped over rather than parsed, and only the action's verb and noun IDs are decoded before it's dropped.
+     * The timestamp is always decoded, so `ts_parser` follows the log across midnight even through dropped lines.
+     *
+     * @returns The parsed line, or an empty optional if it was dropped or failed to parse. filter_stats() counts which.
+     */
+    auto parse_line_filtered(std::string_view line, int line_num, Timestamps& ts_parser, const ActionFilter& filter)
+        -> std::optional<LogParserTypes::ParsedLogLineView>;
+
+    auto filter_stats() const -> const FilterStats& {
+        return m_filter_stats;
+    }
+
+    auto reset_filter_stats() -> void {
+        m_filter_stats = {};
+    }
+
 private:
+    // Parse the fields after the timestamp.
+    template <uint32_t Fields>
+    auto parse_fields_view(std::string_view line, int line_num, Timestamps::timestamp ts)
+        -> std::optional<LogParserTypes::ParsedLogLineView>;
+
     LogParserHelpers m_lph;
+    FilterStats m_filter_stats;
 };
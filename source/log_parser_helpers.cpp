@@ -1,16 +1,27 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <climits>
 #include <cmath>
 #include <cstdlib>
 #include <iomanip>
+#include <system_error>
 
 #include "log_parser_helpers.hpp"
 #include <boost/log/trivial.hpp>
 #include "log_parser_types.hpp"
 #include "logging.hpp"
 
-#define LL(lev) BLT_LINE(lev, m_line_num)
+#define LL(lev) BLT_LINE(lev, LogLineScope::current())
+// LL for a field that fails to parse. A malformed log can fail every line the same way, so these are throttled.
+#define LL_FAILED(lev) BLT_LINE_LIMITED(field_failure_log, lev, LogLineScope::current())
 using sv = std::string_view;
 
+namespace {
+    RateLimitedLog field_failure_log;
+} // namespace
+
 constexpr int dec_radix = 10;
 constexpr std::string expected_mitigation_type {"absorbed"};
 
@@ -18,29 +29,47 @@ constexpr std::string expected_mitigation_type {"absorbed"};
 using Health = LogParserTypes::Health;
 using Action = LogParserTypes::Action;
 
+namespace {
+    // What strtoul()/strtod() skip before a number.
+    constexpr std::string_view c_whitespace {" \t\n\v\f\r"};
+
+    // Exact powers of ten for the fixed-point decoder. A double represents these, and any integer below 2^53,
+    // exactly, so one division gives the correctly rounded result, the same as strtod().
+    constexpr std::array<double, 16> pow10 {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                            1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+    auto is_digit(char c) -> bool {
+        return c >= '0' && c <= '9';
+    }
+} // namespace
+
+// std::from_chars() doesn't allocate, consult errno, or depend on the locale. It also doesn't skip leading whitespace
+// or accept a leading '+' like strtoul()/strtod() do, so that's handled here to keep their behavior.
 auto LogParserHelpers::str_to_uint64(sv field, uint64_t* first_non_int_char) const -> std::optional<uint64_t> {
     LL(trace) << "Parsing string " << std::quoted(field) << " as an uint64_t.";
 
-    std::string ul_str = std::string(field);
-    char* endptr {nullptr};
-    errno = 0;
-    uint64_t ret = strtoul(ul_str.data(), &endptr, dec_radix);
-    decltype(errno) local_errno = errno;
-    if (local_errno != 0) {
-        LL(warning) << "String " << std::quoted(ul_str) << " failed to convert to ulong. errno=" << errno
-                    << " " << std::quoted(std::strerror(local_errno));
+    auto digits = lstrip(field, c_whitespace);
+    if (digits.starts_with('+')) {
+        digits.remove_prefix(1);
+    }
+
+    uint64_t ret {};
+    auto [endptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), ret, dec_radix);
+    if (ec == std::errc::invalid_argument) {
+	LL_FAILED(error) << "Did not encounter an integer character.";
+	return {};
+    }
+    if (ec != std::errc{}) {
+        LL_FAILED(warning) << "String " << std::quoted(field) << " failed to convert to ulong: "
+                    << std::quoted(std::make_error_code(ec).message());
         return {};
     }
     if (ret == ULONG_MAX) {
-        LL(warning) << "String " << std::quoted(ul_str) << " doesn't represent a valid ulong. Skipping.";
+        LL_FAILED(warning) << "String " << std::quoted(field) << " doesn't represent a valid ulong. Skipping.";
         return {};
     }
-    if (endptr == ul_str.data()) {
-	LL(error) << "Did not encounter an integer character.";
-	return {};
-    }
     if (first_non_int_char != nullptr) {
-        *first_non_int_char = static_cast<uint64_t>(std::distance(ul_str.data(), endptr));
+        *first_non_int_char = static_cast<uint64_t>(std::distance(field.data(), endptr));
     }
     return ret;
 }
@@ -54,38 +83,78 @@ auto LogParserHelpers::str_to_double(sv field, uint64_t* first_non_double_char)
     LL(trace) << "Parsing string " << std::quoted(field) << " as a double.";
 
     if (field.empty()) {
-	LL(warning) << "Empty string is not a valid uint64.";
+	LL_FAILED(warning) << "Empty string is not a valid uint64.";
 	return {};
     }
 
-    std::string field_s = std::string(field);
-    auto endptr = field_s.data();
-    errno = 0;
-    double ret = strtod(field_s.data(), &endptr);
-    decltype(errno) local_errno = errno;
-#   pragma GCC diagnostic push
-#   pragma GCC diagnostic ignored "-Wfloat-equal"
-    // This is safe because strtod is guaranteed to return 0.0 or HUGE_VAL if an error occurs.
-    if ((ret == 0.0 || ret == HUGE_VAL) && local_errno != 0) {
-        LL(warning) << "String " << std::quoted(field_s) << " isn't a valid double. Skipping.";
-        return {};
+    auto number = lstrip(field, c_whitespace);
+    if (number.starts_with('+')) {
+        number.remove_prefix(1);
     }
-#   pragma GCC diagnostic pop
-    if (endptr == field_s.data()) {
-	LL(error) << "Did not encounter a double character. Skipping.";
+
+    double ret {};
+    auto [endptr, ec] = std::from_chars(number.data(), number.data() + number.size(), ret);
+    if (ec == std::errc::invalid_argument) {
+	LL_FAILED(error) << "Did not encounter a double character. Skipping.";
 	return {};
     }
+    if (ec != std::errc{}) {
+        LL_FAILED(warning) << "String " << std::quoted(field) << " isn't a valid double. Skipping.";
+        return {};
+    }
     if (*std::prev(endptr) == '.') {
-	LL(error) << "Double has no integer beyond the decimal point. Skipping.";
+	LL_FAILED(error) << "Double has no integer beyond the decimal point. Skipping.";
 	return {};
     }
 
     if (first_non_double_char != nullptr) {
-        *first_non_double_char = static_cast<uint64_t>(std::distance(field_s.data(), endptr));
+        *first_non_double_char = static_cast<uint64_t>(std::distance(field.data(), endptr));
     }
     return ret;
 }
 
+auto LogParserHelpers::parse_fixed_point(sv field, uint64_t* first_non_double_char) const -> std::optional<double> {
+    auto pos = field.begin();
+    const bool negative = pos != field.end() && *pos == '-';
+    if (negative) {
+        ++pos;
+    }
+
+    uint64_t mantissa {};
+    const auto int_begin = pos;
+    for (; pos != field.end() && is_digit(*pos); ++pos) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*pos - '0');
+    }
+    const auto int_digits = std::distance(int_begin, pos);
+
+    std::ptrdiff_t frac_digits {};
+    if (pos != field.end() && *pos == '.') {
+        ++pos;
+        const auto frac_begin = pos;
+        for (; pos != field.end() && is_digit(*pos); ++pos) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*pos - '0');
+        }
+        frac_digits = std::distance(frac_begin, pos);
+        if (frac_digits == 0) {
+            return {};
+        }
+    }
+
+    // Anything that might continue the number (an exponent, hex digits, ...) or that's too long to be exact is left
+    // to the general parser.
+    if (int_digits == 0
+        || int_digits + frac_digits > 15
+        || (pos != field.end() && (std::isalnum(static_cast<unsigned char>(*pos)) || *pos == '.'))) {
+        return {};
+    }
+
+    auto ret = static_cast<double>(mantissa) / pow10[static_cast<std::size_t>(frac_digits)];
+    if (first_non_double_char != nullptr) {
+        *first_non_double_char = static_cast<uint64_t>(std::distance(field.begin(), pos));
+    }
+    return negative ? -ret : ret;
+}
+
 auto LogParserHelpers::lstrip(sv field, sv to_remove) const -> sv {
     auto beg = std::find_if(field.begin(), field.end(), [&to_remove] (auto c) {
         return to_remove.find(c) == sv::npos;
@@ -118,12 +187,40 @@ auto LogParserHelpers::get_next_field(sv line, char begin_delim, char end_delim,
     //     If delimiter is a closing : decrease nesting by 1
     //         If nesting == 0: return field
 
+    if (begin_delim != end_delim && DelimiterIndex::is_delimiter(begin_delim) && DelimiterIndex::is_delimiter(end_delim)
+        && m_delims.covers(line)) {
+        // The same procedure, visiting only the delimiters.
+        DelimiterIndex::Cursor cursor {m_delims, line};
+        auto pos = cursor.next();
+        while (pos < line.size() && line[pos] != begin_delim) {
+            pos = cursor.next();
+        }
+        if (pos == line.size()) {
+            LL(info) << "Line did not contain beginning delimiter '" << begin_delim << "'.  Skipping.";
+            return {};
+        }
+        const auto field_pos = pos + 1;
+        int nesting = 1;
+        for (pos = cursor.next(); pos < line.size(); pos = cursor.next()) {
+            if (line[pos] == begin_delim) {
+                nesting++;
+            } else if (line[pos] == end_delim && --nesting == 0) {
+                if (dist_beyond_field_char != nullptr) {
+                    *dist_beyond_field_char = pos + 1;
+                }
+                return line.substr(field_pos, pos - field_pos);
+            }
+        }
+        LL_FAILED(error) << "Unbalanced opening delimiter - did not find ending delimiter '" << end_delim << "'.";
+        return {};
+    }
+
     const auto beg_field = std::find(line.begin(), line.end(), begin_delim);
     if (beg_field == line.end()) {
-        BLT_LINE(info, m_line_num) << "Line did not contain beginning delimiter '" << begin_delim << "'.  Skipping.";
+        LL(info) << "Line did not contain beginning delimiter '" << begin_delim << "'.  Skipping.";
         return {};
     }
-    BLT_LINE(trace, m_line_num) << "In " << std::quoted(line) << " found '" << begin_delim << "' at pos "
+    LL(trace) << "In " << std::quoted(line) << " found '" << begin_delim << "' at pos "
                                 << std::distance(line.begin(), beg_field);
 
     int nesting = 1;
@@ -132,10 +229,10 @@ auto LogParserHelpers::get_next_field(sv line, char begin_delim, char end_delim,
         const auto next_delim = std::find_if(curr_start, line.end(), [begin_delim, end_delim] (auto c) {
             return begin_delim == c || end_delim == c; });
         if (next_delim == line.end()) {
-            BLT_LINE(error, m_line_num) << "Unbalanced opening delimiter - did not find ending delimiter '" << end_delim << "'.";
+            LL_FAILED(error) << "Unbalanced opening delimiter - did not find ending delimiter '" << end_delim << "'.";
             return {};
         }
-        BLT_LINE(trace, m_line_num) << "In " << std::quoted(line) << " found '" << *next_delim << "' at pos "
+        LL(trace) << "In " << std::quoted(line) << " found '" << *next_delim << "' at pos "
                                     << std::distance(line.begin(), next_delim);
         if (*next_delim == begin_delim) {
             nesting++;
@@ -153,10 +250,22 @@ auto LogParserHelpers::get_next_field(sv line, char begin_delim, char end_delim,
     }
 }
 
+auto LogParserHelpers::find_delimiter(sv field, char delim) const -> std::size_t {
+    if (DelimiterIndex::is_delimiter(delim) && m_delims.covers(field)) {
+        DelimiterIndex::Cursor cursor {m_delims, field};
+        auto pos = cursor.next();
+        while (pos < field.size() && field[pos] != delim) {
+            pos = cursor.next();
+        }
+        return pos;
+    }
+    return static_cast<std::size_t>(std::distance(field.begin(), std::find(field.begin(), field.end(), delim)));
+}
+
 auto LogParserHelpers::parse_st_location(sv field) const -> std::optional<LogParserTypes::Location> {
     LL(trace) << "Parsing s/t location from string " << std::quoted(field);
     if (std::count(field.begin(), field.end(), ',') != 3) {
-        LL(error) << "Did not find all components (x,y,z,rot) in the location string. Skipping.";
+        LL_FAILED(error) << "Did not find all components (x,y,z,rot) in the location string. Skipping.";
         return {};
     }
 
@@ -168,9 +277,13 @@ auto LogParserHelpers::parse_st_location(sv field) const -> std::optional<LogPar
     while (true) {
         auto sep_pos = std::find(beg_pos, field.end(), ',');
         auto double_str = sv(beg_pos, sep_pos);
-        auto val = str_to_double(double_str);
+        // Coordinates are almost always plain "-x.xx". Decode those directly and let anything else take the general path.
+        auto val = parse_fixed_point(double_str);
+        if (!val) {
+            val = str_to_double(double_str);
+        }
         if (!val) {
-	    LL(error) << "Location component " << std::quoted(double_str) << " (#" << std::distance(to_store.begin(), curr_store)
+	    LL_FAILED(error) << "Location component " << std::quoted(double_str) << " (#" << std::distance(to_store.begin(), curr_store)
 			<< ") could not be converted to a double.";
             return {};
         }
@@ -191,32 +304,32 @@ auto LogParserHelpers::parse_st_health(sv field) const -> std::optional<Health>
 
     const auto health_sep = std::find(field.begin(), field.end(), '/');
     if (health_sep == field.end()) {
-        LL(error) << "s/t health field missing '/' separator. Skipping.";
+        LL_FAILED(error) << "s/t health field missing '/' separator. Skipping.";
         return {};
     }
 
     auto curr_health = str_to_uint64({field.begin(), health_sep});
     if (!curr_health) {
-        LL(error) << "s/t current health field is not a valid integer. Skipping.";
+        LL_FAILED(error) << "s/t current health field is not a valid integer. Skipping.";
         return {};
     }
 
     auto total_health = str_to_uint64({std::next(health_sep), field.end()});
     if (!total_health) {
-        LL(error) << "s/t total health field is not a valid integer. Skipping.";
+        LL_FAILED(error) << "s/t total health field is not a valid integer. Skipping.";
         return {};
     }
 
     return std::make_optional<Health>(Health::Current(*curr_health), Health::Total(*total_health));
 }
 
-auto LogParserHelpers::parse_name_and_id(sv field, uint64_t* dist_beyond_field_delim) const -> std::optional<LogParserTypes::NameId> {
+auto LogParserHelpers::parse_name_and_id_view(sv field, uint64_t* dist_beyond_field_delim) const -> std::optional<LogParserTypes::NameIdView> {
     LL(trace) << "Parsing Name/ID from string " << std::quoted(field);
     
     // Everything up to the '{' is the name string subfield.
-    const auto name_end = std::find(field.begin(), field.end(), '{');
+    const auto name_end = std::next(field.begin(), static_cast<sv::difference_type>(find_delimiter(field, '{')));
     if (name_end == field.end()) {
-        LL(warning) << "Did not find delimiter between name and ID. Skipping.";
+        LL_FAILED(warning) << "Did not find delimiter between name and ID. Skipping.";
         return {};
     }
 
@@ -234,13 +347,13 @@ auto LogParserHelpers::parse_name_and_id(sv field, uint64_t* dist_beyond_field_d
     uint64_t dist_to_first_char_beyond_field {};
     auto id_str = get_next_field(field, '{', '}', &dist_to_first_char_beyond_field);
     if (!id_str) {
-        LL(error) << "Failed to extract numeric ID field from name/id string. Skipping.";
+        LL_FAILED(error) << "Failed to extract numeric ID field from name/id string. Skipping.";
         return {};
     }
 
     auto id = str_to_uint64(*id_str);
     if (!id) {
-        LL(error) << "Failed to parse ID string as an integer. Skipping.";
+        LL_FAILED(error) << "Failed to parse ID string as an integer. Skipping.";
         return {};
     }
 
@@ -250,22 +363,22 @@ auto LogParserHelpers::parse_name_and_id(sv field, uint64_t* dist_beyond_field_d
         *dist_beyond_field_delim = dist_to_first_char_beyond_field;
     }
 
-    return LogParserTypes::NameId {.name = std::string(name), .id = *id};
+    return LogParserTypes::NameIdView {.name = name, .id = *id};
 }
 
-auto LogParserHelpers::parse_name_id_instance(sv field) const -> std::optional<LogParserTypes::NameIdInstance> {
+auto LogParserHelpers::parse_name_id_instance_view(sv field) const -> std::optional<LogParserTypes::NameIdInstanceView> {
     LL(trace) << "Parsing name/id/instance from field " << std::quoted(field);
 
     const auto name_id_inst_sep = std::find(field.begin(), field.end(), ':');
     if (name_id_inst_sep == field.end()) {
-        LL(warning) << "Field does not contain the name_id/inst separator, ':'";
+        LL_FAILED(warning) << "Field does not contain the name_id/inst separator, ':'";
         return {};
     }
     
     uint64_t dist_to_first_char_beyond_id {};
-    auto name_id = parse_name_and_id({field.begin(), name_id_inst_sep}, &dist_to_first_char_beyond_id);
+    auto name_id = parse_name_and_id_view({field.begin(), name_id_inst_sep}, &dist_to_first_char_beyond_id);
     if (!name_id) {
-        LL(warning) << "Failed to parse name and id. Skipping.";
+        LL_FAILED(warning) << "Failed to parse name and id. Skipping.";
         return {};
     }
 
@@ -277,14 +390,14 @@ auto LogParserHelpers::parse_name_id_instance(sv field) const -> std::optional<L
     uint64_t dist_to_first_non_int_char {};
     auto inst = str_to_uint64(field, &dist_to_first_non_int_char);
     if (!inst) {
-        LL(error) << "Instance string " << std::quoted(field) << " is not a valid uint64_t. Skipping.";
+        LL_FAILED(error) << "Instance string " << std::quoted(field) << " is not a valid uint64_t. Skipping.";
         return {};
     }
 
-    return LogParserTypes::NameIdInstance {.name_id = *name_id, .instance = *inst};
+    return LogParserTypes::NameIdInstanceView {.name_id = *name_id, .instance = *inst};
 }
 
-auto LogParserHelpers::parse_source_target_actor(sv field) const -> std::optional<LogParserTypes::Actor> {
+auto LogParserHelpers::parse_source_target_actor_view(sv field) const -> std::optional<LogParserTypes::ActorView> {
     LL(trace) << "Parsing " << std::quoted(field) << " as a source/target (s/t) actor.";
     field = strip(field, " ");
     if (field.empty()) {
@@ -304,11 +417,11 @@ auto LogParserHelpers::parse_source_target_actor(sv field) const -> std::optiona
         if (pc_name_id_sep == field.end()) {
             LL(info) << "PC s/t is missing name/id separator, '#'. Checking for UNKNOWN.";
             if (field.starts_with("UNKNOWN")) {
-                LL(warning) << "PC is UNKNOWN with no ID.";
+                LL_FAILED(warning) << "PC is UNKNOWN with no ID.";
                 name = sv {field.begin(), pc_end};
                 field.remove_prefix(name.length());
             } else {
-                LL(error) << "PC is missing '#' and is not UNKNOWN. Skipping.";
+                LL_FAILED(error) << "PC is missing '#' and is not UNKNOWN. Skipping.";
                 return {};
             }
         } else {
@@ -319,14 +432,14 @@ auto LogParserHelpers::parse_source_target_actor(sv field) const -> std::optiona
             uint64_t dist_to_first_non_uint64_char {};
             auto pc_id_maybe = str_to_uint64(field, &dist_to_first_non_uint64_char);
             if (!pc_id_maybe) {
-                LL(error) << "PC ID string to ulong conversion failed. Skipping.";
+                LL_FAILED(error) << "PC ID string to ulong conversion failed. Skipping.";
                 return {};
             }
             pc_id = *pc_id_maybe;
             field.remove_prefix(dist_to_first_non_uint64_char);
         }
 
-        LogParserTypes::PcActor pcs {.name = std::string(name), .id = pc_id};
+        LogParserTypes::PcActorView pcs {.name = name, .id = pc_id};
         
         if (pc_comp_sep == field.end()) {
             LL(trace) << "s/t is a PC.";
@@ -335,19 +448,19 @@ auto LogParserHelpers::parse_source_target_actor(sv field) const -> std::optiona
         field.remove_prefix(static_cast<sv::size_type>(std::distance(field.begin(), pc_comp_sep)));
 
         LL(trace) << "s/t is a PC's companion.";
-        auto pc_comp = parse_name_id_instance({std::next(pc_comp_sep), field.end()});
+        auto pc_comp = parse_name_id_instance_view({std::next(pc_comp_sep), field.end()});
         if (!pc_comp) {
-            LL(error) << "Failed to parse companion's name, id, and instance. Skipping.";
+            LL_FAILED(error) << "Failed to parse companion's name, id, and instance. Skipping.";
             return {};
         }
 
-        return LogParserTypes::CompanionActor {.pc = pcs, .companion = *pc_comp};
+        return LogParserTypes::CompanionActorView {.pc = pcs, .companion = *pc_comp};
     }
 
     LL(trace) << "s/t is a NPC.";
-    auto npc = parse_name_id_instance({field.begin(), field.end()});
+    auto npc = parse_name_id_instance_view({field.begin(), field.end()});
     if (!npc) {
-        LL(error) << "Failed to parse NPC's name/ID and instance. Skipping.";
+        LL_FAILED(error) << "Failed to parse NPC's name/ID and instance. Skipping.";
         return {};
     }
 
@@ -355,10 +468,15 @@ auto LogParserHelpers::parse_source_target_actor(sv field) const -> std::optiona
     return npc;
 }
 
-auto LogParserHelpers::parse_source_target_field(sv field) const -> std::optional<LogParserTypes::SourceOrTarget> {
+auto LogParserHelpers::parse_source_target_field_view(sv field) const -> std::optional<LogParserTypes::SourceOrTargetView> {
+    return parse_source_target_field_view<true, true>(field);
+}
+
+template <bool DecodeLocation, bool DecodeHealth>
+auto LogParserHelpers::parse_source_target_field_view(sv field) const -> std::optional<LogParserTypes::SourceOrTargetView> {
     LL(trace) << "parsing source/target (s/t) from field " << std::quoted(field);
 
-    const auto name_loc_sep = std::find(field.begin(), field.end(), '|');
+    const auto name_loc_sep = std::next(field.begin(), static_cast<sv::difference_type>(find_delimiter(field, '|')));
     if (name_loc_sep == field.end()) {
         LL(info) << "field missing source/location separator, '|'. Skipping.";
             return {};
@@ -366,78 +484,95 @@ auto LogParserHelpers::parse_source_target_field(sv field) const -> std::optiona
     auto actor_field = sv(field.begin(), name_loc_sep);
     field.remove_prefix(static_cast<sv::size_type>(std::distance(field.begin(), name_loc_sep) + 1));
 
-    const auto loc_health_sep = std::find(field.begin(), field.end(), '|');
+    const auto loc_health_sep = std::next(field.begin(), static_cast<sv::difference_type>(find_delimiter(field, '|')));
     if (loc_health_sep == field.end()) {
-        LL(error) << "field missing location/health separator, '|'. Skipping.";
+        LL_FAILED(error) << "field missing location/health separator, '|'. Skipping.";
             return {};
     }
     const auto location_field = sv(field.begin(), loc_health_sep);
     auto health_field = sv(std::next(loc_health_sep), field.end());
 
-    auto actor = parse_source_target_actor(actor_field);
+    auto actor = parse_source_target_actor_view(actor_field);
     if (!actor) {
-        LL(error) << "Failed to parse s/t actor subfield. Skipping.";
+        LL_FAILED(error) << "Failed to parse s/t actor subfield. Skipping.";
         return {};
     }
 
     auto loc_str = get_next_field(location_field, '(', ')');
     if (!loc_str) {
-        LL(error) << "Location delimiters '()' not found. Skipping.";
+        LL_FAILED(error) << "Location delimiters '()' not found. Skipping.";
         return {};
     }
-    auto location = parse_st_location(*loc_str);
-    if (!location) {
-        LL(error) << "Failed to parse location subfield. Skipping.";
-        return {};
+    LogParserTypes::Location location;
+    if constexpr (DecodeLocation) {
+        const auto parsed = parse_st_location(*loc_str);
+        if (!parsed) {
+            LL_FAILED(error) << "Failed to parse location subfield. Skipping.";
+            return {};
+        }
+        location = *parsed;
     }
 
     auto health_str = get_next_field(health_field, '(', ')');
     if (!health_str) {
-        LL(error) << "Health field delimiters '()' not found. Skipping.";
+        LL_FAILED(error) << "Health field delimiters '()' not found. Skipping.";
         return {};
     }
 
-    auto health = parse_st_health(*health_str);
-    if (!health) {
-        LL(error) << "Failed to parse s/t health subfield. Skipping..";
-        return {};
+    LogParserTypes::Health health;
+    if constexpr (DecodeHealth) {
+        const auto parsed = parse_st_health(*health_str);
+        if (!parsed) {
+            LL_FAILED(error) << "Failed to parse s/t health subfield. Skipping..";
+            return {};
+        }
+        health = *parsed;
     }
 
-    return LogParserTypes::SourceOrTarget {.actor = *actor, .loc = *location, .health = *health};
+    return LogParserTypes::SourceOrTargetView {.actor = *actor, .loc = location, .health = health};
 }
 
-auto LogParserHelpers::parse_ability_field(std::string_view field) const -> std::optional<LogParserTypes::Ability> {
+template auto LogParserHelpers::parse_source_target_field_view<true, true>(sv) const
+    -> std::optional<LogParserTypes::SourceOrTargetView>;
+template auto LogParserHelpers::parse_source_target_field_view<true, false>(sv) const
+    -> std::optional<LogParserTypes::SourceOrTargetView>;
+template auto LogParserHelpers::parse_source_target_field_view<false, true>(sv) const
+    -> std::optional<LogParserTypes::SourceOrTargetView>;
+template auto LogParserHelpers::parse_source_target_field_view<false, false>(sv) const
+    -> std::optional<LogParserTypes::SourceOrTargetView>;
+
+auto LogParserHelpers::parse_ability_field_view(std::string_view field) const -> std::optional<LogParserTypes::AbilityView> {
     LL(trace) << "parsing ability from field " << std::quoted(field);
 
-    return parse_name_and_id(field);
+    return parse_name_and_id_view(field);
 }
 
-auto LogParserHelpers::parse_action_field(sv field) const -> std::optional<Action> {
+auto LogParserHelpers::parse_action_field_view(sv field) const -> std::optional<LogParserTypes::ActionView> {
     LL(trace) << "parsing action verb from field " << std::quoted(field);
 
-    auto action_verb = parse_name_and_id(field);
+    auto action_verb = parse_name_and_id_view(field);
     if (!action_verb) {
-        LL(error) << "Unable to parse action verb from field. Skipping.";
+        LL_FAILED(error) << "Unable to parse action verb from field. Skipping.";
         return {};
     }
     
     auto colon = std::find(field.begin(), field.end(), ':');
     if (colon == field.end()) {
-        LL(error) << "Missing separator (:) between action verb and action noun. Skipping.";
+        LL_FAILED(error) << "Missing separator (:) between action verb and action noun. Skipping.";
         return {};
     }
     field.remove_prefix(static_cast<sv::size_type>(std::distance(field.begin(), colon) + 1));
 
     uint64_t dist_to_first_char_after_id {};
     LL(trace) << "parsing action noun from field " << std::quoted(field);
-    auto action_noun = parse_name_and_id(field, &dist_to_first_char_after_id);
+    auto action_noun = parse_name_and_id_view(field, &dist_to_first_char_after_id);
     if (!action_noun) {
-        LL(error) << "Unable to parse action noun from field. Skipping.";
+        LL_FAILED(error) << "Unable to parse action noun from field. Skipping.";
         return {};
     }
     field.remove_prefix(dist_to_first_char_after_id);
     
-    Action ret {Action::Verb(*action_verb), Action::Noun(*action_noun), Action::Detail(std::optional<LogParserTypes::NameId>())};
+    LogParserTypes::ActionView ret {.verb = *action_verb, .noun = *action_noun, .detail = {}};
 
     if (field.empty()) {
         LL(trace) << "Action noun has no additional details.";
@@ -445,27 +580,53 @@ auto LogParserHelpers::parse_action_field(sv field) const -> std::optional<Actio
     }
 
     if (field[0] != ' ' && field[0] != '/') {
-        LL(error) << "Remaining field to be parsed: " << std::quoted(field);
-        LL(error) << "Action noun details subfield separator (' ' or '/') not found - "
+        LL_FAILED(error) << "Remaining field to be parsed: " << std::quoted(field);
+        LL_FAILED(error) << "Action noun details subfield separator (' ' or '/') not found - "
                   << "got " << field[0] << "' instead? Ignoring and return.";
         return ret;
     }
     field.remove_prefix(1);
 
-    auto noun_details = parse_name_and_id(field);
+    auto noun_details = parse_name_and_id_view(field);
     if (!noun_details) {
-        LL(error) << "Found details delimiter but unable to parse action noun details from field. Skipping.";
+        LL_FAILED(error) << "Found details delimiter but unable to parse action noun details from field. Skipping.";
         return {};
     }
 
-    ret.detail = Action::Detail(noun_details);
+    ret.detail = noun_details;
     return ret;
 }
 
-auto LogParserHelpers::parse_mitigation_effect(std::string_view field) const -> std::optional<LogParserTypes::MitigationEffect> {
+auto LogParserHelpers::scan_action_ids(sv field) const -> std::optional<std::pair<uint64_t, uint64_t>> {
+    uint64_t dist_beyond_id {};
+    const auto verb_id = get_next_field(field, '{', '}', &dist_beyond_id);
+    if (!verb_id) {
+        return {};
+    }
+    field.remove_prefix(dist_beyond_id);
+
+    const auto colon = field.find(':');
+    if (colon == sv::npos) {
+        return {};
+    }
+    field.remove_prefix(colon + 1);
+    const auto noun_id = get_next_field(field, '{', '}');
+    if (!noun_id) {
+        return {};
+    }
+
+    const auto verb = str_to_uint64(*verb_id);
+    const auto noun = str_to_uint64(*noun_id);
+    if (!verb || !noun) {
+        return {};
+    }
+    return std::pair {*verb, *noun};
+}
+
+auto LogParserHelpers::parse_mitigation_effect_view(std::string_view field) const -> std::optional<LogParserTypes::MitigationEffectView> {
     LL(trace) << "Parsing mitigation effect from field " << std::quoted(field);
 
-    LogParserTypes::MitigationEffect effect;
+    LogParserTypes::MitigationEffectView effect;
     uint64_t idx_just_beyond {};
     auto eff_value = str_to_double(field, &idx_just_beyond);
     if (eff_value) {
@@ -475,29 +636,29 @@ auto LogParserHelpers::parse_mitigation_effect(std::string_view field) const ->
     }
 
     if (!field.empty()) {
-        effect.effect = parse_name_and_id(field);
+        effect.effect = parse_name_and_id_view(field);
     }
 
     return effect;
 }
 
-auto LogParserHelpers::parse_value_field(std::string_view field) const -> std::optional<LogParserTypes::Value> {
+auto LogParserHelpers::parse_value_field_view(std::string_view field) const -> std::optional<LogParserTypes::ValueView> {
     LL(trace) << "Parsing value from field " << std::quoted(field);
 
     if (field.starts_with("he")) {
         LL(trace) << "Value is the unique sentinel " << std::quoted(field);
-        return LogParserTypes::LogInfoValue {.info = {field.begin(), field.end()}};
+        return LogParserTypes::LogInfoValueView {.info = field};
     }
 
     uint64_t steps_past_subfield {};
     auto base_value = str_to_double(field, &steps_past_subfield);
     if (!base_value) {
-        LL(error) << "Unable to parse value field's base value as number. Skipping.";
+        LL_FAILED(error) << "Unable to parse value field's base value as number. Skipping.";
         return {};
     }
     field.remove_prefix(steps_past_subfield);
 
-    LogParserTypes::RealValue ret {};
+    LogParserTypes::RealValueView ret {};
     ret.base_value = static_cast<uint64_t>(*base_value);
 
     if (field.empty()) {
@@ -517,7 +678,7 @@ auto LogParserHelpers::parse_value_field(std::string_view field) const -> std::o
         field.remove_prefix(1);
         auto eff_value = str_to_double(field, &steps_past_subfield);
         if (!eff_value) {
-            LL(error) << "Effective value sentinel (~) found but can't parse as a number. Skipping.";
+            LL_FAILED(error) << "Effective value sentinel (~) found but can't parse as a number. Skipping.";
             return {};
         }
         ret.effective = eff_value;
@@ -544,12 +705,12 @@ auto LogParserHelpers::parse_value_field(std::string_view field) const -> std::o
     LL(trace) << "effect_subf = " << std::quoted(effect_subf);
     
     if (!type_subf.empty()) {
-        ret.type = parse_name_and_id(type_subf);
+        ret.type = parse_name_and_id_view(type_subf);
     }
     // >1 accounts for the '-' sentinel that starts the field. If there's nothing after the sentinel, who cares?
     if (reason_subf.length() > 1) {
         reason_subf.remove_prefix(1);
-        ret.mitigation_reason = parse_name_and_id(reason_subf);
+        ret.mitigation_reason = parse_name_and_id_view(reason_subf);
     }
 
     if (effect_subf.empty()) {
@@ -559,12 +720,12 @@ auto LogParserHelpers::parse_value_field(std::string_view field) const -> std::o
     if (!maybe_effect) {
         return ret;
     }
-    ret.mitigation_effect = parse_mitigation_effect(*maybe_effect);
+    ret.mitigation_effect = parse_mitigation_effect_view(*maybe_effect);
 
     return ret;
 }
 
-auto LogParserHelpers::parse_threat_field(std::string_view field) const -> std::optional<LogParserTypes::Threat> {
+auto LogParserHelpers::parse_threat_field_view(std::string_view field) const -> std::optional<LogParserTypes::ThreatView> {
     LL(trace) << "parsing threat from field " << std::quoted(field);
 
     if (field.empty()) {
@@ -576,5 +737,43 @@ auto LogParserHelpers::parse_threat_field(std::string_view field) const -> std::
         return *thr_dub;
     }
 
-    return std::string{field};
+    return field;
+}
+
+// The owning parsers are the view parsers followed by a copy of the strings.
+
+auto LogParserHelpers::parse_name_and_id(sv field, uint64_t* dist_beyond_field_delim) const -> std::optional<LogParserTypes::NameId> {
+    return LogParserTypes::materialize(parse_name_and_id_view(field, dist_beyond_field_delim));
+}
+
+auto LogParserHelpers::parse_name_id_instance(sv field) const -> std::optional<LogParserTypes::NameIdInstance> {
+    return LogParserTypes::materialize(parse_name_id_instance_view(field));
+}
+
+auto LogParserHelpers::parse_source_target_actor(sv field) const -> std::optional<LogParserTypes::Actor> {
+    return LogParserTypes::materialize(parse_source_target_actor_view(field));
+}
+
+auto LogParserHelpers::parse_source_target_field(sv field) const -> std::optional<LogParserTypes::SourceOrTarget> {
+    return LogParserTypes::materialize(parse_source_target_field_view(field));
+}
+
+auto LogParserHelpers::parse_ability_field(sv field) const -> std::optional<LogParserTypes::Ability> {
+    return LogParserTypes::materialize(parse_ability_field_view(field));
+}
+
+auto LogParserHelpers::parse_action_field(sv field) const -> std::optional<Action> {
+    return LogParserTypes::materialize(parse_action_field_view(field));
+}
+
+auto LogParserHelpers::parse_mitigation_effect(sv field) const -> std::optional<LogParserTypes::MitigationEffect> {
+    return LogParserTypes::materialize(parse_mitigation_effect_view(field));
+}
+
+auto LogParserHelpers::parse_value_field(sv field) const -> std::optional<LogParserTypes::Value> {
+    return LogParserTypes::materialize(parse_value_field_view(field));
+}
+
+auto LogParserHelpers::parse_threat_field(sv field) const -> std::optional<LogParserTypes::Threat> {
+    return LogParserTypes::materialize(parse_threat_field_view(field));
 }
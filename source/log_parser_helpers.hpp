@@ -4,29 +4,51 @@
 #include <string_view>
 #include <optional>
 #include <cstdint>
+#include <utility>
 
+#include "delimiter_index.hpp"
 #include "log_parser_types.hpp"
 
 class LogParserHelpers {
 public:
-    auto set_line_num(int line_num) -> void {
-	m_line_num = line_num;
-    }
+    /**
+     * Index a line's delimiters for as long as the scope lasts
+     *
+     * While it lasts, get_next_field() and find_delimiter() on the line or any part of it step between the indexed
+     * delimiters instead of scanning every character. Fields come out the same either way. The line must outlive the
+     * scope. Where the index can't be built with vector instructions, lines aren't indexed.
+     */
+    class IndexedLine {
+    public:
+        IndexedLine(LogParserHelpers& lph, std::string_view line) : m_lph(lph) {
+            if constexpr (DelimiterIndex::VECTORIZED) {
+                m_lph.m_delims.build(line);
+            }
+        }
+        ~IndexedLine() {
+            m_lph.m_delims.clear();
+        }
+        IndexedLine(const IndexedLine&) = delete;
+        auto operator=(const IndexedLine&) -> IndexedLine& = delete;
+
+    private:
+        LogParserHelpers& m_lph;
+    };
 
     /**
      * Convert a string to a uint64
      *
-     * Relies on cstdlib `strtoul()` with additional checks to trigger failure if no integer is found.
+     * Behaves like cstdlib `strtoul()` in base 10 - leading whitespace and a '+' are skipped - with additional checks to
+     * trigger failure if no integer is found. Uses `std::from_chars()`, so it doesn't allocate or depend on the locale.
      *
      * @param[in] field String to be parsed for an integer
      * @param[out] dist_to_first_non_int_char [optional] On success, populated with the number of steps to reach the
      *     first character past the integer, aka the index of the first non-integer character.
      * 
      * @returns Optional that wraps a uint64 on success or empty optional in the following conditions: <ol>
-     *   <li> `strtoul()` sets errno to non-zero
-     *   <li> `strtoul()` returns ULONG_MAX
-     *   <li> `strtoul()` sets its out-param `endptr` to the beginning of the input `field`. This is
-     *   an additional check to catch emptry strings or strings only of whitespace.
+     *   <li> the integer is out of range
+     *   <li> the integer is ULONG_MAX
+     *   <li> no integer is found, which catches empty strings or strings only of whitespace.
      * </ol>
      */
     auto str_to_uint64(std::string_view field, uint64_t* dist_to_first_non_int_char=nullptr) const -> std::optional<uint64_t> ;
@@ -52,22 +74,36 @@ public:
     /**
      * Convert a string to a double
      *
-     * Relies on cstdlib strtod() with additional checks to trigger failure if no double is found.
+     * Behaves like cstdlib strtod() - leading whitespace and a '+' are skipped - with additional checks to trigger failure
+     * if no double is found. Uses `std::from_chars()`, so it doesn't allocate or depend on the locale.
      *
      * @param[in] field String to be parsed for an double
      * @param[out] dist_to_first_non_double_char [optional] On success, populated with the number of steps to reach the
      *     first character past the double, aka the index of the first non-double character.
      * 
      * @returns Optional that wraps a double on success or empty optional in the following conditions: <ol>
-     *   <li> `strtod` sets errno to non-zero and returns 0.0
-     *   <li> `strtod` sets errno to non-zero and returns HUGE_VAL
-     *   <li> `strtod` sets its out-param `endptr` to the beginning of the input `field`. This is
-     *       an additional check to catch emptry strings or strings only of whitespace.
+     *   <li> the double overflows or underflows
+     *   <li> no double is found, which catches empty strings or strings only of whitespace.
      *   <li> the double has nothing beyond the decimal point (e.g. "1."). This form is not useful in our context.
      * </ol>
      */
     auto str_to_double(std::string_view field, uint64_t* dist_to_first_non_double_char=nullptr) const -> std::optional<double> ;
 
+    /**
+     * Decode a plain fixed-point number
+     *
+     * A fast path for the `-?\d+(\.\d+)?` numbers that make up s/t locations. The result is identical to
+     * str_to_double()'s, but there's no leading whitespace, '+', exponent, or other form to consider.
+     *
+     * @param[in] field String starting with the number
+     * @param[out] dist_to_first_non_double_char [optional] On success, populated with the index of the first character
+     *     past the number.
+     *
+     * @returns The number, or an empty optional if `field` doesn't start with a plain fixed-point number of at most 15
+     *     digits. An empty optional doesn't mean `field` isn't a double; use str_to_double() to find out.
+     */
+    auto parse_fixed_point(std::string_view field, uint64_t* dist_to_first_non_double_char=nullptr) const -> std::optional<double>;
+
     /**
      * Remove characters from the beginning of a string
      *
@@ -122,6 +158,13 @@ public:
     auto get_next_field(std::string_view line, char begin_delim, char end_delim,
 			uint64_t* dist_beyond_field_char=nullptr) const -> std::optional<std::string_view>;
 
+    /**
+     * Find a delimiter, from the index if `field` is part of the current IndexedLine
+     *
+     * @returns The position of the first `delim` in `field`, or field.size() if there's none.
+     */
+    auto find_delimiter(std::string_view field, char delim) const -> std::size_t;
+
     // More to do here - pass in timestamp handling class. not sure what ot return...
     // auto parse_timestamp(std::string_view field) -> std::optional
 
@@ -176,6 +219,11 @@ public:
      */
     auto parse_name_and_id(std::string_view field, uint64_t* dist_beyond_field_delim=nullptr) const -> std::optional<LogParserTypes::NameId>;
 
+    /**
+     * As parse_name_and_id(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_name_and_id_view(std::string_view field, uint64_t* dist_beyond_field_delim=nullptr) const -> std::optional<LogParserTypes::NameIdView>;
+
     /**
      * Parse a string name, numeric ID, and numeric instance from a string
      *
@@ -193,6 +241,11 @@ public:
      */
     auto parse_name_id_instance(std::string_view field) const -> std::optional<LogParserTypes::NameIdInstance>;
 
+    /**
+     * As parse_name_id_instance(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_name_id_instance_view(std::string_view field) const -> std::optional<LogParserTypes::NameIdInstanceView>;
+
     /**
      * Parse the actor of a source/target field
      *
@@ -219,6 +272,11 @@ public:
      */
     auto parse_source_target_actor(std::string_view field) const -> std::optional<LogParserTypes::Actor>;
 
+    /**
+     * As parse_source_target_actor(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_source_target_actor_view(std::string_view field) const -> std::optional<LogParserTypes::ActorView>;
+
     /**
      * Parse a source or target (s/t) field
      *
@@ -256,6 +314,19 @@ public:
      */
     auto parse_source_target_field(std::string_view field) const -> std::optional<LogParserTypes::SourceOrTarget>;
 
+    /**
+     * As parse_source_target_field(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_source_target_field_view(std::string_view field) const -> std::optional<LogParserTypes::SourceOrTargetView>;
+
+    /**
+     * As parse_source_target_field_view(), but decoding the location and health subfields only if asked to
+     *
+     * A subfield that isn't decoded must still be present and delimited. It's left zero in the result.
+     */
+    template <bool DecodeLocation, bool DecodeHealth>
+    auto parse_source_target_field_view(std::string_view field) const -> std::optional<LogParserTypes::SourceOrTargetView>;
+
     /**
      * Parse the ability field
      *
@@ -268,6 +339,11 @@ public:
      */
     auto parse_ability_field(std::string_view field) const -> std::optional<LogParserTypes::Ability>;
 
+    /**
+     * As parse_ability_field(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_ability_field_view(std::string_view field) const -> std::optional<LogParserTypes::AbilityView>;
+
     /**
      * Parse the action field
      *
@@ -302,6 +378,24 @@ public:
      */
     auto parse_action_field(std::string_view field) const -> std::optional<LogParserTypes::Action>;
 
+    /**
+     * As parse_action_field(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_action_field_view(std::string_view field) const -> std::optional<LogParserTypes::ActionView>;
+
+    /**
+     * Find the verb and noun IDs of an action field without parsing the rest of it
+     *
+     * A cheap way to tell which action a line is before deciding whether to parse it. The field is in the form
+     * parse_action_field() takes, `verb {id}: noun {id}...`, but only the two IDs are decoded; the names and any detail
+     * aren't looked at.
+     *
+     * @param[in] field view to scan
+     *
+     * @returns The verb and noun IDs, or an empty optional if either can't be found.
+     */
+    auto scan_action_ids(std::string_view field) const -> std::optional<std::pair<uint64_t, uint64_t>>;
+
     /**
      * Parse the mitigation effect subfield of the value field
      *
@@ -323,6 +417,11 @@ public:
      */
     auto parse_mitigation_effect(std::string_view field) const -> std::optional<LogParserTypes::MitigationEffect>;
 
+    /**
+     * As parse_mitigation_effect(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_mitigation_effect_view(std::string_view field) const -> std::optional<LogParserTypes::MitigationEffectView>;
+
     /**
      * Parse the value field
      *
@@ -388,6 +487,11 @@ public:
      */
     auto parse_value_field(std::string_view field) const -> std::optional<LogParserTypes::Value>;
 
+    /**
+     * As parse_value_field(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_value_field_view(std::string_view field) const -> std::optional<LogParserTypes::ValueView>;
+
     /**
      * Parse the threat field
      *
@@ -406,7 +510,12 @@ public:
      */
     auto parse_threat_field(std::string_view field) const -> std::optional<LogParserTypes::Threat>;
 
+    /**
+     * As parse_threat_field(), but the result refers to `field` rather than copying from it
+     */
+    auto parse_threat_field_view(std::string_view field) const -> std::optional<LogParserTypes::ThreatView>;
+
 private:
-    // Used by all parsing functions to populate logging messages.
-    int m_line_num {0};
+    // The line of the current IndexedLine, if any.
+    DelimiterIndex m_delims;
 }; // class LogParserHelpers
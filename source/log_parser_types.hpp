@@ -3,6 +3,7 @@
 
 #include <cmath>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <variant>
 #include <cstdint>
@@ -73,6 +74,10 @@ namespace LogParserTypes {
 	Noun noun;
 	Detail detail;
     };
+    // The actions that begin and end areas and combats. These are extracted from a log.
+    inline constexpr uint64_t AREA_ENTERED_ID {836045448953664}; // Action verb
+    inline constexpr uint64_t ENTER_COMBAT_ID {836045448945489}; // Action noun
+    inline constexpr uint64_t EXIT_COMBAT_ID  {836045448945490}; // Action noun
     struct LogInfoValue {
 	std::string info;
     };
@@ -99,4 +104,193 @@ namespace LogParserTypes {
 	std::optional<Value> value;
 	std::optional<Threat> threat;
     };
+
+    /*
+     * Non-owning counterparts of the types above, produced by LogParser::parse_line_view()
+     *
+     * Every string is a std::string_view into the log line that was parsed, so producing one allocates nothing, but it
+     * must not outlive that line. Use materialize() to get the owning type.
+     */
+    struct NameIdView {
+        std::string_view name;
+        uint64_t id {};
+    };
+    struct NameIdInstanceView {
+        NameIdView name_id;
+        uint64_t instance;
+    };
+    using PcActorView = NameIdView;
+    using NpcActorView = NameIdInstanceView;
+    struct CompanionActorView {
+        NameIdView pc;
+        NameIdInstanceView companion;
+    };
+    using ActorView = std::variant<PcActorView, NpcActorView, CompanionActorView>;
+    struct SourceOrTargetView {
+        ActorView actor;
+        Location loc;
+        Health health;
+    };
+    using AbilityView = NameIdView;
+    struct ActionView {
+        NameIdView verb;
+        NameIdView noun;
+        std::optional<NameIdView> detail;
+    };
+    struct LogInfoValueView {
+        std::string_view info;
+    };
+    struct MitigationEffectView {
+        std::optional<uint64_t> value;
+        std::optional<NameIdView> effect;
+    };
+    struct RealValueView {
+        uint64_t base_value {0};
+        bool crit {false};
+        std::optional<uint64_t> effective;
+        std::optional<NameIdView> type;
+        std::optional<NameIdView> mitigation_reason;
+        std::optional<MitigationEffectView> mitigation_effect;
+    };
+    using ValueView = std::variant<LogInfoValueView, RealValueView>;
+    using ThreatView = std::variant<double, std::string_view>;
+    struct ParsedLogLineView {
+        Timestamps::timestamp ts;
+        std::optional<SourceOrTargetView> source;
+        std::optional<SourceOrTargetView> target;
+        std::optional<NameIdView> ability;
+        ActionView action;
+        std::optional<ValueView> value;
+        std::optional<ThreatView> threat;
+    };
+
+    /*
+     * Copy a view type into its owning type
+     *
+     * Only the strings are copied; this is the one place a parse allocates.
+     */
+    inline auto materialize(const NameIdView& v) -> NameId {
+        return NameId {.name = std::string(v.name), .id = v.id};
+    }
+    inline auto materialize(const NameIdInstanceView& v) -> NameIdInstance {
+        return NameIdInstance {.name_id = materialize(v.name_id), .instance = v.instance};
+    }
+    inline auto materialize(const CompanionActorView& v) -> CompanionActor {
+        return CompanionActor {.pc = materialize(v.pc), .companion = materialize(v.companion)};
+    }
+    inline auto materialize(const ActorView& v) -> Actor {
+        return std::visit([] (const auto& alt) -> Actor { return materialize(alt); }, v);
+    }
+    inline auto materialize(const SourceOrTargetView& v) -> SourceOrTarget {
+        return SourceOrTarget {.actor = materialize(v.actor), .loc = v.loc, .health = v.health};
+    }
+    inline auto materialize(const ThreatView& v) -> Threat {
+        if (std::holds_alternative<double>(v)) {
+            return std::get<double>(v);
+        }
+        return std::string(std::get<std::string_view>(v));
+    }
+    template <typename V>
+    auto materialize(const std::optional<V>& v) -> std::optional<decltype(materialize(*v))> {
+        if (!v) {
+            return {};
+        }
+        return materialize(*v);
+    }
+    inline auto materialize(const ActionView& v) -> Action {
+        return Action(Action::Verb(materialize(v.verb)),
+                      Action::Noun(materialize(v.noun)),
+                      Action::Detail(materialize(v.detail)));
+    }
+    inline auto materialize(const LogInfoValueView& v) -> LogInfoValue {
+        return LogInfoValue {.info = std::string(v.info)};
+    }
+    inline auto materialize(const MitigationEffectView& v) -> MitigationEffect {
+        return MitigationEffect {.value = v.value, .effect = materialize(v.effect)};
+    }
+    inline auto materialize(const RealValueView& v) -> RealValue {
+        return RealValue {.base_value = v.base_value,
+                          .crit = v.crit,
+                          .effective = v.effective,
+                          .type = materialize(v.type),
+                          .mitigation_reason = materialize(v.mitigation_reason),
+                          .mitigation_effect = materialize(v.mitigation_effect)};
+    }
+    inline auto materialize(const ValueView& v) -> Value {
+        return std::visit([] (const auto& alt) -> Value { return materialize(alt); }, v);
+    }
+    inline auto materialize(const ParsedLogLineView& v) -> ParsedLogLine {
+        return ParsedLogLine {.ts = v.ts,
+                              .source = materialize(v.source),
+                              .target = materialize(v.target),
+                              .ability = materialize(v.ability),
+                              .action = materialize(v.action),
+                              .value = materialize(v.value),
+                              .threat = materialize(v.threat)};
+    }
+
+    /*
+     * View an owning type as its non-owning counterpart; the inverse of materialize()
+     *
+     * Nothing is copied. The view refers to the owning object's strings, so it must not outlive it.
+     */
+    inline auto view_of(const NameId& v) -> NameIdView {
+        return NameIdView {.name = v.name, .id = v.id};
+    }
+    inline auto view_of(const NameIdInstance& v) -> NameIdInstanceView {
+        return NameIdInstanceView {.name_id = view_of(v.name_id), .instance = v.instance};
+    }
+    inline auto view_of(const CompanionActor& v) -> CompanionActorView {
+        return CompanionActorView {.pc = view_of(v.pc), .companion = view_of(v.companion)};
+    }
+    inline auto view_of(const Actor& v) -> ActorView {
+        return std::visit([] (const auto& alt) -> ActorView { return view_of(alt); }, v);
+    }
+    inline auto view_of(const SourceOrTarget& v) -> SourceOrTargetView {
+        return SourceOrTargetView {.actor = view_of(v.actor), .loc = v.loc, .health = v.health};
+    }
+    inline auto view_of(const Threat& v) -> ThreatView {
+        if (std::holds_alternative<double>(v)) {
+            return std::get<double>(v);
+        }
+        return std::string_view(std::get<std::string>(v));
+    }
+    template <typename T>
+    auto view_of(const std::optional<T>& v) -> std::optional<decltype(view_of(*v))> {
+        if (!v) {
+            return {};
+        }
+        return view_of(*v);
+    }
+    inline auto view_of(const Action& v) -> ActionView {
+        return ActionView {.verb = view_of(v.verb.cref()),
+                           .noun = view_of(v.noun.cref()),
+                           .detail = view_of(v.detail.cref())};
+    }
+    inline auto view_of(const LogInfoValue& v) -> LogInfoValueView {
+        return LogInfoValueView {.info = v.info};
+    }
+    inline auto view_of(const MitigationEffect& v) -> MitigationEffectView {
+        return MitigationEffectView {.value = v.value, .effect = view_of(v.effect)};
+    }
+    inline auto view_of(const RealValue& v) -> RealValueView {
+        return RealValueView {.base_value = v.base_value,
+                              .crit = v.crit,
+                              .effective = v.effective,
+                              .type = view_of(v.type),
+                              .mitigation_reason = view_of(v.mitigation_reason),
+                              .mitigation_effect = view_of(v.mitigation_effect)};
+    }
+    inline auto view_of(const Value& v) -> ValueView {
+        return std::visit([] (const auto& alt) -> ValueView { return view_of(alt); }, v);
+    }
+    inline auto view_of(const ParsedLogLine& v) -> ParsedLogLineView {
+        return ParsedLogLineView {.ts = v.ts,
+                                  .source = view_of(v.source),
+                                  .target = view_of(v.target),
+                                  .ability = view_of(v.ability),
+                                  .action = view_of(v.action),
+                                  .value = view_of(v.value),
+                                  .threat = view_of(v.threat)};
+    }
 } // namespace LogParserTypes
@@ -1,4 +1,8 @@
+#include <chrono>
 #include <cstdlib>
+#include <mutex>
+#include <ostream>
+#include <utility>
 #include <map>
 #include <string>
 
@@ -25,3 +29,36 @@ auto set_log_filter() -> void { //
         }
     }
 }
+
+auto RateLimitedLog::allow() -> bool {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock {m_mutex};
+    if (now - m_window_start >= m_interval) {
+        m_window_start = now;
+        m_in_window = 0;
+    }
+    if (m_in_window < m_burst) {
+        ++m_in_window;
+        return true;
+    }
+    ++m_suppressed;
+    ++m_total_suppressed;
+    return false;
+}
+
+auto RateLimitedLog::take_suppressed() -> Suppressed {
+    std::lock_guard lock {m_mutex};
+    return {std::exchange(m_suppressed, 0)};
+}
+
+auto RateLimitedLog::total_suppressed() const -> std::size_t {
+    std::lock_guard lock {m_mutex};
+    return m_total_suppressed;
+}
+
+auto operator<<(std::ostream& os, const RateLimitedLog::Suppressed& s) -> std::ostream& {
+    if (s.count > 0) {
+        os << "(" << s.count << " similar messages suppressed) ";
+    }
+    return os;
+}
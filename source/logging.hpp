@@ -1,8 +1,103 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+
 #include <boost/log/trivial.hpp>
 
-#define BLT(lev) BOOST_LOG_TRIVIAL(lev)
-#define BLT_LINE(lev, line) BOOST_LOG_TRIVIAL(lev) << "Line " << line << ": "
+// Least severe level that is compiled in: one of trace, debug, info, warning, error, or fatal. Set with the
+// SWTOR_MIN_LOG_LEVEL CMake cache variable. Sites below it compile to nothing, so they cost nothing on the parser's
+// hot path even though the BL_LEVEL filter would have dropped them anyway.
+#ifndef SWTOR_MIN_LOG_LEVEL
+#define SWTOR_MIN_LOG_LEVEL trace
+#endif
+
+constexpr auto MIN_LOG_LEVEL = boost::log::trivial::SWTOR_MIN_LOG_LEVEL;
+
+constexpr auto log_level_enabled(boost::log::trivial::severity_level lev) -> bool {
+    return lev >= MIN_LOG_LEVEL;
+}
+
+#define BLT(lev) \
+    if constexpr (!log_level_enabled(boost::log::trivial::lev)) {} else BOOST_LOG_TRIVIAL(lev)
+#define BLT_LINE(lev, line) BLT(lev) << "Line " << line << ": "
+
+/**
+ * Sets the number of the log line being parsed on this thread
+ *
+ * Code below the parser's entry point logs against current() rather than having the line number passed down or kept
+ * in shared state. Scopes nest; the previous line number is restored on exit.
+ */
+class LogLineScope {
+public:
+    explicit LogLineScope(int line_num) : m_prev(s_current) {
+        s_current = line_num;
+    }
+    ~LogLineScope() {
+        s_current = m_prev;
+    }
+    LogLineScope(const LogLineScope&) = delete;
+    auto operator=(const LogLineScope&) -> LogLineScope& = delete;
+
+    static auto current() -> int {
+        return s_current;
+    }
+
+private:
+    int m_prev;
+    static thread_local inline int s_current {0};
+};
+
+/**
+ * Throttle for diagnostics that can repeat on every line, like parse failures
+ *
+ * Lets up to `burst` messages through per `interval`, and counts the rest. The next message let through reports how
+ * many were suppressed before it. Safe to share between threads.
+ */
+class RateLimitedLog {
+public:
+    struct Suppressed {
+        std::size_t count {};
+    };
+
+    explicit RateLimitedLog(std::size_t burst = 10, std::chrono::steady_clock::duration interval = std::chrono::seconds(1))
+        : m_burst(burst), m_interval(interval) {}
+
+    /**
+     * Decide whether a message may be logged now
+     *
+     * @return true if it may; false if it was counted as suppressed.
+     */
+    auto allow() -> bool;
+
+    /**
+     * Take the number of messages suppressed since the last call, to stream before the next message
+     */
+    auto take_suppressed() -> Suppressed;
+
+    /**
+     * Total number of messages suppressed over the limiter's lifetime
+     */
+    auto total_suppressed() const -> std::size_t;
+
+private:
+    const std::size_t m_burst;
+    const std::chrono::steady_clock::duration m_interval;
+
+    mutable std::mutex m_mutex;
+    std::chrono::steady_clock::time_point m_window_start {};
+    std::size_t m_in_window {};
+    std::size_t m_suppressed {};
+    std::size_t m_total_suppressed {};
+};
+
+auto operator<<(std::ostream& os, const RateLimitedLog::Suppressed& s) -> std::ostream&;
+
+// BLT_LINE, but only if `limiter` allows it.
+#define BLT_LINE_LIMITED(limiter, lev, line) \
+    if constexpr (!log_level_enabled(boost::log::trivial::lev)) {} else if (!(limiter).allow()) {} else \
+        BOOST_LOG_TRIVIAL(lev) << (limiter).take_suppressed() << "Line " << line << ": "
 
 auto set_log_filter() -> void;
@@ -1,19 +1,30 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <algorithm>
 #include <variant>
-#include <fstream>
 #include <string>
+#include <charconv>
 #include <climits>
 #include <array>
 #include <boost/log/trivial.hpp>
 #include <boost/log/expressions.hpp>
 #include <unistd.h>
+#include <csignal>
 #include <cstdlib>
 #include <iomanip>
 #include <chrono>
 #include <memory>
 #include <map>
+#include <optional>
+#include <iostream>
+#include <span>
+#include <tuple>
+#include <vector>
 
-#include "generator.hpp"
+#include "binary_log.hpp"
+#include "event_store.hpp"
+#include "log_file_source.hpp"
+#include "log_follower.hpp"
+#include "log_index.hpp"
 #include "lib.hpp"
 #include "log_parser_types.hpp"
 #include "timestamps.hpp"
@@ -57,15 +68,15 @@ auto parse_combat_log_filename_timestamp(std::string_view log_filename) -> void
     }
 }
 
-auto log_source_target(const LogParserTypes::SourceOrTarget& st, int line_num, std::string_view st_str) -> void {
-    if (std::holds_alternative<LogParserTypes::PcActor>(st.actor)) {
-        const auto& pc = std::get<LogParserTypes::PcActor>(st.actor);
+auto log_source_target(const LogParserTypes::SourceOrTargetView& st, int line_num, std::string_view st_str) -> void {
+    if (std::holds_alternative<LogParserTypes::PcActorView>(st.actor)) {
+        const auto& pc = std::get<LogParserTypes::PcActorView>(st.actor);
         BLT_LINE(error, line_num) << "PC " << st_str << ": name=" << std::quoted(pc.name) << ", id=" << pc.id;
-    } else if (std::holds_alternative<LogParserTypes::NpcActor>(st.actor)) {
-        const auto& npc = std::get<LogParserTypes::NpcActor>(st.actor);
+    } else if (std::holds_alternative<LogParserTypes::NpcActorView>(st.actor)) {
+        const auto& npc = std::get<LogParserTypes::NpcActorView>(st.actor);
         BLT_LINE(error, line_num) << "NPC " << st_str << ": name=" << std::quoted(npc.name_id.name) << ", id=" << npc.name_id.id;
     } else {
-        const auto& comp = std::get<LogParserTypes::CompanionActor>(st.actor);
+        const auto& comp = std::get<LogParserTypes::CompanionActorView>(st.actor);
         BLT_LINE(error, line_num) << "Comp " << st_str << ": pc_name=" << std::quoted(comp.pc.name) << ", id=" << comp.pc.id
                                   << ", comp_name=" << std::quoted(comp.companion.name_id.name)
                                   << ", comp_id=" << comp.companion.name_id.id
@@ -73,13 +84,240 @@ auto log_source_target(const LogParserTypes::SourceOrTarget& st, int line_num, s
     }
 }
 
-auto file_reader(std::ifstream& ifs) -> Generator<std::string> {
-    std::string line;
-    getline(ifs, line);
-    while(ifs.good()) {
-        co_yield line;
-        getline(ifs, line);
+auto log_parsed_line(const LogParserTypes::ParsedLogLineView& log_entry, std::string_view linev, int line_num) -> void {
+    BLT_LINE(error, line_num) << linev;
+    BLT_LINE(error, line_num) << "ts = " << log_entry.ts;
+
+    if (!log_entry.source) {
+        BLT_LINE(error, line_num) << "Source field is empty.";
+    } else {
+        log_source_target(*log_entry.source, line_num, "source");
+    }
+
+    if (!log_entry.target) {
+        BLT_LINE(error, line_num) << "Target field is empty.";
+    } else {
+        log_source_target(*log_entry.target, line_num, "target");
+    }
+
+    const auto& ability = log_entry.ability;
+    if (ability) {
+        BLT_LINE(error, line_num) << "Ability: name=" << std::quoted(ability->name) << ", id=" << ability->id;
+    } else {
+        BLT_LINE(error, line_num) << "Ability field is empty.";
+    }
+
+    auto& action = log_entry.action;
+    auto has_detail = action.detail.has_value();
+    BLT_LINE(error, line_num) << "Action: verb=" << action.verb.name << ", noun=" << action.noun.name
+                              << ", detail=" << (has_detail? action.detail->name : std::string_view{"none"});
+    if (!log_entry.value) {
+        BLT_LINE(error, line_num) << "No value field present.";
+    } else {
+        auto& value = *log_entry.value;
+        if (std::holds_alternative<LogParserTypes::LogInfoValueView>(value)) {
+            BLT_LINE(error, line_num) << "Value: info=" << std::get<LogParserTypes::LogInfoValueView>(value).info;
+        } else if (std::holds_alternative<LogParserTypes::RealValueView>(value)) {
+            auto& rv = std::get<LogParserTypes::RealValueView>(value);
+            bool has_type = rv.type.has_value();
+            std::string_view type = has_type ? rv.type->name : "n/p";
+            bool has_eff = rv.effective.has_value();
+            std::string eff = has_eff ? std::to_string(*rv.effective) : "n/p";
+            bool has_mit_reas = rv.mitigation_reason.has_value();
+            std::string_view mit_reas = has_mit_reas ? rv.mitigation_reason->name : "n/p";
+            bool has_mit_eff = rv.mitigation_effect.has_value();
+            bool has_mit_eff_val = has_mit_eff && rv.mitigation_effect->value.has_value();
+            std::string mit_eff_val = has_mit_eff_val ? std::to_string(*rv.mitigation_effect->value) : "n/p";
+            bool has_mit_eff_eff = has_mit_eff && rv.mitigation_effect->effect.has_value();
+            std::string_view mit_eff_eff = has_mit_eff_eff ? rv.mitigation_effect->effect->name : "n/p";
+            BLT_LINE(error, line_num) << "Real value: base=" << rv.base_value << ", crit=" << rv.crit
+                                      << ", eff=" << eff << ", type=" << type << ", mit_reas=" << mit_reas
+                                      << ", mit_eff_val=" << mit_eff_val << "mit_eff_eff=" << mit_eff_eff;
+        }
+    }
+
+    if (!log_entry.threat) {
+        BLT_LINE(error, line_num) << "No threat field present.";
+    } else if (std::holds_alternative<double>(*log_entry.threat)) {
+        auto threat = std::get<double>(*log_entry.threat);
+        BLT_LINE(error, line_num) << "Threat: threat=" << threat;
+    } else {
+        auto threat = std::get<std::string_view>(*log_entry.threat);
+        BLT_LINE(error, line_num) << "Threat: threat=" << std::quoted(threat);
+    }
+}
+
+// Parse and log one line.
+auto explore_line(LogParser& lp, std::string_view linev, int line_num)
+    -> std::optional<LogParserTypes::ParsedLogLineView> {
+    BLT_LINE(info, line_num) << linev;
+
+    // skip blank lines.
+    if (linev.empty()) {
+      BLT_LINE(info, line_num) << "Line empty.  Skipping.";
+      return {};
+    }
+
+    auto log_entry = lp.parse_line_view(linev, line_num, *timestamps);
+    if (log_entry) {
+        log_parsed_line(*log_entry, linev, line_num);
+    }
+    return log_entry;
+}
+
+// Set by SIGINT to stop following a logfile.
+volatile std::sig_atomic_t stop_following {0};
+
+// Parse and log the lines of a logfile as the game appends them, until interrupted.
+auto follow_logfile(const std::string& log_path) -> int {
+    parse_combat_log_filename_timestamp(log_path);
+
+    auto follower = LogFollower::open(log_path);
+    if (!follower) {
+        BLT(error) << "Failed to open " << std::quoted(log_path) << " for following.";
+        return 1;
     }
+    BLT(info) << "Following " << std::quoted(log_path) << ". Interrupt to stop.";
+
+    std::signal(SIGINT, [] (int) { stop_following = 1; });
+
+    // Lines already in the index are skipped by it, so indexing carries on where it left off.
+    auto index = LogIndex::load_or_build(log_path).value_or(LogIndex());
+
+    LogParser lp;
+    while (!stop_following && !follower->finished()) {
+        const auto chunk = follower->next(std::chrono::milliseconds(250));
+        for (const auto& ll : LogFileSource::lines(chunk.text, chunk.first_line_num, chunk.offset)) {
+            if (auto entry = explore_line(lp, ll.text, ll.line_num)) {
+                index.add(ll, *entry);
+            }
+        }
+    }
+
+    index.save(LogIndex::sidecar_path(log_path));
+    BLT(info) << "Stopped following " << std::quoted(log_path) << " after line " << follower->line_num();
+    return 0;
+}
+
+// Parse and log only the lines of one combat, jumping to it with the log's index.
+auto explore_combat(const std::string& log_path, std::size_t combat) -> int {
+    parse_combat_log_filename_timestamp(log_path);
+
+    auto index = LogIndex::load_or_build(log_path);
+    auto log_in = LogFileSource::open(log_path);
+    if (!index || !log_in) {
+        BLT(error) << "Failed to open " << std::quoted(log_path) << " for reading.";
+        return 1;
+    }
+    const auto range = index->find_combat(combat);
+    if (!range) {
+        BLT(error) << std::quoted(log_path) << " has " << index->combat_count() << " combats, not " << combat << ".";
+        return 1;
+    }
+
+    LogIndex::resume_at(range->enter, *timestamps);
+    const auto end_line_num = range->exit ? range->exit->line_num : INT_MAX;
+    LogParser lp;
+    const auto& enter = range->enter;
+    for (const auto& [linev, line_num, offset] : LogFileSource::lines(log_in->contents().substr(enter.offset),
+                                                                      enter.line_num, enter.offset)) {
+        if (line_num > end_line_num) {
+            break;
+        }
+        explore_line(lp, linev, line_num);
+    }
+    return 0;
+}
+
+// Load logfiles into an EventStore and print the damage, healing, and threat of each source and ability in each
+// combat. No database is needed.
+auto summarize_logfiles(std::span<char*> log_paths) -> int {
+    EventStore store;
+    for (const auto* path : log_paths) {
+        const auto log_path = std::string(path);
+        parse_combat_log_filename_timestamp(log_path);
+        auto log_in = LogFileSource::open(log_path);
+        if (!log_in) {
+            BLT(error) << "Failed to open " << std::quoted(log_path) << " for reading. Skipping.";
+            continue;
+        }
+
+        if (BinaryLogReader::is_binary_log(log_in->contents())) {
+            // Converted with --convert; already parsed.
+            auto reader = BinaryLogReader::from_bytes(log_in->contents());
+            while (auto entry = reader ? reader->next() : std::nullopt) {
+                store.add(*entry);
+            }
+        } else {
+            LogParser lp;
+            for (const auto& [linev, line_num, offset] : log_in->lines()) {
+                if (linev.empty()) {
+                    continue;
+                }
+                if (auto entry = lp.parse_line_view(linev, line_num, *timestamps)) {
+                    store.add(*entry);
+                }
+            }
+        }
+        BLT(info) << "Loaded " << std::quoted(log_path) << ". " << store.size() << " events in the store.";
+    }
+
+    std::cout << "combat,source,ability,effect,events,hits,crits,total,effective,max_hit,threat\n";
+    for (uint32_t combat = 1; combat <= store.combats().size(); combat++) {
+        const auto rows = store.filter(store.rows_of_combat(combat), [&store] (uint32_t row) {
+            return (store.flags()[row] & (EventStore::HAS_VALUE | EventStore::HAS_THREAT)) != 0;
+        });
+        const auto groups = store.group_by(rows, [&store] (uint32_t row) {
+            return std::tuple(store.source()[row], store.ability()[row], store.action_info(store.action()[row]).noun);
+        });
+
+        std::vector<std::pair<decltype(groups)::key_type, EventStore::Totals>> sorted(groups.begin(), groups.end());
+        std::sort(sorted.begin(), sorted.end(), [] (const auto& a, const auto& b) {
+            return a.second.total > b.second.total;
+        });
+        for (const auto& [key, t] : sorted) {
+            const auto [source, ability, effect] = key;
+            std::cout << combat << "," << store.actor_name(source) << "," << store.name(ability) << ","
+                      << store.name(effect) << "," << t.events << "," << t.hits << "," << t.crits << "," << t.total
+                      << "," << t.effective << "," << t.max_hit << "," << t.threat << "\n";
+        }
+    }
+    return 0;
+}
+
+// Parse logfiles and write each one's entries in the binary log format to the same path with ".swtb" appended.
+auto convert_logfiles(std::span<char*> log_paths) -> int {
+    int failures = 0;
+    for (const auto* path : log_paths) {
+        const auto log_path = std::string(path);
+        parse_combat_log_filename_timestamp(log_path);
+        auto log_in = LogFileSource::open(log_path);
+        if (!log_in) {
+            BLT(error) << "Failed to open " << std::quoted(log_path) << " for reading. Skipping.";
+            failures += 1;
+            continue;
+        }
+
+        BinaryLogWriter writer;
+        LogParser lp;
+        for (const auto& [linev, line_num, offset] : log_in->lines()) {
+            if (linev.empty()) {
+                continue;
+            }
+            if (auto entry = lp.parse_line_view(linev, line_num, *timestamps)) {
+                writer.add(*entry);
+            }
+        }
+
+        const auto bin_path = log_path + ".swtb";
+        if (!writer.save(bin_path)) {
+            failures += 1;
+            continue;
+        }
+        BLT(info) << "Converted " << writer.size() << " entries of " << std::quoted(log_path) << " to "
+                  << std::quoted(bin_path);
+    }
+    return failures == 0 ? 0 : 1;
 }
 
 auto main(int argc, char** argv) -> int {
@@ -104,6 +342,29 @@ auto main(int argc, char** argv) -> int {
 
     BLT(info) << "Hello '" << lib.name << "' World!";
 
+    if (argc == 3 && std::string_view(argv[1]) == "--follow") {
+        return follow_logfile(argv[2]);
+    }
+
+    if (argc >= 3 && std::string_view(argv[1]) == "--summary") {
+        return summarize_logfiles(std::span(argv + 2, argc - 2));
+    }
+
+    if (argc == 4 && std::string_view(argv[1]) == "--combat") {
+        const std::string_view arg {argv[2]};
+        std::size_t combat {};
+        const auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), combat);
+        if (ec != std::errc{} || end != arg.data() + arg.size()) {
+            BLT(error) << "--combat takes the number of a combat in the log, not " << std::quoted(arg) << ".";
+            return 1;
+        }
+        return explore_combat(argv[3], combat);
+    }
+
+    if (argc >= 3 && std::string_view(argv[1]) == "--convert") {
+        return convert_logfiles(std::span(argv + 2, argc - 2));
+    }
+
     for (int li = 1; li < argc; ++li) {
         const auto log_path = std::string(argv[li]);
     // {"../../test/logs/combat_2025-05-15_13_31_56_714109.txt"};
@@ -111,93 +372,17 @@ auto main(int argc, char** argv) -> int {
 
     parse_combat_log_filename_timestamp(log_path);
 
-    std::ifstream log_in {log_path};
-    if (!log_in.good()) {
-        BLT(error) << "Failed to open " << std::quoted(log_path) << "for reading. Skipping.";
+    auto log_in = LogFileSource::open(log_path);
+    if (!log_in) {
+        BLT(error) << "Failed to open " << std::quoted(log_path) << " for reading. Skipping.";
         continue;
     }
     BLT(info) << "Successfully opened "  << std::quoted(log_path) << " for reading.";
 
-    int line_num = 0;
     LogParser lp;
 
-    for(auto& line : file_reader(log_in)) {
-        line_num += 1;
-
-        std::string_view linev(line);
-        linev.remove_suffix(1); // Chomp final character, which is always a CR.
-
-        BLT_LINE(info, line_num) << line;
-
-        // skip blank lines.
-        if (linev.empty()) {
-          BLT_LINE(info, line_num) << "Line empty.  Skipping.";
-          continue;
-        }
-
-        auto log_entry = lp.parse_line(linev, line_num, *timestamps);
-        if (log_entry) {
-            BLT_LINE(error, line_num) << linev;
-            BLT_LINE(error, line_num) << "ts = " << log_entry->ts;
-
-            if (!log_entry->source) {
-                BLT_LINE(error, line_num) << "Source field is empty.";
-            } else {
-                log_source_target(*log_entry->source, line_num, "source");
-            }
-
-            if (!log_entry->target) {
-                BLT_LINE(error, line_num) << "Target field is empty.";
-            } else {
-                log_source_target(*log_entry->target, line_num, "target");
-            }
-
-            const auto& ability = log_entry->ability;
-            if (ability) {
-                BLT_LINE(error, line_num) << "Ability: name=" << std::quoted(ability->name) << ", id=" << ability->id;
-            } else {
-                BLT_LINE(error, line_num) << "Ability field is empty.";
-            }
-
-            auto& action = log_entry->action;
-            auto has_detail = action.detail.ref().has_value();
-            BLT_LINE(error, line_num) << "Action: verb=" << action.verb.ref().name << ", noun=" << action.noun.ref().name
-                                      << ", detail=" << (has_detail? action.detail.ref()->name : "none");
-            if (!log_entry->value) {
-                BLT_LINE(error, line_num) << "No value field present.";
-            } else {
-                auto& value = *log_entry->value;
-                if (std::holds_alternative<LogParserTypes::LogInfoValue>(value)) {
-                    BLT_LINE(error, line_num) << "Value: info=" << std::get<LogParserTypes::LogInfoValue>(value).info;
-                } else if (std::holds_alternative<LogParserTypes::RealValue>(value)) {
-                    auto& rv = std::get<LogParserTypes::RealValue>(value);
-                    bool has_type = rv.type.has_value();
-                    std::string type = has_type ? rv.type->name : "n/p";
-                    bool has_eff = rv.effective.has_value();
-                    std::string eff = has_eff ? std::to_string(*rv.effective) : "n/p";
-                    bool has_mit_reas = rv.mitigation_reason.has_value();
-                    std::string mit_reas = has_mit_reas ? rv.mitigation_reason->name : "n/p";
-                    bool has_mit_eff = rv.mitigation_effect.has_value();
-                    bool has_mit_eff_val = has_mit_eff && rv.mitigation_effect->value.has_value();
-                    std::string mit_eff_val = has_mit_eff_val ? std::to_string(*rv.mitigation_effect->value) : "n/p";
-                    bool has_mit_eff_eff = has_mit_eff && rv.mitigation_effect->effect.has_value();
-                    std::string mit_eff_eff = has_mit_eff_eff ? rv.mitigation_effect->effect->name : "n/p";
-                    BLT_LINE(error, line_num) << "Real value: base=" << rv.base_value << ", crit=" << rv.crit
-                                              << ", eff=" << eff << ", type=" << type << ", mit_reas=" << mit_reas
-                                              << ", mit_eff_val=" << mit_eff_val << "mit_eff_eff=" << mit_eff_eff;
-                }
-            }
-
-            if (!log_entry->threat) {
-                BLT_LINE(error, line_num) << "No threat field present.";
-            } else if (std::holds_alternative<double>(*log_entry->threat)) {
-                auto threat = std::get<double>(*log_entry->threat);
-                BLT_LINE(error, line_num) << "Threat: threat=" << threat;
-            } else {
-                auto threat = std::get<std::string>(*log_entry->threat);
-                BLT_LINE(error, line_num) << "Threat: threat=" << std::quoted(threat);
-            }
-        }
+    for (const auto& [linev, line_num, offset] : log_in->lines()) {
+        explore_line(lp, linev, line_num);
     }
 
     BLT(info) << "Done parsing file " << std::quoted(log_path);
@@ -0,0 +1,130 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <thread>
+
+#include "log_parser.hpp"
+#include "logging.hpp"
+#include "parallel_log_parser.hpp"
+
+namespace sc = std::chrono;
+
+namespace {
+    struct ChunkResult {
+        std::vector<ParallelLogParser::Entry> entries;
+        std::size_t failed_lines {};
+
+        // Chunk-local timestamp state when the chunk is done; see Timestamps.
+        std::optional<sc::milliseconds> first_time_of_day;
+        std::optional<Timestamps::timestamp> last_ts;
+    };
+
+    auto parse_chunk(std::string_view chunk, int first_line_num, uint64_t first_offset, Timestamps ts,
+                     ChunkResult& res) -> void {
+        LogParser lp;
+        for (const auto& line : LogFileSource::lines(chunk, first_line_num, first_offset)) {
+            if (line.text.empty()) {
+                continue;
+            }
+            auto parsed = lp.parse_line_view(line.text, line.line_num, ts);
+            if (!parsed) {
+                ++res.failed_lines;
+                continue;
+            }
+            res.entries.push_back({line, std::move(*parsed)});
+        }
+        res.first_time_of_day = ts.first_log_entry_time_of_day();
+        res.last_ts = ts.current_log_timestamp();
+    }
+} // namespace
+
+ParallelLogParser::ParallelLogParser(unsigned num_threads)
+    : m_num_threads(num_threads > 0 ? num_threads : std::max(1U, std::thread::hardware_concurrency())) {
+}
+
+auto ParallelLogParser::split_into_chunks(std::string_view contents, unsigned num_chunks)
+    -> std::vector<std::string_view> {
+    std::vector<std::string_view> chunks;
+    const auto target = contents.size() / std::max(1U, num_chunks);
+    std::size_t begin {};
+    while (begin < contents.size()) {
+        auto end = std::min(begin + std::max<std::size_t>(target, 1), contents.size());
+        if (end < contents.size()) {
+            end = std::min(LogFileSource::find_line_end(contents, end - 1) + 1, contents.size());
+        }
+        if (chunks.size() + 1 == num_chunks) {
+            end = contents.size();
+        }
+        chunks.push_back(contents.substr(begin, end - begin));
+        begin = end;
+    }
+    return chunks;
+}
+
+auto ParallelLogParser::parse(std::string_view contents, Timestamps& ts_parser) const -> Result {
+    const auto chunks = split_into_chunks(contents, m_num_threads);
+
+    // Line numbers, for logging, need the number of lines before each chunk. Counting is far cheaper than parsing.
+    std::vector<int> first_line_nums {1};
+    for (const auto& chunk : chunks) {
+        const auto num_lines = std::count(chunk.begin(), chunk.end(), '\n');
+        first_line_nums.push_back(first_line_nums.back() + static_cast<int>(num_lines));
+    }
+
+    // Every chunk starts at midnight of the log's creation day with no previous entry to roll over from.
+    const auto chunk_day = sc::floor<sc::days>(ts_parser.log_creation_timestamp());
+    auto chunk_ts = ts_parser;
+    chunk_ts.resume(chunk_day);
+
+    std::vector<ChunkResult> chunk_results(chunks.size());
+    {
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            const auto offset = static_cast<uint64_t>(chunks[i].data() - contents.data());
+            workers.emplace_back(parse_chunk, chunks[i], first_line_nums[i], offset, chunk_ts,
+                                 std::ref(chunk_results[i]));
+        }
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    // Fix up the days. Track the state the serial parser would be in, the same way Timestamps does.
+    const auto start = ts_parser.current_log_timestamp().value_or(ts_parser.log_creation_timestamp());
+    auto day_base = sc::floor<sc::days>(start);
+    auto prev_time_of_day = sc::duration_cast<sc::milliseconds>(start - day_base);
+    std::optional<Timestamps::timestamp> last_ts;
+
+    Result res;
+    std::size_t total_entries {};
+    for (const auto& cr : chunk_results) {
+        total_entries += cr.entries.size();
+    }
+    res.entries.reserve(total_entries);
+
+    for (auto& cr : chunk_results) {
+        res.failed_lines += cr.failed_lines;
+        if (!cr.first_time_of_day) {
+            // No well-formed timestamps, so no entries, and no change to the state.
+            continue;
+        }
+        auto shift = day_base - chunk_day;
+        if (prev_time_of_day > *cr.first_time_of_day) {
+            shift += sc::days(1);
+        }
+        for (auto& e : cr.entries) {
+            e.parsed.ts += shift;
+            res.entries.push_back(std::move(e));
+        }
+        last_ts = *cr.last_ts + shift;
+        day_base = sc::floor<sc::days>(*last_ts);
+        prev_time_of_day = sc::duration_cast<sc::milliseconds>(*last_ts - day_base);
+    }
+
+    if (last_ts) {
+        ts_parser.resume(*last_ts);
+    }
+    return res;
+}
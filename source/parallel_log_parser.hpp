@@ -0,0 +1,61 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "log_file_source.hpp"
+#include "log_parser_types.hpp"
+#include "timestamps.hpp"
+
+/**
+ * Parses a whole log on several threads
+ *
+ * The log is split into chunks at line boundaries, one per thread, and each chunk is parsed by its own LogParser. A
+ * log entry only records its time of day, so a chunk can't know on its own how many midnights came before it. Each
+ * chunk is parsed as if it started at midnight of the log's creation day, and then a quick sequential pass shifts each
+ * chunk's timestamps by the days that came before it. The result is the same as parsing the lines one by one, in
+ * order, with LogParser::parse_line_view().
+ */
+class ParallelLogParser {
+public:
+    struct Entry {
+        LogLine line;
+        LogParserTypes::ParsedLogLineView parsed;
+    };
+
+    struct Result {
+        // Successfully parsed lines, in log order. Views into the parsed contents.
+        std::vector<Entry> entries;
+
+        // Non-blank lines that failed to parse.
+        std::size_t failed_lines {};
+    };
+
+    /**
+     * @param[in] num_threads Number of threads to parse with; 0 uses one per hardware thread
+     */
+    explicit ParallelLogParser(unsigned num_threads = 0);
+
+    /**
+     * Parse every non-blank line of a log
+     *
+     * @param[in] contents The whole log, e.g. LogFileSource::contents(). Must outlive the result.
+     * @param[in,out] ts_parser The log's timestamps. Resumed at the last log entry's timestamp, as if each line had been
+     *     parsed with it in turn.
+     */
+    auto parse(std::string_view contents, Timestamps& ts_parser) const -> Result;
+
+    /**
+     * Split `contents` into at most `num_chunks` pieces, each ending just after a newline (or at the end)
+     */
+    static auto split_into_chunks(std::string_view contents, unsigned num_chunks) -> std::vector<std::string_view>;
+
+    auto num_threads() const -> unsigned {
+        return m_num_threads;
+    }
+
+private:
+    unsigned m_num_threads;
+};
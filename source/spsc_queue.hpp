@@ -0,0 +1,206 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * A bounded, lock-free, single-producer single-consumer queue
+ *
+ * One thread pushes and one thread pops. try_push() and try_pop() never block. push() and pop() block while the queue
+ * is full or empty, respectively, which gives the producer backpressure when the consumer falls behind.
+ *
+ * Either side may close() the queue. Once it's closed push() fails at once, and pop() returns the items already queued
+ * and then an empty optional. The producer closes it when it's done; the consumer closes it to make the producer give up.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    /**
+     * Counters kept by the blocking calls. Each side only updates its own, so read them once both are done.
+     */
+    struct Stats {
+        uint64_t pushes {};
+        uint64_t pops {};
+
+        // Time push() spent waiting for room, and pop() spent waiting for an item.
+        std::chrono::nanoseconds push_stall {};
+        std::chrono::nanoseconds pop_stall {};
+
+        // Items queued, including the one popped, summed over each pop(). Divide by pops for the mean.
+        uint64_t occupancy_sum {};
+        std::size_t max_occupancy {};
+
+        auto mean_occupancy() const -> double {
+            return pops > 0 ? static_cast<double>(occupancy_sum) / static_cast<double>(pops) : 0.0;
+        }
+    };
+
+    /**
+     * @param[in] capacity Most items queued at once; at least 1
+     */
+    explicit SpscQueue(std::size_t capacity) : m_slots(std::max<std::size_t>(capacity, 1)) {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    auto operator=(const SpscQueue&) -> SpscQueue& = delete;
+
+    /**
+     * Queue `item` if there's room. Producer only.
+     *
+     * @return true if queued. `item` is only moved from if so.
+     */
+    auto try_push(T& item) -> bool {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache == m_slots.size()) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache == m_slots.size()) {
+                return false;
+            }
+        }
+        m_slots[tail % m_slots.size()] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        signal(m_data_signal);
+        return true;
+    }
+
+    /**
+     * Dequeue the oldest item, if any. Consumer only.
+     */
+    auto try_pop() -> std::optional<T> {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cache) {
+                return {};
+            }
+        }
+        std::optional<T> item {std::move(m_slots[head % m_slots.size()])};
+        m_head.store(head + 1, std::memory_order_release);
+        signal(m_space_signal);
+        return item;
+    }
+
+    /**
+     * Queue `item`, waiting for room if the queue is full. Producer only.
+     *
+     * @return false, without queueing `item`, if the queue is closed.
+     */
+    auto push(T item) -> bool {
+        std::optional<std::chrono::steady_clock::time_point> stall_start;
+        bool pushed {false};
+        for (;;) {
+            // Load the signal before checking for a close, so that a close() in between still wakes us.
+            const auto seen = m_space_signal.load();
+            if (m_closed.load()) {
+                break;
+            }
+            if ((pushed = try_push(item))) {
+                ++m_stats.pushes;
+                break;
+            }
+            if (!stall_start) {
+                stall_start = std::chrono::steady_clock::now();
+            }
+            m_space_signal.wait(seen);
+        }
+        if (stall_start) {
+            m_stats.push_stall += std::chrono::steady_clock::now() - *stall_start;
+        }
+        return pushed;
+    }
+
+    /**
+     * Dequeue the oldest item, waiting for one if the queue is empty. Consumer only.
+     *
+     * @return The item, or an empty optional once the queue is closed and empty.
+     */
+    auto pop() -> std::optional<T> {
+        std::optional<std::chrono::steady_clock::time_point> stall_start;
+        std::optional<T> item;
+        for (;;) {
+            const auto seen = m_data_signal.load();
+            // Check for a close before trying, so that anything pushed before the close is seen.
+            const bool closed = m_closed.load();
+            const auto occupancy = size();
+            if ((item = try_pop())) {
+                ++m_stats.pops;
+                m_stats.occupancy_sum += occupancy;
+                m_stats.max_occupancy = std::max(m_stats.max_occupancy, occupancy);
+                break;
+            }
+            if (closed) {
+                break;
+            }
+            if (!stall_start) {
+                stall_start = std::chrono::steady_clock::now();
+            }
+            m_data_signal.wait(seen);
+        }
+        if (stall_start) {
+            m_stats.pop_stall += std::chrono::steady_clock::now() - *stall_start;
+        }
+        return item;
+    }
+
+    /**
+     * Make push() fail from now on, and wake both sides
+     */
+    auto close() -> void {
+        m_closed.store(true);
+        signal(m_space_signal, true);
+        signal(m_data_signal, true);
+    }
+
+    auto closed() const -> bool {
+        return m_closed.load();
+    }
+
+    /**
+     * Items queued. Only a snapshot if the other side is running.
+     */
+    auto size() const -> std::size_t {
+        return static_cast<std::size_t>(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+    }
+
+    auto capacity() const -> std::size_t {
+        return m_slots.size();
+    }
+
+    auto stats() const -> const Stats& {
+        return m_stats;
+    }
+
+private:
+    // Bump a signal word and wake whoever is waiting on it. Waiting on the signal rather than on m_head or m_tail lets
+    // close() wake the other side without touching the indexes.
+    static auto signal(std::atomic<uint32_t>& sig, bool all = false) -> void {
+        sig.fetch_add(1);
+        if (all) {
+            sig.notify_all();
+        } else {
+            sig.notify_one();
+        }
+    }
+
+    std::vector<T> m_slots;
+
+    // Monotonic push and pop counts; the slot is the count modulo the capacity. Each is written by one side only and
+    // gets a cache line of its own, along with that side's cached copy of the other's count.
+    alignas(64) std::atomic<uint64_t> m_tail {0};
+    uint64_t m_head_cache {0};
+    alignas(64) std::atomic<uint64_t> m_head {0};
+    uint64_t m_tail_cache {0};
+
+    alignas(64) std::atomic<uint32_t> m_data_signal {0};
+    alignas(64) std::atomic<uint32_t> m_space_signal {0};
+    std::atomic<bool> m_closed {false};
+
+    Stats m_stats;
+};
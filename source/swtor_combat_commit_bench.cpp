@@ -0,0 +1,139 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "db_populator.hpp"
+#include "log_file_source.hpp"
+#include "log_parser.hpp"
+#include "logging.hpp"
+#include "timestamps.hpp"
+
+DEFINE_uint64(iterations, 3, "Populate the database from the logfile this many times with each commit policy");
+DEFINE_string(conn_str, "dbname = swtor_combat_explorer   user = jason   password = jason",
+              "Connection string of the database to populate. The logfile is replaced in it on each iteration");
+DEFINE_uint64(bulk_load_rows, 0, "Buffer this many Event rows and stream them with COPY; 0 inserts one row at a time");
+DEFINE_uint64(event_id_block, 0, "Reserve this many Event row IDs from the database at a time; 0 lets the database"
+              " assign each one");
+DEFINE_uint64(commit_every_events, 1000, "Event rows per transaction for the \"every N events\" policy");
+DEFINE_uint32(commit_every_ms, 250, "Milliseconds per transaction for the \"every T ms\" policy");
+
+namespace {
+    struct Policy {
+        std::string name;
+        DbPopulator::Options options;
+    };
+
+    struct PolicyResult {
+        std::chrono::nanoseconds best {std::chrono::nanoseconds::max()};
+        std::chrono::nanoseconds total {};
+        // From the last iteration.
+        DbPopulator::CommitStats commit_stats;
+    };
+
+    auto policies() -> std::vector<Policy> {
+        DbPopulator::Options base;
+        base.bulk_load_rows = FLAGS_bulk_load_rows;
+        base.event_id_block = FLAGS_event_id_block;
+
+        std::vector<Policy> ps {{"autocommit", base}};
+        auto events = base;
+        events.commit_every_events = FLAGS_commit_every_events;
+        ps.push_back({"every " + std::to_string(FLAGS_commit_every_events) + " events", events});
+        auto time = base;
+        time.commit_every = std::chrono::milliseconds(FLAGS_commit_every_ms);
+        ps.push_back({"every " + std::to_string(FLAGS_commit_every_ms) + " ms", time});
+        auto combat = base;
+        combat.commit_at_combat_end = true;
+        ps.push_back({"combat end", combat});
+        return ps;
+    }
+
+    // Parse the whole logfile up front so that only populating the database is timed.
+    auto parse_logfile(const std::string& lfn, const LogFileSource& src) -> std::vector<LogParserTypes::ParsedLogLine> {
+        Timestamps ts {Timestamps::log_file_creation_time(lfn)};
+        LogParser lp;
+        std::vector<LogParserTypes::ParsedLogLine> entries;
+        for (const auto& ll : src.lines()) {
+            if (ll.text.empty()) {
+                continue;
+            }
+            if (auto entry = lp.parse_line(ll.text, ll.line_num, ts)) {
+                entries.push_back(std::move(*entry));
+            }
+        }
+        return entries;
+    }
+
+    auto bench_policy(const std::string& lfn, const std::vector<LogParserTypes::ParsedLogLine>& entries,
+                      const Policy& policy) -> PolicyResult {
+        PolicyResult res;
+        for (uint64_t i = 0; i < FLAGS_iterations; i++) {
+            // Replacing the previous iteration's rows isn't timed.
+            Timestamps ts {Timestamps::log_file_creation_time(lfn)};
+            DbPopulator db {DbPopulator::ConnStr(FLAGS_conn_str),
+                            DbPopulator::LogfileFilename(lfn),
+                            ts.log_creation_timestamp(),
+                            DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+                            policy.options};
+
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& entry : entries) {
+                db.populate_from_entry(entry);
+            }
+            db.mark_fully_parsed();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            res.best = std::min(res.best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+            res.total += elapsed;
+            res.commit_stats = db.commit_stats();
+        }
+        return res;
+    }
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    gflags::SetUsageMessage("Compare DbPopulator commit policies. Usage: swtor_combat_commit_bench LOGFILE");
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    set_log_filter();
+
+    if (argc != 2 || FLAGS_iterations == 0) {
+        gflags::ShowUsageWithFlags(argv[0]);
+        return 1;
+    }
+
+    const std::string lfn {argv[1]};
+    auto src = LogFileSource::open(lfn);
+    if (!src) {
+        BLT(fatal) << "Error reading logfile " << std::quoted(lfn) << ".";
+        return 1;
+    }
+    const auto entries = parse_logfile(lfn, *src);
+    if (entries.empty()) {
+        std::cout << "No lines parsed.\n";
+        return 1;
+    }
+
+    std::cout << "Logfile: " << lfn << ", events: " << entries.size() << ", bulk load rows: " << FLAGS_bulk_load_rows
+              << ", iterations: " << FLAGS_iterations << "\n";
+    for (const auto& policy : policies()) {
+        const auto res = bench_policy(lfn, entries, policy);
+        const auto best_s = std::chrono::duration<double>(res.best).count();
+        const auto mean_s = std::chrono::duration<double>(res.total).count() / static_cast<double>(FLAGS_iterations);
+        std::cout << "Commit policy: " << policy.name << "\n"
+                  << "    best: " << std::fixed << std::setprecision(3) << best_s * 1e3 << " ms"
+                  << ", mean: " << mean_s * 1e3 << " ms"
+                  << ", events/s: " << std::setprecision(0) << static_cast<double>(entries.size()) / best_s << "\n"
+                  << "    commits: " << res.commit_stats.commits
+                  << ", ms committing: " << std::setprecision(1)
+                  << std::chrono::duration<double, std::milli>(res.commit_stats.duration).count()
+                  << std::defaultfloat << "\n";
+    }
+    return 0;
+}
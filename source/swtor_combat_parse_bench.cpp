@@ -0,0 +1,239 @@
+// -*- fil-column: 120; indent-tabs-mode: nil -*-
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "binary_log.hpp"
+#include "log_file_source.hpp"
+#include "log_parser.hpp"
+#include "parallel_log_parser.hpp"
+#include "logging.hpp"
+#include "timestamps.hpp"
+
+DEFINE_uint64(iterations, 5, "Parse each logfile this many times");
+DEFINE_bool(view, true, "Parse with LogParser::parse_line_view; otherwise parse_line, which copies the strings");
+DEFINE_uint32(threads, 0, "Parse each logfile with a ParallelLogParser on this many threads; 0 parses serially");
+DEFINE_bool(binary, false, "Convert each logfile to the binary log format, untimed, and time loading that with"
+            " BinaryLogReader instead of parsing. --view=false also copies each entry into a ParsedLogLine");
+DEFINE_string(actions, "", "Comma-separated action verb and noun IDs. Parse serially with LogParser::parse_line_filtered,"
+              " keeping only lines with one of them, e.g. 836045448945501 for damage");
+DEFINE_string(fields, "all", "Parse serially with LogParser::parse_line_projected, decoding only these fields: all,"
+              " timeline, damage, or movement; see ParseFields");
+
+namespace {
+    struct BenchResult {
+        std::size_t lines {};
+        std::size_t bytes {};
+        std::size_t failures {};
+        // Summed over the logfiles, from the first iteration of each, with --actions.
+        LogParser::FilterStats filter_stats;
+        // Sum over the logfiles of each one's fastest iteration.
+        std::chrono::nanoseconds best {};
+        std::chrono::nanoseconds total {};
+    };
+
+    using ParseFn = std::optional<LogParserTypes::ParsedLogLineView> (LogParser::*)(std::string_view, int, Timestamps&);
+
+    // The parse_line_projected() instantiation --fields names, null for all fields, or empty if it names none.
+    auto projection() -> std::optional<ParseFn> {
+        if (FLAGS_fields == "timeline") {
+            return &LogParser::parse_line_projected<ParseFields::TIMELINE>;
+        }
+        if (FLAGS_fields == "damage") {
+            return &LogParser::parse_line_projected<ParseFields::DAMAGE>;
+        }
+        if (FLAGS_fields == "movement") {
+            return &LogParser::parse_line_projected<ParseFields::MOVEMENT>;
+        }
+        if (FLAGS_fields != "all") {
+            BLT(fatal) << "Unknown --fields " << std::quoted(FLAGS_fields) << ".";
+            return std::nullopt;
+        }
+        return nullptr;
+    }
+
+    // The IDs --actions names, or empty if one of them is malformed.
+    auto action_filter() -> std::optional<ActionFilter> {
+        ActionFilter filter;
+        std::string_view ids {FLAGS_actions};
+        while (!ids.empty()) {
+            const auto comma = std::min(ids.find(','), ids.size());
+            const auto id = LogParserHelpers().str_to_uint64(ids.substr(0, comma));
+            if (!id) {
+                BLT(fatal) << "Malformed action ID " << std::quoted(ids.substr(0, comma)) << " in --actions.";
+                return std::nullopt;
+            }
+            filter.ids.push_back(*id);
+            ids.remove_prefix(std::min(comma + 1, ids.size()));
+        }
+        return filter;
+    }
+
+    // Split the whole logfile up front so that only parsing is timed.
+    auto read_lines(const LogFileSource& src) -> std::vector<std::string_view> {
+        std::vector<std::string_view> lines;
+        for (const auto& ll : src.lines()) {
+            if (!ll.text.empty()) {
+                lines.push_back(ll.text);
+            }
+        }
+        return lines;
+    }
+
+    auto convert(const std::string& lfn, const std::vector<std::string_view>& lines) -> std::string {
+        Timestamps ts {Timestamps::log_file_creation_time(lfn)};
+        LogParser lp;
+        BinaryLogWriter writer;
+        int line_num = 0;
+        for (const auto& line : lines) {
+            line_num += 1;
+            if (auto entry = lp.parse_line_view(line, line_num, ts)) {
+                writer.add(*entry);
+            }
+        }
+        return writer.finish();
+    }
+
+    // Returns the number of entries that couldn't be loaded.
+    auto load_binary(std::string_view bin) -> std::size_t {
+        auto reader = BinaryLogReader::from_bytes(bin);
+        if (!reader) {
+            return 1;
+        }
+        std::size_t loaded {};
+        while (auto entry = reader->next()) {
+            if (!FLAGS_view) {
+                [[maybe_unused]] const auto owned = LogParserTypes::materialize(*entry);
+            }
+            loaded += 1;
+        }
+        return reader->size() - loaded;
+    }
+
+    auto bench_logfile(const std::string& lfn, const LogFileSource& src, const ActionFilter& filter, ParseFn projected,
+                       BenchResult& res) -> void {
+        const auto lines = read_lines(src);
+        const auto bin = FLAGS_binary ? convert(lfn, lines) : std::string();
+        auto best = std::chrono::nanoseconds::max();
+        for (uint64_t i = 0; i < FLAGS_iterations; i++) {
+            Timestamps ts {Timestamps::log_file_creation_time(lfn)};
+            LogParser lp;
+            std::size_t failures {};
+
+            const auto start = std::chrono::steady_clock::now();
+            if (FLAGS_binary) {
+                failures = load_binary(bin);
+            } else if (FLAGS_threads > 0) {
+                failures = ParallelLogParser(FLAGS_threads).parse(src.contents(), ts).failed_lines;
+            } else {
+                int line_num = 0;
+                for (const auto& line : lines) {
+                    line_num += 1;
+                    if (!filter.ids.empty()) {
+                        lp.parse_line_filtered(line, line_num, ts, filter);
+                        continue;
+                    }
+                    bool ok = projected ? (lp.*projected)(line, line_num, ts).has_value()
+                            : FLAGS_view ? lp.parse_line_view(line, line_num, ts).has_value()
+                                         : lp.parse_line(line, line_num, ts).has_value();
+                    failures += ok ? 0 : 1;
+                }
+            }
+            if (!filter.ids.empty()) {
+                const auto& stats = lp.filter_stats();
+                failures = stats.bad_timestamp + stats.no_action + stats.parse_failed;
+                if (i == 0) {
+                    res.filter_stats.lines += stats.lines;
+                    res.filter_stats.bad_timestamp += stats.bad_timestamp;
+                    res.filter_stats.no_action += stats.no_action;
+                    res.filter_stats.rejected += stats.rejected;
+                    res.filter_stats.parse_failed += stats.parse_failed;
+                    res.filter_stats.parsed += stats.parsed;
+                }
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+            res.total += elapsed;
+            if (i == 0) {
+                res.failures += failures;
+            }
+        }
+        res.best += best;
+        res.lines += lines.size();
+        for (const auto& line : lines) {
+            res.bytes += line.size();
+        }
+    }
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    gflags::SetUsageMessage("Measure SW:ToR combat log parse throughput. Usage: swtor_combat_parse_bench LOGFILE...");
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    set_log_filter();
+
+    if (argc < 2 || FLAGS_iterations == 0) {
+        gflags::ShowUsageWithFlags(argv[0]);
+        return 1;
+    }
+
+    const auto filter = action_filter();
+    const auto projected = projection();
+    if (!filter || !projected) {
+        return 1;
+    }
+
+    BenchResult res;
+    for (int i = 1; i < argc; i++) {
+        const std::string lfn {argv[i]};
+        auto src = LogFileSource::open(lfn);
+        if (!src) {
+            BLT(fatal) << "Error reading logfile " << std::quoted(lfn) << ". Skipping this logfile.";
+            continue;
+        }
+        bench_logfile(lfn, *src, *filter, *projected, res);
+    }
+
+    if (res.lines == 0) {
+        std::cout << "No lines parsed.\n";
+        return 1;
+    }
+
+    const auto best_s = std::chrono::duration<double>(res.best).count();
+    const auto mean_s = std::chrono::duration<double>(res.total).count() / static_cast<double>(FLAGS_iterations);
+    const std::string parser = FLAGS_binary ? (FLAGS_view ? "BinaryLogReader" : "BinaryLogReader + materialize")
+                         : FLAGS_threads > 0 ? "ParallelLogParser"
+                         : !FLAGS_actions.empty() ? "parse_line_filtered"
+                         : FLAGS_fields != "all" ? "parse_line_projected<" + FLAGS_fields + ">"
+                         : FLAGS_view ? "parse_line_view" : "parse_line";
+    std::cout << "Parser: " << parser
+              << ", least severe log level compiled in: " << MIN_LOG_LEVEL << "\n"
+              << "    lines: " << res.lines
+              << ", bytes: " << res.bytes
+              << ", failed lines: " << res.failures
+              << ", iterations: " << FLAGS_iterations << "\n"
+              << "    best: " << std::fixed << std::setprecision(3) << best_s * 1e3 << " ms"
+              << ", mean: " << mean_s * 1e3 << " ms\n"
+              << "    lines/s: " << std::setprecision(0) << static_cast<double>(res.lines) / best_s
+              << ", MB/s: " << std::setprecision(1) << static_cast<double>(res.bytes) / best_s / 1e6
+              << ", ns/line: " << res.best.count() / static_cast<long long>(res.lines)
+              << "\n";
+    if (!FLAGS_actions.empty()) {
+        const auto& fs = res.filter_stats;
+        std::cout << "    filtered lines: " << fs.lines
+                  << ", bad timestamp: " << fs.bad_timestamp
+                  << ", no action: " << fs.no_action
+                  << ", rejected: " << fs.rejected
+                  << ", parse failed: " << fs.parse_failed
+                  << ", parsed: " << fs.parsed << "\n";
+    }
+    return 0;
+}
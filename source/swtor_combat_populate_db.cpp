@@ -1,106 +1,515 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <fstream>
+#include <csignal>
+#include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
-#include "generator.hpp"
+#include <gflags/gflags.h>
+
+#include "ingest_pipeline.hpp"
+#include "log_file_source.hpp"
+#include "log_follower.hpp"
 #include "log_parser.hpp"
+#include "parallel_log_parser.hpp"
 #include "logging.hpp"
 #include "db_populator.hpp"
+#include "local_db_cache.hpp"
 #include "timestamps.hpp"
 
+DEFINE_uint64(bulk_load_rows, 0, "Buffer this many Event rows and stream them with COPY; 0 inserts one row at a time");
+DEFINE_uint64(event_id_block, 0, "Reserve this many Event row IDs from the database at a time and assign them locally;"
+              " 0 lets the database assign each one");
+DEFINE_bool(warm_start, false, "Preload the name, action, class, and actor caches from the database for each logfile");
+DEFINE_uint64(cache_capacity, 0, "Maximum entries in each dimension cache before least-recently used ones are evicted;"
+              " 0 is unbounded");
+DEFINE_uint32(parse_threads, 0, "Parse each whole logfile on this many threads before populating the database; 0"
+              " parses line by line as the database is populated");
+DEFINE_uint32(jobs, 1, "Populate this many logfiles at once, each with its own database connection. The largest"
+              " logfiles are started first. Starting a logfile waits for the other jobs' open transactions; see"
+              " --commit_every_events");
+DEFINE_uint64(ingest_queue_batches, 0, "Parse on a thread of its own, handing batches of parsed lines to the database"
+              " writer through a queue of at most this many batches; 0 parses and writes on one thread");
+DEFINE_uint64(ingest_batch_lines, 256, "Parsed log lines per batch handed to the database writer; see"
+              " --ingest_queue_batches");
+DEFINE_bool(resume, false, "Resume logfiles already in the database from where the last run left off, rather than"
+            " starting them over. A final line without its LF is left for the next run");
+DEFINE_bool(follow, false, "Keep ingesting the one logfile given as the game appends lines to it, until interrupted."
+            " Resumes the logfile like --resume and checkpoints after each read");
+DEFINE_uint32(follow_latency_ms, 200, "With --follow, write rows to the database at most this long after their lines are"
+              " read");
+DEFINE_int32(last_line_num, 20000, "Stop after this line of each logfile; 0 ingests every line");
+DEFINE_uint64(commit_every_events, 0, "Write each logfile's rows in transactions committed after this many events; 0"
+              " doesn't commit by count. With none of the --commit_* flags, every statement commits on its own");
+DEFINE_uint32(commit_every_ms, 0, "Commit each logfile's transaction once it's been open this long; 0 doesn't commit by"
+              " time");
+DEFINE_bool(commit_at_combat_end, false, "Commit each logfile's transaction when a combat ends");
+DEFINE_uint64(pipeline_window, 0, "Resolve the names, actions, and actors of this many log lines in one pipelined round"
+              " trip before adding their events; 0 resolves them one line at a time");
+
 auto dump_scope_measurements(const ScopeRuns& sr) -> void {
+    const uint32_t num_calls = sr.m_num_calls;
+    const int64_t total_ns = sr.m_total_time_in_func;
     std::cout << "Scope: " << sr.m_func_name << "\n"
-              << "    # calls: " << sr.m_num_calls
-              << ", total ns of all calls: " << sr.m_total_time_in_func
-              << ", ns/call: " << sr.m_total_time_in_func / sr.m_num_calls
+              << "    # calls: " << num_calls
+              << ", total ns of all calls: " << total_ns
+              << ", ns/call: " << (num_calls > 0 ? total_ns / num_calls : 0)
               << "\n";
 }
 
-auto file_reader(std::ifstream& ifs) -> Generator<std::string> {
-    using std::getline;
-    std::string line;
-    getline(ifs, line);
-    while(ifs.good()) {
-        co_yield line;
-        getline(ifs, line);
+// Guards std::cout, which the --jobs workers share.
+std::mutex cout_mutex;
+
+auto dump_cache_stats(const LocalDbCacheStats& cs) -> void {
+    std::cout << "Cache: " << cs.name << "\n"
+              << "    size: " << cs.size
+              << ", hits: " << cs.hits
+              << ", misses: " << cs.misses
+              << ", inserts: " << cs.inserts
+              << ", evictions: " << cs.evictions
+              << ", preloaded hits: " << cs.preloaded_hits
+              << "\n";
+}
+
+auto dump_ingest_stats(const IngestPipeline::Stats& is) -> void {
+    const auto ms = [] (std::chrono::nanoseconds ns) { return std::chrono::duration<double, std::milli>(ns).count(); };
+    std::cout << "Ingest pipeline: " << is.batches << " batches, " << is.parsed_lines << " lines parsed, "
+              << is.failed_lines << " failed\n"
+              << std::fixed << std::setprecision(1)
+              << "    parser ms busy: " << ms(is.parse_busy) << ", stalled on a full queue: " << ms(is.parse_stall) << "\n"
+              << "    writer ms busy: " << ms(is.write_busy) << ", stalled on an empty queue: " << ms(is.write_stall)
+              << "\n"
+              << "    queue occupancy mean: " << std::setprecision(2) << is.mean_queue_occupancy
+              << ", max: " << is.max_queue_occupancy << " of " << is.queue_capacity
+              << std::defaultfloat << "\n";
+}
+
+struct FileReport {
+    std::string filename;
+    bool ok {false};
+    // Bytes and lines ingested by this run.
+    std::size_t bytes {};
+    std::size_t lines {};
+    // Bytes skipped because an earlier run already ingested them.
+    std::size_t resumed_bytes {};
+    std::size_t events {};
+    std::chrono::steady_clock::duration duration {};
+};
+
+auto dump_file_report(const FileReport& fr) -> void {
+    const auto secs = std::chrono::duration<double>(fr.duration).count();
+    std::cout << "Logfile: " << fr.filename << (fr.ok ? "" : " (FAILED)") << "\n"
+              << "    lines: " << fr.lines
+              << ", events: " << fr.events
+              << ", bytes: " << fr.bytes
+              << (fr.resumed_bytes > 0 ? " (after " + std::to_string(fr.resumed_bytes) + " already ingested)" : "")
+              << ", seconds: " << std::fixed << std::setprecision(3) << secs
+              << ", events/s: " << std::setprecision(0) << (secs > 0 ? static_cast<double>(fr.events) / secs : 0.0)
+              << ", MB/s: " << std::setprecision(2) << (secs > 0 ? static_cast<double>(fr.bytes) / secs / 1e6 : 0.0)
+              << std::defaultfloat << "\n";
+}
+
+// The lines of a logfile to ingest.
+struct IngestRange {
+    std::string_view text;
+    int first_line_num {};
+    // 0 if there are no lines before the range and none in it.
+    int last_line_num {};
+};
+
+// The part of `contents` that starts at `begin`, which is line `first_line_num`, and ends with line --last_line_num or
+// the end of the file. With `whole_lines_only`, a final line without its LF is left out; the game may still be writing
+// it.
+auto ingest_range(std::string_view contents, uint64_t begin, int first_line_num, bool whole_lines_only) -> IngestRange {
+    const auto text = contents.substr(begin);
+    const int last_line_num = FLAGS_last_line_num > 0 ? FLAGS_last_line_num : std::numeric_limits<int>::max();
+    IngestRange range {.text = {}, .first_line_num = first_line_num, .last_line_num = first_line_num - 1};
+    std::size_t end {};
+    while (end < text.size() && range.last_line_num < last_line_num) {
+        const auto line_end = LogFileSource::find_line_end(text, end);
+        if (line_end == text.size() && whole_lines_only) {
+            break;
+        }
+        end = std::min(line_end + 1, text.size());
+        ++range.last_line_num;
     }
+    range.text = text.substr(0, end);
+    return range;
 }
 
-auto main(int argc, char* argv[]) -> int {
-    set_log_filter();
+// Parse one logfile and populate the database with it, using a connection of its own.
+auto ingest_logfile(const std::string& lfn, const std::string& conn_str, const DbPopulator::Options& db_options,
+                    ScopeRuns& parse_time, ScopeRuns& populate_time) -> FileReport {
+    const auto start = std::chrono::steady_clock::now();
+    FileReport report {.filename = lfn};
 
-    const std::string conn_str {"dbname = swtor_combat_explorer   user = jason   password = jason"};
+    BLT(info) << "Parsing logfile " << std::quoted(lfn);
+    auto log_creation_time = Timestamps::log_file_creation_time(lfn);
+    Timestamps ts {log_creation_time};
 
-    auto parse_time = ScopeRuns("parse_line");
-    auto populate_time = ScopeRuns("populate_from_entry");
+    auto log_in = LogFileSource::open(lfn);
+    if (!log_in) {
+        BLT(fatal) << "Error reading logfile " << std::quoted(lfn) << ". Skipping this logfile.";
+        return report;
+    }
 
-    for (int i = 1; i < argc; i++) {
-        const std::string lfn {argv[i]};
-        BLT(info) << "Parsing logfile " << std::quoted(lfn);
-        auto log_creation_time = Timestamps::log_file_creation_time(lfn);
-        Timestamps ts {log_creation_time};
-
-        std::ifstream log_in {lfn};
-        
-        if (log_in.fail()) {
-            BLT(fatal) << "Error reading logfile " << std::quoted(lfn) << ". Skipping this logfile.";
-            continue;
+    std::optional<DbPopulator> db;
+    db.emplace(DbPopulator::ConnStr(conn_str),
+               DbPopulator::LogfileFilename(lfn),
+               ts.log_creation_timestamp(),
+               FLAGS_resume ? DbPopulator::ExistingLogfileBehavior::RESUME_EXISTING
+                            : DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+               db_options);
+
+    BLT(info) << "Database version: " << std::quoted(db->db_version());
+
+    const auto contents = log_in->contents();
+    uint64_t begin {};
+    int first_line_num {1};
+    if (auto rp = db->resume_point()) {
+        if (rp->offset > contents.size() || (rp->offset > 0 && contents[rp->offset - 1] != '\n')) {
+            // Not the logfile we checkpointed, or it's been truncated.
+            BLT(error) << "Logfile " << std::quoted(lfn) << " doesn't match its checkpoint at offset " << rp->offset
+                       << ". Starting it over.";
+            db.reset();
+            db.emplace(DbPopulator::ConnStr(conn_str),
+                       DbPopulator::LogfileFilename(lfn),
+                       ts.log_creation_timestamp(),
+                       DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+                       db_options);
+        } else {
+            begin = rp->offset;
+            first_line_num = rp->line_num + 1;
+            if (rp->last_ts) {
+                ts.resume(*rp->last_ts);
+            }
+            report.resumed_bytes = begin;
         }
-        
-        DbPopulator db {
-            DbPopulator::ConnStr(conn_str),
-            DbPopulator::LogfileFilename(lfn),
-            ts.log_creation_timestamp(),
-            DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING
-        };
+    }
+    const auto range = ingest_range(contents, begin, first_line_num, FLAGS_resume);
+    report.bytes = range.text.size();
+    report.lines = static_cast<std::size_t>(std::max(range.last_line_num - range.first_line_num + 1, 0));
 
-        BLT(info) << "Database version: " << std::quoted(db.db_version());
+    std::vector<LogParserTypes::ParsedLogLine> window;
+    window.reserve(FLAGS_pipeline_window);
+    auto populate = [&] (LogParserTypes::ParsedLogLine&& log_entry) {
+        ++report.events;
+        if (FLAGS_pipeline_window == 0) {
+            MeasureScope meas(populate_time);
+            db->populate_from_entry(log_entry);
+            return;
+        }
 
-        int line_num = 0;
-        LogParser lp;
-        for(const auto& line : file_reader(log_in)) {
-            if (line_num >= 20000) {
-                break;
+        window.push_back(std::move(log_entry));
+        if (window.size() >= FLAGS_pipeline_window) {
+            MeasureScope meas(populate_time);
+            db->populate_from_entries(window);
+            window.clear();
+        }
+    };
+
+    std::optional<IngestPipeline::Stats> ingest_stats;
+    if (FLAGS_ingest_queue_batches > 0) {
+        IngestPipeline pipeline {IngestPipeline::Options {
+            .batch_lines = FLAGS_ingest_batch_lines,
+            .queue_batches = FLAGS_ingest_queue_batches,
+            .first_line_num = range.first_line_num,
+        }};
+        ingest_stats = pipeline.run(range.text, ts, [&] (IngestPipeline::Batch& batch) {
+            for (auto& log_entry : batch) {
+                populate(std::move(log_entry));
             }
-            line_num += 1;
-        
-            std::string_view linev(line);
-            linev.remove_suffix(1); // Chomp final character, which is always a CR.
-        
+        });
+        if (ingest_stats->failed_lines > 0) {
+            BLT(fatal) << ingest_stats->failed_lines << " log lines failed to parse. Skipped them.";
+        }
+    } else if (FLAGS_parse_threads > 0) {
+        std::optional<ParallelLogParser::Result> parsed;
+        {
+            MeasureScope meas(parse_time);
+            parsed = ParallelLogParser(FLAGS_parse_threads).parse(range.text, ts);
+        }
+        if (parsed->failed_lines > 0) {
+            BLT(fatal) << parsed->failed_lines << " log lines failed to parse. Skipped them.";
+        }
+        for (auto& [line, log_entry] : parsed->entries) {
+            populate(LogParserTypes::materialize(log_entry));
+        }
+    } else {
+        LogParser lp;
+        for (const auto& [linev, line_num, offset] : LogFileSource::lines(range.text, range.first_line_num, begin)) {
             if (linev.empty()) {
               continue;
             }
-        
-            parse_time.enter();
-            auto log_entry = lp.parse_line(linev, line_num, ts);
-            parse_time.exit();
+
+            std::optional<LogParserTypes::ParsedLogLine> log_entry;
+            {
+                MeasureScope meas(parse_time);
+                log_entry = lp.parse_line(linev, line_num, ts);
+            }
             if (!log_entry) {
                 BLT(fatal) << "Error parsing log line: " << std::quoted(linev) << ". Skipping.";
                 continue;
             }
-        
-            populate_time.enter();
-            db.populate_from_entry(*log_entry);
-            populate_time.exit();
+            populate(std::move(*log_entry));
+        }
+    }
+
+    if (!window.empty()) {
+        MeasureScope meas(populate_time);
+        db->populate_from_entries(window);
+        window.clear();
+    }
+
+    if (FLAGS_resume) {
+        db->checkpoint(DbPopulator::ResumePoint {
+            .offset = begin + range.text.size(),
+            .line_num = range.last_line_num,
+            .last_ts = ts.current_log_timestamp(),
+        });
+    }
+    db->mark_fully_parsed();
+    report.ok = true;
+    report.duration = std::chrono::steady_clock::now() - start;
+
+    std::lock_guard lock {cout_mutex};
+    dump_file_report(report);
+    if (ingest_stats) {
+        dump_ingest_stats(*ingest_stats);
+    }
+    if (FLAGS_warm_start) {
+        const auto& ws = db->warm_start_stats();
+        std::cout << "Warm start: " << ws.rows_loaded << " rows loaded in " << ws.duration.count() << " ns, "
+                  << ws.lookups_saved << " lookups saved\n";
+    }
+    if (db_options.batched_commits()) {
+        const auto& cs = db->commit_stats();
+        std::cout << "Commits: " << cs.commits << ", events committed: " << cs.events << ", ms committing: "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(cs.duration).count() << "\n";
+    }
+    for (const auto& cs : db->cache_stats()) {
+        dump_cache_stats(cs);
+    }
+    return report;
+}
+
+// Set by SIGINT to stop --follow.
+volatile std::sig_atomic_t stop_following {0};
+
+// Populate the database with the lines of a logfile as the game appends them, until interrupted. Carries on from the
+// logfile's checkpoint, if it has one, and checkpoints after each read so that the next run can do the same.
+auto follow_logfile(const std::string& lfn, const std::string& conn_str, const DbPopulator::Options& db_options,
+                    ScopeRuns& parse_time, ScopeRuns& populate_time) -> FileReport {
+    const auto start = std::chrono::steady_clock::now();
+    FileReport report {.filename = lfn};
+    Timestamps ts {Timestamps::log_file_creation_time(lfn)};
+
+    std::optional<DbPopulator> db;
+    db.emplace(DbPopulator::ConnStr(conn_str),
+               DbPopulator::LogfileFilename(lfn),
+               ts.log_creation_timestamp(),
+               DbPopulator::ExistingLogfileBehavior::RESUME_EXISTING,
+               db_options);
+
+    std::optional<LogFollower> follower;
+    if (auto rp = db->resume_point()) {
+        follower = LogFollower::open(lfn, rp->offset, rp->line_num);
+        if (follower) {
+            if (rp->last_ts) {
+                ts.resume(*rp->last_ts);
+            }
+            report.resumed_bytes = rp->offset;
+        } else {
+            BLT(error) << "Logfile " << std::quoted(lfn) << " doesn't match its checkpoint. Starting it over.";
+            db.reset();
+            db.emplace(DbPopulator::ConnStr(conn_str),
+                       DbPopulator::LogfileFilename(lfn),
+                       ts.log_creation_timestamp(),
+                       DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+                       db_options);
+        }
+    }
+    if (!follower) {
+        follower = LogFollower::open(lfn);
+    }
+    if (!follower) {
+        BLT(fatal) << "Error reading logfile " << std::quoted(lfn) << ".";
+        return report;
+    }
+
+    const auto start_offset = follower->offset();
+    const auto start_line_num = follower->line_num();
+
+    std::signal(SIGINT, [] (int) { stop_following = 1; });
+    BLT(info) << "Following " << std::quoted(lfn) << " from line " << follower->line_num() + 1
+              << ". Interrupt to stop.";
+
+    // Rows only become visible once flushed and committed, so commit whenever the oldest uncommitted line gets this old,
+    // as well as after each read.
+    const std::chrono::milliseconds latency {FLAGS_follow_latency_ms};
+    LogParser lp;
+    while (!stop_following && !follower->finished()) {
+        const auto chunk = follower->next(latency);
+        if (chunk.text.empty()) {
+            continue;
+        }
+
+        auto commit_by = std::chrono::steady_clock::now() + latency;
+        for (const auto& [linev, line_num, offset] : LogFileSource::lines(chunk.text, chunk.first_line_num,
+                                                                          chunk.offset)) {
+            if (linev.empty()) {
+                continue;
+            }
+            std::optional<LogParserTypes::ParsedLogLine> log_entry;
+            {
+                MeasureScope meas(parse_time);
+                log_entry = lp.parse_line(linev, line_num, ts);
+            }
+            if (!log_entry) {
+                continue;
+            }
+            {
+                MeasureScope meas(populate_time);
+                db->populate_from_entry(*log_entry);
+            }
+            ++report.events;
+
+            if (const auto now = std::chrono::steady_clock::now(); now >= commit_by) {
+                db->commit();
+                commit_by = now + latency;
+            }
         }
 
-        db.mark_fully_parsed();
+        db->checkpoint(DbPopulator::ResumePoint {
+            .offset = follower->offset(),
+            .line_num = follower->line_num(),
+            .last_ts = ts.current_log_timestamp(),
+        });
+    }
+
+    report.ok = true;
+    report.lines = static_cast<std::size_t>(follower->line_num() - start_line_num);
+    report.bytes = static_cast<std::size_t>(follower->offset() - start_offset);
+    report.duration = std::chrono::steady_clock::now() - start;
+    BLT(info) << "Stopped following " << std::quoted(lfn) << " after line " << follower->line_num();
+
+    std::lock_guard lock {cout_mutex};
+    dump_file_report(report);
+    return report;
+}
 
-        dump_scope_measurements(measure_add_name_id);
-        dump_scope_measurements(measure_add_pc_class);
-        dump_scope_measurements(measure_add_action);
-        dump_scope_measurements(measure_add_pc_actor);
-        dump_scope_measurements(measure_add_npc_actor);
-        dump_scope_measurements(measure_add_companion_actor);
+auto main(int argc, char* argv[]) -> int {
+    gflags::SetUsageMessage("Populate the SW:ToR combat database from combat logs");
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    set_log_filter();
+
+    DbPopulator::Options db_options;
+    db_options.bulk_load_rows = FLAGS_bulk_load_rows;
+    db_options.event_id_block = FLAGS_event_id_block;
+    db_options.warm_start = FLAGS_warm_start;
+    db_options.cache_capacity = FLAGS_cache_capacity;
+    db_options.commit_every_events = FLAGS_commit_every_events;
+    db_options.commit_every = std::chrono::milliseconds(FLAGS_commit_every_ms);
+    db_options.commit_at_combat_end = FLAGS_commit_at_combat_end;
+
+    const std::string conn_str {"dbname = swtor_combat_explorer   user = jason   password = jason"};
+
+    auto parse_time = ScopeRuns("parse_line");
+    auto populate_time = ScopeRuns("populate_from_entry");
+
+    if (FLAGS_follow) {
+        if (argc != 2) {
+            BLT(fatal) << "--follow takes exactly one logfile.";
+            gflags::ShowUsageWithFlags(argv[0]);
+            return 1;
+        }
+        FileReport report;
+        try {
+            report = follow_logfile(argv[1], conn_str, db_options, parse_time, populate_time);
+        } catch (const std::exception& e) {
+            BLT(fatal) << "Error populating the database from logfile " << std::quoted(argv[1]) << ": " << e.what();
+        }
         dump_scope_measurements(parse_time);
         dump_scope_measurements(populate_time);
+        return report.ok ? 0 : 1;
+    }
+
+    // Largest first, so that a big logfile started last doesn't leave the other workers idle at the end.
+    std::vector<std::pair<std::uintmax_t, std::string>> logfiles;
+    for (int i = 1; i < argc; i++) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(argv[i], ec);
+        logfiles.emplace_back(ec ? 0 : size, argv[i]);
+    }
+    std::stable_sort(logfiles.begin(), logfiles.end(), [] (const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    std::vector<FileReport> reports(logfiles.size());
+    std::atomic<std::size_t> next_logfile {0};
+    auto worker = [&] {
+        for (auto i = next_logfile++; i < logfiles.size(); i = next_logfile++) {
+            const auto& lfn = logfiles[i].second;
+            try {
+                reports[i] = ingest_logfile(lfn, conn_str, db_options, parse_time, populate_time);
+            } catch (const std::exception& e) {
+                BLT(fatal) << "Error populating the database from logfile " << std::quoted(lfn) << ": " << e.what();
+                reports[i].filename = lfn;
+            }
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto num_jobs = std::clamp<std::size_t>(FLAGS_jobs, 1, std::max<std::size_t>(logfiles.size(), 1));
+    if (num_jobs == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < num_jobs; i++) {
+            workers.emplace_back(worker);
+        }
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    dump_scope_measurements(measure_add_name_id);
+    dump_scope_measurements(measure_add_pc_class);
+    dump_scope_measurements(measure_add_action);
+    dump_scope_measurements(measure_add_pc_actor);
+    dump_scope_measurements(measure_add_npc_actor);
+    dump_scope_measurements(measure_add_companion_actor);
+    if (FLAGS_pipeline_window > 0) {
+        dump_scope_measurements(measure_prefetch_dimensions);
+    }
+    dump_scope_measurements(parse_time);
+    dump_scope_measurements(populate_time);
+
+    FileReport total {.filename = "all logfiles", .ok = true, .duration = elapsed};
+    std::size_t failed {};
+    for (const auto& fr : reports) {
+        total.bytes += fr.bytes;
+        total.resumed_bytes += fr.resumed_bytes;
+        total.lines += fr.lines;
+        total.events += fr.events;
+        failed += fr.ok ? 0 : 1;
     }
+    std::cout << "Ingested " << reports.size() - failed << " of " << reports.size() << " logfiles with " << num_jobs
+              << " jobs\n";
+    dump_file_report(total);
 
     BLT(info) << "All logfiles processed. Exiting.";
 
-    return 0;
+    return failed == 0 ? 0 : 1;
 }
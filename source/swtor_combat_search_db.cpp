@@ -1,5 +1,9 @@
 #include <getopt.h>
+#include <charconv>
+#include <concepts>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 #include <gflags/gflags.h>
 #include "db_populator.hpp"
@@ -19,11 +23,73 @@ DEFINE_bool(all_classes,                false, "Show all classes");
 DEFINE_bool(all_class_unique_abilities, false, "Show unique abilities for each class");
 DEFINE_bool(all_combats,                false, "Show all combats");
 DEFINE_bool(all_action_events,          false, "Show all nouns/details with the 'Event' verb");
+DEFINE_bool(combat_summary,             false, "Show the damage, healing, and threat of each source and ability in each"
+            " combat");
 // TODO
 DEFINE_string(class_unique_abilities,   "",    "Show unique abilities for a specific class in the form \"style,discipline\"");
 DEFINE_bool(duplicate_name_counts,      false, "Show how many names have the same string but different id");
 DEFINE_bool(pcs_in_combats,             false, "Show all PCs in all combats");
 
+namespace {
+    /**
+     * Writes CSV rows to stdout in large blocks
+     *
+     * Used by the reports that can return millions of rows, which stream them from the server with
+     * pqxx::transaction_base::stream() rather than holding the whole result. Rows are formatted into a buffer that's
+     * written out whenever it fills and on destruction.
+     */
+    class CsvWriter {
+      public:
+        explicit CsvWriter(std::size_t capacity = 1 << 16)
+            : m_capacity(capacity) {
+            m_buf.reserve(m_capacity + 256);
+        }
+
+        CsvWriter(const CsvWriter&) = delete;
+        auto operator=(const CsvWriter&) -> CsvWriter& = delete;
+
+        ~CsvWriter() {
+            flush();
+        }
+
+        template <typename... T>
+        auto row(const T&... fields) -> void {
+            std::size_t i {};
+            ((append(fields), m_buf.push_back(++i < sizeof...(fields) ? ',' : '\n')), ...);
+            ++m_rows;
+            if (m_buf.size() >= m_capacity) {
+                flush();
+            }
+        }
+
+        auto flush() -> void {
+            std::cout.write(m_buf.data(), static_cast<std::streamsize>(m_buf.size()));
+            std::cout.flush();
+            m_buf.clear();
+        }
+
+        auto rows() const -> std::size_t {
+            return m_rows;
+        }
+
+      private:
+        auto append(std::string_view field) -> void {
+            m_buf.append(field);
+        }
+
+        template <std::integral T>
+        auto append(T field) -> void {
+            char digits[24];
+            const auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), field);
+            m_buf.append(digits, end);
+        }
+
+        std::size_t m_capacity;
+        std::string m_buf;
+        std::size_t m_rows {};
+    };
+} // namespace
+
 auto main(int argc, char* argv[]) -> int {
     gflags::SetUsageMessage("Extract information from the SW:ToR combat database");
     gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -64,16 +130,17 @@ auto main(int argc, char* argv[]) -> int {
 
     if (FLAGS_all_abilities) {
         std::cout << "You requested all abilities.\n";
-        auto res = tx.exec(" SELECT DISTINCT ab.name_id, ab.name FROM Event"
-                           "     JOIN Name as ab ON Event.ability = ab.id"
-                           " WHERE Event.ability IS NOT NULL"
-                           " ORDER BY ab.name");
         std::cout << "ability_id,ability_name\n";
-        for (auto row : res) {
-            auto [ab_id, ab_name] = row.as<uint64_t, std::string_view>();
-            std::cout << ab_id << "," << ab_name << "\n";
+        CsvWriter out;
+        for (auto [ab_id, ab_name] : tx.stream<uint64_t, std::string_view>(
+                 " SELECT DISTINCT ab.name_id, ab.name FROM Event"
+                 "     JOIN Name as ab ON Event.ability = ab.id"
+                 " WHERE Event.ability IS NOT NULL"
+                 " ORDER BY ab.name")) {
+            out.row(ab_id, ab_name);
         }
-        std::cout << res.size() << " rows\n";
+        out.flush();
+        std::cout << out.rows() << " rows\n";
     }
 
     if (FLAGS_all_action_verbs) {
@@ -104,25 +171,26 @@ auto main(int argc, char* argv[]) -> int {
     }
     if (FLAGS_all_class_abilities) {
         std::cout << "You requested all abilitities for all classes.\n";
-        auto res = tx.exec(" SELECT DISTINCT _style.name, _discipline.name, _ability.name FROM Event"
+        std::cout << "style,discipline,ability\n";
+        // A streamed query can't take parameters, so they're quoted into it.
+        const auto query = " SELECT DISTINCT _style.name, _discipline.name, _ability.name FROM Event"
                            "     JOIN Actor ON Event.source = Actor.id"
                            "     JOIN Name AS _ability ON Event.ability = _ability.id"
                            "     JOIN Advanced_Class AS ac ON Actor.class = ac.id"
                            "       JOIN Name AS _style ON ac.style = _style.id"
                            "       JOIN Name AS _discipline ON ac.class = _discipline.id"
                            " WHERE Event.source IS NOT NULL"
-                           "   AND Actor.type = $1"
+                           "   AND Actor.type = " + tx.quote(DbPopulator::ACTOR_PC_CLASS_TYPE_NAME) +
                            "   AND Event.ability IS NOT NULL"
-                           "   AND Actor.class != $2"
-                           " ORDER BY _style.name, _discipline.name, _ability.name",
-                           pqxx::params(DbPopulator::ACTOR_PC_CLASS_TYPE_NAME,
-                                        DbPopulator::UNKNOWN_CLASS_ROW_ID));
-        std::cout << "style,discipline,ability\n";
-        for (auto row : res) {
-            auto [style, discipline, ability] = row.as<std::string_view,std::string_view, std::string_view>();
-            std::cout << style << "," << discipline << "," << ability << "\n";
+                           "   AND Actor.class != " + tx.quote(DbPopulator::UNKNOWN_CLASS_ROW_ID) +
+                           " ORDER BY _style.name, _discipline.name, _ability.name";
+        CsvWriter out;
+        for (auto [style, discipline, ability] :
+                 tx.stream<std::string_view, std::string_view, std::string_view>(query)) {
+            out.row(style, discipline, ability);
         }
-        std::cout << res.size() << " rows\n";
+        out.flush();
+        std::cout << out.rows() << " rows\n";
     }
     if (FLAGS_all_classes) {
         std::cout << "You requested all classes.\n";
@@ -153,6 +221,31 @@ auto main(int argc, char* argv[]) -> int {
         }
         std::cout << res.size() << " rows\n";
     }
+    if (FLAGS_combat_summary) {
+        std::cout << "You requested the totals of each source and ability in each combat.\n";
+        // Reads the totals DbPopulator keeps in Combat_Summary rather than scanning Event.
+        auto res = tx.exec(" SELECT cs.combat, COALESCE(sn.name, ''), COALESCE(ab.name, ''), en.name,"
+                           "   SUM(cs.total), SUM(cs.effective), SUM(cs.hits), SUM(cs.crits), MAX(cs.max_hit),"
+                           "   SUM(cs.threat)"
+                           " FROM Combat_Summary AS cs"
+                           "     LEFT JOIN Actor AS src ON cs.source = src.id"
+                           "       LEFT JOIN Name AS sn ON src.name = sn.id"
+                           "     LEFT JOIN Name AS ab ON cs.ability = ab.id"
+                           "     JOIN Action AS ac ON cs.action = ac.id"
+                           "       JOIN Name AS en ON ac.noun = en.id"
+                           " GROUP BY cs.combat, sn.name, ab.name, en.name"
+                           " ORDER BY cs.combat, sn.name, SUM(cs.total) DESC");
+        std::cout << "combat_id,source,ability,effect,total,effective,hits,crits,max_hit,threat\n";
+        for (auto row : res) {
+            auto [combat_id, source, ability, effect, total, effective, hits, crits, max_hit, threat] =
+                row.as<int, std::string_view, std::string_view, std::string_view, int64_t, int64_t, int64_t, int64_t,
+                       int64_t, int64_t>();
+            std::cout << combat_id << "," << source << "," << ability << "," << effect << "," << total << ","
+                      << effective << "," << hits << "," << crits << "," << max_hit << "," << threat << "\n";
+        }
+        std::cout << res.size() << " rows\n";
+    }
+
     if (FLAGS_all_action_events) {
         std::cout << "You requested the nouns and details associated with the 'Event' action verb.\n";
         auto res = tx.exec(" SELECT DISTINCT an.name_id, an.name, ad.name_id, ad.name FROM Action"
@@ -169,27 +262,29 @@ auto main(int argc, char* argv[]) -> int {
     }
     if (FLAGS_pcs_in_combats) {
         std::cout << "You requested the PCs for all combats.\n";
-        auto res = tx.exec("SELECT DISTINCT"
-                           "  combat as combat_id"
-                           ", area_name.name as area_name"
-                           ", difficulty_name.name as difficulty_name"
-                           ", pc_name.name as pc_name"
-                           "    FROM Event"
-                           "     JOIN Combat on Event.combat = Combat.id"
-                           "     JOIN Actor on Event.source = Actor.id"
-                           "       JOIN Name as pc_name ON Actor.name = pc_name.id"
-                           "     JOIN Area on Combat.area = Area.id"
-                           "       JOIN Name as area_name ON area.area = area_name.id"
-                           "       JOIN Name as difficulty_name ON area.difficulty = difficulty_name.id"
-                           " WHERE Actor.type = 'pc' AND combat IS NOT NULL"
-                           " GROUP BY combat_id, area_name, difficulty_name, pc_name"
-                           " ORDER BY combat_id, pc_name");
-        std::cout << "combat, area, area, pc\n";
-        for (auto row : res) {
-            auto [combat_id, area_name, difficulty_name, pc_name] = row.as<int, std::string, std::string, std::string>();
-            std::cout << combat_id << "," << area_name << ", " << difficulty_name << ", " << pc_name << "\n";
+        std::cout << "combat,area,difficulty,pc\n";
+        CsvWriter out;
+        for (auto [combat_id, area_name, difficulty_name, pc_name] :
+                 tx.stream<int, std::string_view, std::string_view, std::string_view>(
+                     "SELECT DISTINCT"
+                     "  combat as combat_id"
+                     ", area_name.name as area_name"
+                     ", difficulty_name.name as difficulty_name"
+                     ", pc_name.name as pc_name"
+                     "    FROM Event"
+                     "     JOIN Combat on (Event.logfile, Event.combat) = (Combat.logfile, Combat.id)"
+                     "     JOIN Actor on Event.source = Actor.id"
+                     "       JOIN Name as pc_name ON Actor.name = pc_name.id"
+                     "     JOIN Area on Combat.area = Area.id"
+                     "       JOIN Name as area_name ON area.area = area_name.id"
+                     "       JOIN Name as difficulty_name ON area.difficulty = difficulty_name.id"
+                     " WHERE Actor.type = 'pc' AND combat IS NOT NULL"
+                     " GROUP BY combat_id, area_name, difficulty_name, pc_name"
+                     " ORDER BY combat_id, pc_name")) {
+            out.row(combat_id, area_name, difficulty_name, pc_name);
         }
-        std::cout << res.size() << " rows\n";
+        out.flush();
+        std::cout << out.rows() << " rows\n";
     }
 
     if (FLAGS_duplicate_name_counts) {
@@ -1,5 +1,7 @@
+#include <array>
 #include <chrono>
 #include <filesystem>
+#include <iomanip>
 #include <string>
 
 #include "timestamps.hpp"
@@ -15,6 +17,7 @@ namespace {
     const std::string FILENAME_SUFFIX {".txt"};
     const std::string::size_type FILENAME_MICROSECONDS_LEN {6};
     const std::string::size_type FILENAME_MICROSECONDS_SUFFIX_LEN {7};
+    const std::string_view::size_type LOG_ENTRY_TIME_LEN {12};
 } // namespace
 
 template<class Unit, class Tp>
@@ -86,40 +89,64 @@ auto Timestamps::log_file_creation_time(const std::string& log_filename) -> std:
     return std::string {lf.begin(), lf.end()};
 }
 
-auto Timestamps::update_from_log_entry(std::string_view log_entry_time) -> Timestamps&
+auto Timestamps::parse_log_entry_time(std::string_view log_entry_time) -> std::optional<sc::milliseconds>
 {
-    // OMG TODO: Handle errors.
-    const auto evt_time_ms_str = std::string {log_entry_time.end() - 3, log_entry_time.end()}; // ms is 3 digits
-    const auto evt_time_no_ms_str = std::string(log_entry_time).substr(0, 8); // len(HH:MM:SS) == 8
-    const auto evt_time_only_ms = sc::milliseconds(std::stol(evt_time_ms_str));
-
-    BLT(info) << "Event time str without ms: " << evt_time_no_ms_str;
-    BLT(info) << "Event time str ms only: " << evt_time_ms_str;
-    BLT(info) << "Event time ms only: " << evt_time_only_ms;
+    // Fixed width: HH:MM:SS.mmm
+    const auto& t = log_entry_time;
+    if (t.size() != LOG_ENTRY_TIME_LEN || t[2] != ':' || t[5] != ':' || t[8] != '.') {
+        return {};
+    }
 
-    sc::milliseconds evt_time_no_ms;
-    std::istringstream evt_time_in {evt_time_no_ms_str}; 
-    evt_time_in >> sc::parse("%T", evt_time_no_ms);
+    // A non-digit wraps around to something greater than 9, so one comparison per digit validates it.
+    auto digit = [&t] (std::size_t i) {
+        return static_cast<unsigned>(static_cast<unsigned char>(t[i])) - unsigned{'0'};
+    };
+    const std::array<unsigned, 9> d {digit(0), digit(1), digit(3), digit(4), digit(6), digit(7), digit(9), digit(10), digit(11)};
+    bool bad = false;
+    for (auto x : d) {
+        bad |= (x > 9);
+    }
+    const auto hours = d[0] * 10 + d[1];
+    const auto minutes = d[2] * 10 + d[3];
+    const auto seconds = d[4] * 10 + d[5];
+    const auto millis = d[6] * 100 + d[7] * 10 + d[8];
+    if (bad || hours > 23 || minutes > 59 || seconds > 59) {
+        return {};
+    }
 
-    auto evt_time_ms = evt_time_no_ms + evt_time_only_ms;
+    return sc::milliseconds(((hours * 60 + minutes) * 60 + seconds) * 1000 + millis);
+}
 
-    BLT(info) << "Event time of day without ms: " << evt_time_no_ms;
-    BLT(info) << "Event time of day only ms: " << evt_time_ms;
-    BLT(info) << "Event time of day in ms: " << evt_time_ms;
+auto Timestamps::update_from_log_entry(std::string_view log_entry_time) -> std::optional<timestamp>
+{
+    const auto evt_time_ms = parse_log_entry_time(log_entry_time);
+    if (!evt_time_ms) {
+        BLT(debug) << "Log entry time " << std::quoted(log_entry_time) << " isn't in the form HH:MM:SS.mmm.";
+        return {};
+    }
 
     if (!m_curr_log_entry_ts) {
-	m_curr_log_entry_ts.emplace(m_log_creation_ts);
+        m_day_base = sc::floor<sc::days>(m_log_creation_ts);
+        m_prev_time_of_day = sc::duration_cast<sc::milliseconds>(m_log_creation_ts - m_day_base);
     }
 
-    auto prev_log_entry_time_ms = sc::duration_cast<sc::milliseconds>((*m_curr_log_entry_ts - sc::floor<sc::days>(*m_curr_log_entry_ts)));
-    BLT(info) << "Previous event time of day in ms: " << evt_time_ms;
-    
-    *m_curr_log_entry_ts = sc::floor<sc::days>(*m_curr_log_entry_ts) + evt_time_ms;
-    if (prev_log_entry_time_ms > evt_time_ms) {
-	*m_curr_log_entry_ts = *m_curr_log_entry_ts + sc::days(1);
+    // Log entries only carry the time of day. Going backwards means we've passed midnight.
+    if (m_prev_time_of_day > *evt_time_ms) {
+        m_day_base += sc::days(1);
+    }
+    if (!m_first_time_of_day) {
+        m_first_time_of_day = evt_time_ms;
     }
-	    
-    BLT(info) << "Event timestamp: " << *m_curr_log_entry_ts;
+    m_prev_time_of_day = *evt_time_ms;
+    m_curr_log_entry_ts = m_day_base + *evt_time_ms;
 
-    return *this;
+    return m_curr_log_entry_ts;
+}
+
+auto Timestamps::resume(timestamp last_log_entry_ts) -> void
+{
+    m_curr_log_entry_ts = last_log_entry_ts;
+    m_day_base = sc::floor<sc::days>(last_log_entry_ts);
+    m_prev_time_of_day = sc::duration_cast<sc::milliseconds>(last_log_entry_ts - m_day_base);
+    m_first_time_of_day.reset();
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <optional>
 
@@ -46,14 +47,29 @@ class Timestamps
 	return LOG_ENTRY_TIME_FORMAT;
     }
 
-    // Updates the current state based on the log entry time  string. Returns a reference to this
-    // instance to use for chaining.
-    auto update_from_log_entry(std::string_view log_entry_time) -> Timestamps&;
+    // Decode a log entry time, "HH:MM:SS.mmm", into milliseconds since midnight. Returns an empty optional if the
+    // string isn't exactly in that form or a component is out of range.
+    auto static parse_log_entry_time(std::string_view log_entry_time) -> std::optional<std::chrono::milliseconds>;
+
+    // Updates the current state based on the log entry time string. Returns the new current timestamp, or an empty
+    // optional, leaving the state unchanged, if the time is malformed.
+    auto update_from_log_entry(std::string_view log_entry_time) -> std::optional<timestamp>;
+
+    // Continue as if the most recent log entry was at `last_log_entry_ts`. Used to pick up part way through a log, e.g.
+    // to parse a chunk of it separately or to resume an earlier run.
+    auto resume(timestamp last_log_entry_ts) -> void;
 
     auto current_log_timestamp() {
 	return m_curr_log_entry_ts;
     }
 
+    // Time of day of the first well-formed log entry time seen since construction or resume(). Whether that entry
+    // rolled over to the next day depends on what came before it, so a chunk parsed separately needs this to be
+    // fixed up.
+    auto first_log_entry_time_of_day() const {
+        return m_first_time_of_day;
+    }
+
     auto log_creation_timestamp() {
 	return m_log_creation_ts;
     }
@@ -86,4 +102,12 @@ private:
 
     // Beginning of the current day of the most recent timestamp seen.
     std::optional<timestamp> m_curr_log_entry_ts;
+
+    // Midnight of m_curr_log_entry_ts's day, cached so each update is an addition.
+    timestamp m_day_base;
+
+    // Time of day of m_curr_log_entry_ts. A log entry earlier in the day than this is on the next day.
+    std::chrono::milliseconds m_prev_time_of_day {};
+
+    std::optional<std::chrono::milliseconds> m_first_time_of_day;
 };
@@ -1,6 +1,12 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
 #include <string_view>
+#include <thread>
 #include <variant>
 
 #pragma GCC diagnostic push
@@ -8,6 +14,14 @@
 #include "gtest.h"
 #pragma GCC diagnostic pop
 
+#include "binary_log.hpp"
+#include "event_store.hpp"
+#include "ingest_pipeline.hpp"
+#include "log_file_source.hpp"
+#include "log_follower.hpp"
+#include "log_index.hpp"
+#include "parallel_log_parser.hpp"
+#include "spsc_queue.hpp"
 #include "timestamps.hpp"
 #include "log_parser_types.hpp"
 #include "log_parser.hpp"
@@ -65,6 +79,19 @@ TEST(StrToUint64, NonIntChars) {
     EXPECT_EQ(dist_to_first_non_int_char, 2);
 }
 
+TEST(StrToUint64, SignAndRange) {
+    uint64_t dist_to_first_non_int_char {};
+
+    auto val = lph.str_to_uint64(" +40", &dist_to_first_non_int_char);
+    EXPECT_TRUE(val);
+    EXPECT_EQ(*val, 40);
+    EXPECT_EQ(dist_to_first_non_int_char, 4);
+
+    EXPECT_FALSE(lph.str_to_uint64("18446744073709551615"));
+    EXPECT_FALSE(lph.str_to_uint64("99999999999999999999"));
+    EXPECT_TRUE(lph.str_to_uint64("18446744073709551614"));
+}
+
 TEST(StrToDouble, Empty) {
     uint64_t dist_to_first_non_double_char {};
 
@@ -268,6 +295,70 @@ TEST(GetNextField, Valid) {
     EXPECT_EQ(dist_beyond_field, 17);
 }
 
+TEST(GetNextField, Indexed) {
+    const std::vector<std::string> lines {
+        "{}", " {} ", "{a (bc>cd.}", "(a{{a}bcd)", "< ab <a><d<c>>cd>", "{a{c}", "  }{", "x|y|z",
+        "[17:47:07.963] [@Hsk#689203382607539|(-8.48,-5.50,-0.03,-119.21)|(1/2)] [=] [Power Yield {871884025020416}] "
+        "[ApplyEffect {836045448945477}: Power Yield {871884025020416}] ({a<b>(c)} [d]) <123.0>",
+    };
+
+    // Every field of every suffix and window of the lines must come out the same as without the index.
+    LogParserHelpers indexing_lph;
+    for (const auto& line : lines) {
+        const LogParserHelpers::IndexedLine indexed {indexing_lph, line};
+        const std::string_view whole {line};
+        for (std::size_t beg = 0; beg <= whole.size(); beg++) {
+            for (const auto end : {whole.size(), beg + (whole.size() - beg) / 2}) {
+                const auto part = whole.substr(beg, end - beg);
+                for (const auto& [open, close] : {std::pair {'[', ']'}, {'(', ')'}, {'<', '>'}, {'{', '}'}, {'(', '}'}}) {
+                    uint64_t plain_dist {}, indexed_dist {};
+                    const auto plain = lph.get_next_field(part, open, close, &plain_dist);
+                    const auto found = indexing_lph.get_next_field(part, open, close, &indexed_dist);
+                    ASSERT_EQ(plain.has_value(), found.has_value()) << line << " from " << beg << " to " << end;
+                    if (plain) {
+                        EXPECT_EQ(plain->data(), found->data());
+                        EXPECT_EQ(plain->size(), found->size());
+                        EXPECT_EQ(plain_dist, indexed_dist);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(ParseFixedPoint, Test) {
+    uint64_t dist {};
+
+    auto val = lph.parse_fixed_point("-0.18,", &dist);
+    ASSERT_TRUE(val);
+    EXPECT_EQ(*val, -0.18);
+    EXPECT_EQ(dist, 5);
+
+    val = lph.parse_fixed_point("179.59", &dist);
+    ASSERT_TRUE(val);
+    EXPECT_EQ(*val, 179.59);
+    EXPECT_EQ(dist, 6);
+
+    val = lph.parse_fixed_point("24", &dist);
+    ASSERT_TRUE(val);
+    EXPECT_EQ(*val, 24.0);
+
+    // Bit-for-bit the same as the general parser.
+    for (auto s : {"0.01", "1.1", "2.2", "3.3", "-4021.87", "0.3", "123456.789012345"}) {
+        EXPECT_EQ(lph.parse_fixed_point(s), lph.str_to_double(s)) << s;
+    }
+
+    // Forms left to str_to_double().
+    EXPECT_FALSE(lph.parse_fixed_point(""));
+    EXPECT_FALSE(lph.parse_fixed_point(" 1.1"));
+    EXPECT_FALSE(lph.parse_fixed_point("+1.1"));
+    EXPECT_FALSE(lph.parse_fixed_point("1."));
+    EXPECT_FALSE(lph.parse_fixed_point("1.A"));
+    EXPECT_FALSE(lph.parse_fixed_point("1e5"));
+    EXPECT_FALSE(lph.parse_fixed_point("4.4as"));
+    EXPECT_FALSE(lph.parse_fixed_point("1234567890.1234567"));
+}
+
 TEST(ParseStLocation, Invalid) {
     EXPECT_FALSE(lph.parse_st_location(""));
     EXPECT_FALSE(lph.parse_st_location("1"));
@@ -1044,6 +1135,52 @@ TEST(ParseThreatField, ValidThreat) {
     EXPECT_EQ(ver, "v7.0.0b");
 }
 
+TEST(Timestamps, parse_log_entry_time) {
+    using std::chrono::milliseconds;
+    EXPECT_EQ(Timestamps::parse_log_entry_time("00:00:00.000"), milliseconds(0));
+    EXPECT_EQ(Timestamps::parse_log_entry_time("19:03:09.182"), milliseconds(((19 * 60 + 3) * 60 + 9) * 1000 + 182));
+    EXPECT_EQ(Timestamps::parse_log_entry_time("23:59:59.999"), milliseconds(86399999));
+
+    EXPECT_FALSE(Timestamps::parse_log_entry_time(""));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("19:03:09"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("19:03:09.1820"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("19-03:09.182"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("19:03:09,182"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("1a:03:09.182"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("19:03:09.1 2"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("24:00:00.000"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("12:60:00.000"));
+    EXPECT_FALSE(Timestamps::parse_log_entry_time("12:00:60.000"));
+}
+
+TEST(Timestamps, update_from_log_entry) {
+    using namespace std::chrono;
+    Timestamps ts {std::string {"2025-05-15_23_58_00_000000"}};
+    const auto day = floor<days>(ts.log_creation_timestamp());
+
+    auto t1 = ts.update_from_log_entry("23:59:59.500");
+    ASSERT_TRUE(t1);
+    EXPECT_EQ(*t1 - day, hours(23) + minutes(59) + seconds(59) + milliseconds(500));
+
+    // Malformed times are reported and don't change the state.
+    EXPECT_FALSE(ts.update_from_log_entry("23:59:5x.500"));
+    EXPECT_EQ(ts.current_log_timestamp(), t1);
+
+    // Earlier in the day than the previous entry means the next day.
+    auto t2 = ts.update_from_log_entry("00:00:01.000");
+    ASSERT_TRUE(t2);
+    EXPECT_EQ(*t2 - *t1, milliseconds(1500));
+
+    auto t3 = ts.update_from_log_entry("00:00:01.000");
+    EXPECT_EQ(t3, t2);
+}
+
+TEST(LogParser, malformed_timestamp) {
+    LogParser lp;
+    Timestamps ts;
+    EXPECT_FALSE(lp.parse_line("[19:03:xx.182] [] [] [] [AreaEntered {836045448953664}: D5-Mantis {137438988857}]", 1, ts));
+}
+
 // TODO - I could use a few more of these.
 TEST(LogParser, parse_line) {
     LogParser lp;
@@ -1082,3 +1219,770 @@ TEST(LogParser, parse_line) {
     EXPECT_TRUE(std::holds_alternative<std::string>(*pll->threat));
     EXPECT_EQ(std::get<std::string>(*pll->threat), std::string{"v7.0.0b"});
 }
+
+TEST(LogParser, parse_line_view) {
+    LogParser lp;
+
+    Timestamps ts;
+    const std::string line {"[19:03:10.001] [@Mystic Scriabin#689778209418226/T7-O1 {3916251853619200}:27075000047201|(-0.18,24.30,4.02,179.59)|(1/40729)] [=] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (1063* ~1062 kinetic {836045448940873} -shield {836045448945509} (98 absorbed {836045448945511})) <1063.0>"};
+    auto view = lp.parse_line_view(line, 1, ts);
+    ASSERT_TRUE(view);
+
+    // Strings refer into the line rather than owning copies.
+    auto in_line = [&line] (std::string_view s) {
+        return s.data() >= line.data() && s.data() + s.size() <= line.data() + line.size();
+    };
+    ASSERT_TRUE(std::holds_alternative<LogParserTypes::CompanionActorView>(view->source->actor));
+    const auto& comp = std::get<LogParserTypes::CompanionActorView>(view->source->actor);
+    EXPECT_EQ(comp.pc.name, "Mystic Scriabin");
+    EXPECT_TRUE(in_line(comp.pc.name));
+    EXPECT_EQ(comp.companion.name_id.name, "T7-O1");
+    EXPECT_EQ(comp.companion.instance, 27075000047201UL);
+    EXPECT_TRUE(in_line(comp.companion.name_id.name));
+    ASSERT_TRUE(view->target);
+    EXPECT_TRUE(std::holds_alternative<LogParserTypes::CompanionActorView>(view->target->actor));
+    EXPECT_EQ(view->ability->name, "Shock");
+    EXPECT_TRUE(in_line(view->ability->name));
+    EXPECT_EQ(view->action.noun.name, "Damage");
+    EXPECT_FALSE(view->action.detail);
+    const auto& rv = std::get<LogParserTypes::RealValueView>(*view->value);
+    EXPECT_EQ(rv.base_value, 1063UL);
+    EXPECT_TRUE(rv.crit);
+    EXPECT_EQ(rv.type->name, "kinetic");
+    EXPECT_EQ(rv.mitigation_reason->name, "shield");
+    EXPECT_EQ(rv.mitigation_effect->effect->name, "absorbed");
+    EXPECT_TRUE(in_line(rv.mitigation_effect->effect->name));
+
+    // Materializing gives the same result as parsing into the owning types.
+    auto owned = LogParserTypes::materialize(*view);
+    Timestamps ts2;
+    auto pll = lp.parse_line(line, 1, ts2);
+    ASSERT_TRUE(pll);
+    EXPECT_EQ(owned.ts, pll->ts);
+    const auto& owned_comp = std::get<LogParserTypes::CompanionActor>(owned.source->actor);
+    EXPECT_EQ(owned_comp.pc.name, "Mystic Scriabin");
+    EXPECT_EQ(owned_comp.companion.name_id.id, 3916251853619200UL);
+    EXPECT_EQ(owned.ability->name, pll->ability->name);
+    EXPECT_EQ(owned.action.verb.ref().name, pll->action.verb.ref().name);
+    const auto& owned_rv = std::get<LogParserTypes::RealValue>(*owned.value);
+    const auto& rv2 = std::get<LogParserTypes::RealValue>(*pll->value);
+    EXPECT_EQ(owned_rv.effective, rv2.effective);
+    EXPECT_EQ(owned_rv.mitigation_effect->value, rv2.mitigation_effect->value);
+    EXPECT_EQ(owned_rv.mitigation_effect->effect->name, "absorbed");
+    EXPECT_DOUBLE_EQ(std::get<double>(*owned.threat), 1063.0);
+}
+
+TEST(LogFileSource, lines) {
+    const auto path = std::filesystem::temp_directory_path() / "swtor_combat_log_file_source_test.txt";
+    {
+        std::ofstream out {path, std::ios::binary};
+        out << "first\r\n" << "\r\n" << "lf only\n" << "\n" << "last, unterminated";
+    }
+
+    for (auto mode : {LogFileSource::Mode::MMAP, LogFileSource::Mode::READ}) {
+        auto src = LogFileSource::open(path.string(), mode);
+        ASSERT_TRUE(src);
+        EXPECT_EQ(src->is_mapped(), mode == LogFileSource::Mode::MMAP);
+
+        // Moving must keep the contents valid, whether mapped or buffered.
+        auto moved = std::move(*src);
+        std::vector<LogLine> lines;
+        for (const auto& ll : moved.lines()) {
+            lines.push_back(ll);
+        }
+        ASSERT_EQ(lines.size(), 5U);
+        EXPECT_EQ(lines[0].text, "first");
+        EXPECT_EQ(lines[0].offset, 0U);
+        EXPECT_EQ(lines[1].text, "");
+        EXPECT_EQ(lines[2].text, "lf only");
+        EXPECT_EQ(lines[2].offset, 9U);
+        EXPECT_EQ(lines[2].line_num, 3);
+        EXPECT_EQ(lines[3].text, "");
+        EXPECT_EQ(lines[4].text, "last, unterminated");
+        EXPECT_EQ(lines[4].line_num, 5);
+    }
+
+    std::filesystem::remove(path);
+    EXPECT_FALSE(LogFileSource::open(path.string()));
+}
+
+TEST(LogFileSource, empty_file) {
+    const auto path = std::filesystem::temp_directory_path() / "swtor_combat_log_file_source_empty.txt";
+    std::ofstream {path};
+    auto src = LogFileSource::open(path.string());
+    ASSERT_TRUE(src);
+    EXPECT_FALSE(src->is_mapped());
+    EXPECT_TRUE(src->contents().empty());
+    EXPECT_EQ(src->lines().begin(), std::default_sentinel);
+    std::filesystem::remove(path);
+}
+
+TEST(LogFollower, appended_lines) {
+    using namespace std::chrono_literals;
+    const auto path = std::filesystem::temp_directory_path() / "swtor_combat_log_follower_test.txt";
+    std::ofstream out {path, std::ios::binary};
+    out << "first\r\n" << "partial" << std::flush;
+
+    auto lf = LogFollower::open(path.string());
+    ASSERT_TRUE(lf);
+    auto chunk = lf->next(0ms);
+    EXPECT_EQ(chunk.text, "first\r\n");
+    EXPECT_EQ(chunk.first_line_num, 1);
+    EXPECT_EQ(chunk.offset, 0U);
+
+    // Nothing new yet; the partial line is held back.
+    chunk = lf->next(10ms);
+    EXPECT_TRUE(chunk.text.empty());
+    EXPECT_EQ(lf->offset(), 7U);
+    EXPECT_EQ(lf->line_num(), 1);
+
+    // The rest arrives while next() is waiting.
+    std::thread writer {[&out] {
+        std::this_thread::sleep_for(20ms);
+        out << " line\n" << "\n" << "third\n" << std::flush;
+    }};
+    const auto start = std::chrono::steady_clock::now();
+    chunk = lf->next(5000ms);
+    writer.join();
+    if (chunk.text == "partial line\n") {
+        // The writer's first write was seen on its own.
+        chunk = lf->next(5000ms);
+        EXPECT_EQ(chunk.first_line_num, 3);
+    } else {
+        EXPECT_EQ(chunk.text, "partial line\n\nthird\n");
+        EXPECT_EQ(chunk.first_line_num, 2);
+        EXPECT_EQ(chunk.offset, 7U);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 2s);
+    EXPECT_EQ(lf->offset(), 27U);
+    EXPECT_EQ(lf->line_num(), 4);
+    EXPECT_FALSE(lf->finished());
+
+    // Resume where the last follower left off.
+    auto resumed = LogFollower::open(path.string(), lf->offset(), lf->line_num());
+    ASSERT_TRUE(resumed);
+    out << "fifth\n" << std::flush;
+    chunk = resumed->next(1000ms);
+    EXPECT_EQ(chunk.text, "fifth\n");
+    EXPECT_EQ(chunk.first_line_num, 5);
+    EXPECT_EQ(chunk.offset, 27U);
+
+    // Not at the start of a line, or past the end.
+    EXPECT_FALSE(LogFollower::open(path.string(), 3, 1));
+    EXPECT_FALSE(LogFollower::open(path.string(), 1000, 1));
+
+    out.close();
+    std::filesystem::remove(path);
+    chunk = resumed->next(1000ms);
+    EXPECT_TRUE(chunk.text.empty());
+    EXPECT_TRUE(resumed->finished());
+}
+
+TEST(ParallelLogParser, matches_serial) {
+    // Twenty minutes between lines crosses midnight every 72 lines. Throw in blank, CRLF, and malformed lines, including
+    // one whose timestamp is fine but whose source isn't; it still counts for rollover.
+    std::string log;
+    int minutes = 19 * 60;
+    for (int i = 0; i < 300; i++) {
+        char tod[16];
+        std::snprintf(tod, sizeof(tod), "%02d:%02d:%02d.%03d", (minutes / 60) % 24, minutes % 60, i % 60, i % 1000);
+        minutes += 20;
+        if (i % 50 == 7) {
+            log += "\n";
+        }
+        if (i % 61 == 3) {
+            log += "[" + std::string(tod) + "] [@Broken|(x,y,z,r)|(1/1)] [] [] [AreaEntered {1}: D5-Mantis {2}]\n";
+            continue;
+        }
+        if (i % 97 == 5) {
+            log += "[2x:00:00.000] [] [] [] [AreaEntered {1}: D5-Mantis {2}]\n";
+            continue;
+        }
+        log += "[" + std::string(tod) + "] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [=] "
+            "[Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (1063* ~1062) <1063.0>";
+        log += (i % 2 == 0) ? "\r\n" : "\n";
+    }
+
+    const std::string creation {"2025-05-15_19_00_00_000000"};
+    std::vector<LogLine> serial_lines;
+    std::vector<LogParserTypes::ParsedLogLineView> serial;
+    std::size_t serial_failed {};
+    Timestamps serial_ts {creation};
+    LogParser lp;
+    for (const auto& line : LogFileSource::lines(log, 1, 0)) {
+        if (line.text.empty()) {
+            continue;
+        }
+        if (auto parsed = lp.parse_line_view(line.text, line.line_num, serial_ts)) {
+            serial_lines.push_back(line);
+            serial.push_back(*parsed);
+        } else {
+            ++serial_failed;
+        }
+    }
+    ASSERT_EQ(serial_failed, 9U);
+    ASSERT_GT(*serial_ts.current_log_timestamp() - serial.front().ts, std::chrono::days(3));
+
+    for (unsigned threads : {1U, 2U, 3U, 7U, 16U, 1000U}) {
+        Timestamps ts {creation};
+        auto res = ParallelLogParser(threads).parse(log, ts);
+        EXPECT_EQ(res.failed_lines, serial_failed) << threads << " threads";
+        ASSERT_EQ(res.entries.size(), serial.size()) << threads << " threads";
+        for (std::size_t i = 0; i < serial.size(); i++) {
+            const auto& e = res.entries[i];
+            EXPECT_EQ(e.line.line_num, serial_lines[i].line_num);
+            EXPECT_EQ(e.line.offset, serial_lines[i].offset);
+            EXPECT_EQ(e.line.text, serial_lines[i].text);
+            EXPECT_EQ(e.parsed.ts, serial[i].ts) << threads << " threads, line " << e.line.line_num;
+            EXPECT_EQ(e.parsed.action.noun.name, serial[i].action.noun.name);
+        }
+        EXPECT_EQ(ts.current_log_timestamp(), serial_ts.current_log_timestamp());
+    }
+}
+
+TEST(ParallelLogParser, split_into_chunks) {
+    std::string_view log {"a\nbb\nccc\ndddd\neeeee"};
+    for (unsigned n : {1U, 2U, 3U, 5U, 50U}) {
+        auto chunks = ParallelLogParser::split_into_chunks(log, n);
+        EXPECT_LE(chunks.size(), n);
+        std::string joined;
+        for (const auto& c : chunks) {
+            EXPECT_FALSE(c.empty());
+            if (&c != &chunks.back()) {
+                EXPECT_EQ(c.back(), '\n');
+            }
+            joined += c;
+        }
+        EXPECT_EQ(joined, log);
+    }
+    EXPECT_TRUE(ParallelLogParser::split_into_chunks("", 4).empty());
+}
+
+TEST(SpscQueue, push_pop_close) {
+    SpscQueue<std::string> q {2};
+    EXPECT_EQ(q.capacity(), 2U);
+    EXPECT_FALSE(q.try_pop());
+
+    std::string a {"a"}, b {"b"}, c {"c"};
+    EXPECT_TRUE(q.try_push(a));
+    EXPECT_TRUE(q.push(b));
+    EXPECT_FALSE(q.try_push(c));
+    EXPECT_EQ(c, "c"); // Not moved from when full.
+    EXPECT_EQ(q.size(), 2U);
+
+    EXPECT_EQ(q.pop(), "a");
+    EXPECT_TRUE(q.try_push(c));
+    q.close();
+    EXPECT_FALSE(q.push("d"));
+
+    // Whatever was queued before the close still comes out.
+    EXPECT_EQ(q.pop(), "b");
+    EXPECT_EQ(q.try_pop(), "c");
+    EXPECT_FALSE(q.pop());
+    EXPECT_EQ(q.stats().pushes, 1U);
+    EXPECT_EQ(q.stats().pops, 2U);
+    EXPECT_EQ(q.stats().max_occupancy, 2U);
+}
+
+TEST(SpscQueue, threads) {
+    constexpr uint64_t NUM_ITEMS {100000};
+    SpscQueue<uint64_t> q {4};
+    std::thread producer {[&] {
+        for (uint64_t i = 1; i <= NUM_ITEMS; i++) {
+            ASSERT_TRUE(q.push(i));
+        }
+        q.close();
+    }};
+
+    uint64_t expected {1};
+    while (auto item = q.pop()) {
+        ASSERT_EQ(*item, expected);
+        ++expected;
+    }
+    producer.join();
+    EXPECT_EQ(expected, NUM_ITEMS + 1);
+    EXPECT_EQ(q.stats().pushes, NUM_ITEMS);
+    EXPECT_EQ(q.stats().pops, NUM_ITEMS);
+    EXPECT_LE(q.stats().max_occupancy, 4U);
+}
+
+TEST(SpscQueue, consumer_close_unblocks_producer) {
+    SpscQueue<int> q {1};
+    std::atomic<int> pushed {0};
+    std::thread producer {[&] {
+        while (q.push(pushed.load())) {
+            ++pushed;
+        }
+    }};
+    // The producer fills the queue and then waits for room until the consumer gives up.
+    while (q.size() < 1) {
+        std::this_thread::yield();
+    }
+    q.close();
+    producer.join();
+    EXPECT_EQ(pushed.load(), 1);
+}
+
+namespace {
+    auto make_pipeline_log(int num_lines) -> std::string {
+        std::string log;
+        for (int i = 0; i < num_lines; i++) {
+            if (i % 10 == 3) {
+                log += "\n";
+            }
+            if (i % 25 == 4) {
+                log += "[2x:00:00.000] [] [] [] [AreaEntered {1}: D5-Mantis {2}]\n";
+                continue;
+            }
+            char tod[16];
+            std::snprintf(tod, sizeof(tod), "%02d:%02d:%02d.%03d", 19 + i / 3600, (i / 60) % 60, i % 60, i % 1000);
+            log += "[" + std::string(tod) + "] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] "
+                "[=] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (" +
+                std::to_string(i) + "* ~1062) <1063.0>\n";
+        }
+        return log;
+    }
+} // namespace
+
+TEST(IngestPipeline, matches_serial) {
+    const auto log = make_pipeline_log(1000);
+    const std::string creation {"2025-05-15_19_00_00_000000"};
+
+    std::vector<LogParserTypes::ParsedLogLine> serial;
+    std::size_t serial_failed {};
+    Timestamps serial_ts {creation};
+    LogParser lp;
+    for (const auto& line : LogFileSource::lines(log, 1, 0)) {
+        if (line.text.empty()) {
+            continue;
+        }
+        if (auto parsed = lp.parse_line(line.text, line.line_num, serial_ts)) {
+            serial.push_back(std::move(*parsed));
+        } else {
+            ++serial_failed;
+        }
+    }
+    ASSERT_EQ(serial_failed, 40U);
+
+    for (std::size_t batch_lines : {1U, 7U, 256U, 5000U}) {
+        Timestamps ts {creation};
+        std::vector<LogParserTypes::ParsedLogLine> written;
+        std::size_t batches {};
+        IngestPipeline pipeline {IngestPipeline::Options {.batch_lines = batch_lines, .queue_batches = 2}};
+        auto stats = pipeline.run(log, ts, [&] (IngestPipeline::Batch& batch) {
+            EXPECT_LE(batch.size(), batch_lines);
+            ++batches;
+            for (auto& e : batch) {
+                written.push_back(std::move(e));
+            }
+        });
+        EXPECT_EQ(stats.failed_lines, serial_failed);
+        EXPECT_EQ(stats.parsed_lines, serial.size());
+        EXPECT_EQ(stats.batches, batches);
+        EXPECT_EQ(stats.batches, (serial.size() + batch_lines - 1) / batch_lines);
+        EXPECT_LE(stats.max_queue_occupancy, 2U);
+        EXPECT_EQ(stats.queue_capacity, 2U);
+        ASSERT_EQ(written.size(), serial.size());
+        for (std::size_t i = 0; i < serial.size(); i++) {
+            EXPECT_EQ(written[i].ts, serial[i].ts);
+            EXPECT_EQ(std::get<LogParserTypes::RealValue>(*written[i].value).base_value,
+                      std::get<LogParserTypes::RealValue>(*serial[i].value).base_value);
+        }
+        EXPECT_EQ(ts.current_log_timestamp(), serial_ts.current_log_timestamp());
+    }
+}
+
+TEST(IngestPipeline, first_line_num) {
+    const auto log = make_pipeline_log(100);
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    IngestPipeline pipeline {IngestPipeline::Options {.batch_lines = 4, .queue_batches = 1, .first_line_num = 501}};
+    std::size_t written {};
+    auto stats = pipeline.run(log, ts, [&] (IngestPipeline::Batch& batch) { written += batch.size(); });
+    EXPECT_EQ(stats.lines, 500 + std::count(log.begin(), log.end(), '\n'));
+    EXPECT_EQ(written, stats.parsed_lines);
+    EXPECT_EQ(stats.parsed_lines + stats.failed_lines, 100U);
+}
+
+TEST(IngestPipeline, writer_error) {
+    // A small queue and a big log, so that the parser is waiting for room when the writer fails.
+    const auto log = make_pipeline_log(5000);
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    IngestPipeline pipeline {IngestPipeline::Options {.batch_lines = 1, .queue_batches = 1}};
+    std::size_t calls {};
+    EXPECT_THROW(pipeline.run(log, ts, [&] (IngestPipeline::Batch&) {
+        if (++calls == 3) {
+            throw std::runtime_error("database went away");
+        }
+    }), std::runtime_error);
+    EXPECT_EQ(calls, 3U);
+}
+
+namespace {
+    const std::vector<std::string> EVENT_STORE_LOG {
+        "[19:03:09.182] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [] [] [AreaEntered {836045448953664}: D5-Mantis {137438988857}] (he3001) <v7.0.0b>",
+        "[19:03:10.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [] [] [Event {836045448945472}: EnterCombat {836045448945489}]",
+        "[19:03:10.001] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [Dread Guard {3266045571072000}:28000000000001|(1.00,2.00,3.00,4.00)|(100/200)] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (1063* ~1062 kinetic {836045448940873}) <1063.0>",
+        "[19:03:10.500] [@Mystic Scriabin#689778209418226/T7-O1 {3916251853619200}:27075000047201|(-0.18,24.30,4.02,179.59)|(1/40729)] [Dread Guard {3266045571072000}:28000000000001|(1.00,2.00,3.00,4.00)|(100/200)] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (500 kinetic {836045448940873}) <500.0>",
+        "[19:03:11.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [Dread Guard {3266045571072000}:28000000000001|(1.00,2.00,3.00,4.00)|(100/200)] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (700 kinetic {836045448940873}) <700.0>",
+        "[19:03:12.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [] [] [Event {836045448945472}: ExitCombat {836045448945490}]",
+        "[19:03:13.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [Dread Guard {3266045571072000}:28000000000001|(1.00,2.00,3.00,4.00)|(100/200)] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (9 kinetic {836045448940873}) <9.0>",
+    };
+} // namespace
+
+TEST(EventStore, columns_and_combats) {
+    EventStore store;
+    LogParser lp;
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    for (std::size_t i = 0; i < EVENT_STORE_LOG.size(); i++) {
+        auto entry = lp.parse_line_view(EVENT_STORE_LOG[i], static_cast<int>(i + 1), ts);
+        ASSERT_TRUE(entry) << EVENT_STORE_LOG[i];
+        store.add(*entry);
+    }
+    ASSERT_EQ(store.size(), EVENT_STORE_LOG.size());
+
+    // The EnterCombat row is in the combat; the ExitCombat row isn't.
+    ASSERT_EQ(store.combats().size(), 1U);
+    const auto& combat = store.combats()[0];
+    EXPECT_EQ(combat.first_row, 1U);
+    EXPECT_EQ(combat.end_row, 5U);
+    EXPECT_EQ(combat.ts_begin, store.ts()[1]);
+    EXPECT_EQ(combat.ts_end, store.ts()[5]);
+    EXPECT_EQ(store.combat()[0], 0U);
+    EXPECT_EQ(store.combat()[4], 1U);
+    EXPECT_EQ(store.combat()[5], 0U);
+
+    // Names, actors, and actions are each stored once.
+    EXPECT_EQ(store.source()[2], store.source()[4]);
+    EXPECT_NE(store.source()[2], store.source()[3]);
+    EXPECT_EQ(store.actor(store.source()[3]).type, EventStore::ActorType::COMPANION);
+    EXPECT_EQ(store.actor(store.source()[3]).owner, store.source()[2]);
+    EXPECT_EQ(store.actor_name(store.target()[2]), "Dread Guard");
+    EXPECT_EQ(store.target()[1], EventStore::NOT_APPLICABLE);
+    EXPECT_EQ(store.ability()[2], store.find_name(807663142748160));
+    EXPECT_EQ(store.name(store.ability()[2]), "Shock");
+    EXPECT_EQ(store.action()[2], store.action()[6]);
+    EXPECT_EQ(store.name(store.action_info(store.action()[2]).noun), "Damage");
+    EXPECT_EQ(store.find_name(1), EventStore::NOT_APPLICABLE);
+
+    EXPECT_EQ(store.value()[2], 1063);
+    EXPECT_EQ(store.effective()[2], 1062);
+    EXPECT_EQ(store.effective()[3], 500);
+    EXPECT_EQ(store.flags()[2], EventStore::HAS_VALUE | EventStore::CRIT | EventStore::HAS_THREAT);
+    EXPECT_EQ(store.flags()[1], 0);
+    EXPECT_EQ(store.name(store.value_type()[3]), "kinetic");
+
+    // Adding the owning types gives the same rows.
+    EventStore owned;
+    Timestamps ts2 {std::string("2025-05-15_19_00_00_000000")};
+    for (std::size_t i = 0; i < EVENT_STORE_LOG.size(); i++) {
+        owned.add(*lp.parse_line(EVENT_STORE_LOG[i], static_cast<int>(i + 1), ts2));
+    }
+    auto same = [] (auto a, auto b) { return std::equal(a.begin(), a.end(), b.begin(), b.end()); };
+    EXPECT_TRUE(same(owned.ts(), store.ts()));
+    EXPECT_TRUE(same(owned.combat(), store.combat()));
+    EXPECT_TRUE(same(owned.source(), store.source()));
+    EXPECT_TRUE(same(owned.target(), store.target()));
+    EXPECT_TRUE(same(owned.action(), store.action()));
+    EXPECT_TRUE(same(owned.effective(), store.effective()));
+    EXPECT_TRUE(same(owned.flags(), store.flags()));
+}
+
+TEST(EventStore, filter_and_group_by) {
+    EventStore store;
+    LogParser lp;
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    for (std::size_t i = 0; i < EVENT_STORE_LOG.size(); i++) {
+        store.add(*lp.parse_line_view(EVENT_STORE_LOG[i], static_cast<int>(i + 1), ts));
+    }
+
+    const auto in_combat = store.rows_of_combat(1);
+    EXPECT_EQ(in_combat, (EventStore::Selection {1, 2, 3, 4}));
+    EXPECT_TRUE(store.rows_of_combat(2).empty());
+
+    const auto hits = store.filter(in_combat, [&store] (uint32_t row) {
+        return (store.flags()[row] & EventStore::HAS_VALUE) != 0;
+    });
+    EXPECT_EQ(hits, (EventStore::Selection {2, 3, 4}));
+    EXPECT_EQ(store.filter([&store] (uint32_t row) { return store.value()[row] > 600; }),
+              (EventStore::Selection {2, 4}));
+
+    std::size_t visited {};
+    store.scan(hits, [&visited] (uint32_t) { ++visited; });
+    EXPECT_EQ(visited, 3U);
+
+    const auto t = store.totals(hits);
+    EXPECT_EQ(t.events, 3U);
+    EXPECT_EQ(t.hits, 3U);
+    EXPECT_EQ(t.crits, 1U);
+    EXPECT_EQ(t.total, 2263);
+    EXPECT_EQ(t.effective, 2262);
+    EXPECT_EQ(t.max_hit, 1063);
+    EXPECT_DOUBLE_EQ(t.threat, 2263.0);
+
+    const auto by_source = store.group_by(in_combat, [&store] (uint32_t row) { return store.source()[row]; });
+    ASSERT_EQ(by_source.size(), 2U);
+    const auto& pc = by_source.at(store.source()[2]);
+    EXPECT_EQ(pc.events, 3U);
+    EXPECT_EQ(pc.hits, 2U);
+    EXPECT_EQ(pc.total, 1763);
+    const auto& companion = by_source.at(store.source()[3]);
+    EXPECT_EQ(companion.total, 500);
+    EXPECT_EQ(companion.max_hit, 500);
+
+    const auto by_pair = store.group_by(hits, [&store] (uint32_t row) {
+        return std::tuple(store.ability()[row], store.target()[row]);
+    });
+    ASSERT_EQ(by_pair.size(), 1U);
+    EXPECT_EQ(by_pair.begin()->second.total, 2263);
+}
+
+TEST(BinaryLog, round_trip) {
+    auto lines = EVENT_STORE_LOG;
+    lines.emplace_back("[19:03:14.000] [@Mystic Scriabin#689778209418226/T7-O1 {3916251853619200}:27075000047201|(-0.18,24.30,4.02,179.59)|(1/40729)] [=] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (1063* ~1062 kinetic {836045448940873} -shield {836045448945509} (98 absorbed {836045448945511})) <1063.0>");
+
+    LogParser lp;
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    BinaryLogWriter writer;
+    std::vector<LogParserTypes::ParsedLogLine> parsed;
+    for (std::size_t i = 0; i < lines.size(); i++) {
+        auto entry = lp.parse_line(lines[i], static_cast<int>(i + 1), ts);
+        ASSERT_TRUE(entry) << lines[i];
+        writer.add(*entry);
+        parsed.push_back(std::move(*entry));
+    }
+    const auto bin = writer.finish();
+    EXPECT_TRUE(BinaryLogReader::is_binary_log(bin));
+
+    auto reader = BinaryLogReader::from_bytes(bin);
+    ASSERT_TRUE(reader);
+    ASSERT_EQ(reader->size(), lines.size());
+    BinaryLogWriter rewriter;
+    std::vector<LogParserTypes::ParsedLogLineView> loaded;
+    while (auto entry = reader->next()) {
+        rewriter.add(*entry);
+        loaded.push_back(*entry);
+    }
+    EXPECT_FALSE(reader->failed());
+    ASSERT_EQ(loaded.size(), parsed.size());
+
+    // Every field survives: encoding what was loaded gives the same file.
+    EXPECT_EQ(rewriter.finish(), bin);
+    for (std::size_t i = 0; i < loaded.size(); i++) {
+        EXPECT_EQ(loaded[i].ts, parsed[i].ts) << lines[i];
+        EXPECT_EQ(loaded[i].source->loc, parsed[i].source->loc) << lines[i];
+    }
+
+    EXPECT_EQ(std::get<LogParserTypes::LogInfoValueView>(*loaded[0].value).info, "he3001");
+    EXPECT_EQ(std::get<std::string_view>(*loaded[0].threat), "v7.0.0b");
+    const auto& comp = std::get<LogParserTypes::CompanionActorView>(loaded[3].source->actor);
+    EXPECT_EQ(comp.companion.name_id.name, "T7-O1");
+    EXPECT_EQ(comp.companion.instance, 27075000047201U);
+    EXPECT_EQ(loaded[2].target->health, LogParserTypes::Health(LogParserTypes::Health::Current(100),
+                                                                LogParserTypes::Health::Total(200)));
+    const auto& rv = std::get<LogParserTypes::RealValueView>(*loaded[7].value);
+    EXPECT_TRUE(rv.crit);
+    EXPECT_EQ(rv.effective, 1062U);
+    EXPECT_EQ(rv.mitigation_reason->name, "shield");
+    EXPECT_EQ(rv.mitigation_effect->value, 98U);
+    EXPECT_EQ(rv.mitigation_effect->effect->name, "absorbed");
+    EXPECT_DOUBLE_EQ(std::get<double>(*loaded[7].threat), 1063.0);
+}
+
+TEST(BinaryLog, corrupt) {
+    EXPECT_FALSE(BinaryLogReader::from_bytes("[19:03:09.182] not a binary log"));
+
+    LogParser lp;
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    BinaryLogWriter writer;
+    for (std::size_t i = 0; i < EVENT_STORE_LOG.size(); i++) {
+        writer.add(*lp.parse_line_view(EVENT_STORE_LOG[i], static_cast<int>(i + 1), ts));
+    }
+    const auto bin = writer.finish();
+
+    // Cut off in the middle of the last entry.
+    auto reader = BinaryLogReader::from_bytes(std::string_view(bin).substr(0, bin.size() - 3));
+    ASSERT_TRUE(reader);
+    std::size_t loaded {};
+    while (reader->next()) {
+        ++loaded;
+    }
+    EXPECT_EQ(loaded, EVENT_STORE_LOG.size() - 1);
+    EXPECT_TRUE(reader->failed());
+}
+
+TEST(LogIndex, build_extend_and_seek) {
+    const auto path = std::filesystem::temp_directory_path() / "combat_2025-05-15_19_00_00_000000.txt";
+    const auto sidecar = LogIndex::sidecar_path(path.string());
+    std::filesystem::remove(sidecar);
+    std::ofstream out {path, std::ios::binary};
+    for (std::size_t i = 0; i < 4; i++) {
+        out << EVENT_STORE_LOG[i] << "\r\n";
+    }
+    // The game is part way through writing line 5.
+    out << EVENT_STORE_LOG[4].substr(0, 20) << std::flush;
+
+    auto index = LogIndex::load_or_build(path.string(), 2);
+    ASSERT_TRUE(index);
+    EXPECT_EQ(index->last_line_num(), 4);
+    ASSERT_EQ(index->marks().size(), 3U);
+    EXPECT_EQ(index->marks()[0].kind, LogIndex::Kind::AREA_ENTERED);
+    EXPECT_EQ(index->marks()[1].kind, LogIndex::Kind::ENTER_COMBAT);
+    EXPECT_EQ(index->marks()[1].offset, EVENT_STORE_LOG[0].size() + 2);
+    EXPECT_EQ(index->marks()[2].kind, LogIndex::Kind::CHECKPOINT);
+    EXPECT_EQ(index->marks()[2].line_num, 4);
+    EXPECT_TRUE(std::filesystem::exists(sidecar));
+
+    // The rest is indexed on the next load, picking up from the sidecar.
+    out << EVENT_STORE_LOG[4].substr(20) << "\r\n" << EVENT_STORE_LOG[5] << "\r\n" << EVENT_STORE_LOG[6] << "\r\n"
+        << std::flush;
+    index = LogIndex::load_or_build(path.string(), 2);
+    ASSERT_TRUE(index);
+    EXPECT_EQ(index->last_line_num(), 7);
+    ASSERT_EQ(index->marks().size(), 4U);
+    EXPECT_EQ(index->marks()[3].kind, LogIndex::Kind::EXIT_COMBAT);
+    const auto saved = LogIndex::load(sidecar);
+    ASSERT_TRUE(saved);
+    EXPECT_EQ(saved->marks().size(), 4U);
+    EXPECT_EQ(saved->last_line_offset(), index->last_line_offset());
+
+    EXPECT_EQ(index->combat_count(), 1U);
+    const auto combat = index->find_combat(1);
+    ASSERT_TRUE(combat);
+    EXPECT_EQ(combat->enter.line_num, 2);
+    ASSERT_TRUE(combat->exit);
+    EXPECT_EQ(combat->exit->line_num, 6);
+    EXPECT_FALSE(index->find_combat(2));
+
+    // Parsing from the mark found for line 5's time gives the same timestamps as parsing from the top.
+    LogParser lp;
+    Timestamps from_top {std::string("2025-05-15_19_00_00_000000")};
+    std::vector<Timestamps::timestamp> expected;
+    for (std::size_t i = 0; i < EVENT_STORE_LOG.size(); i++) {
+        expected.push_back(lp.parse_line_view(EVENT_STORE_LOG[i], static_cast<int>(i + 1), from_top)->ts);
+    }
+    EXPECT_FALSE(index->seek(Timestamps::timestamp_to_ms_past_epoch(expected[0]) - 1));
+    const auto mark = index->seek(Timestamps::timestamp_to_ms_past_epoch(expected[4]));
+    ASSERT_TRUE(mark);
+    EXPECT_EQ(mark->line_num, 4);
+
+    auto src = LogFileSource::open(path.string());
+    ASSERT_TRUE(src);
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    LogIndex::resume_at(*mark, ts);
+    for (const auto& ll : LogFileSource::lines(src->contents().substr(mark->offset), mark->line_num, mark->offset)) {
+        if (!ll.text.empty()) {
+            const auto entry = lp.parse_line_view(ll.text, ll.line_num, ts);
+            ASSERT_TRUE(entry) << ll.text;
+            EXPECT_EQ(entry->ts, expected[static_cast<std::size_t>(ll.line_num - 1)]);
+        }
+    }
+
+    // A different log under the same name is indexed from scratch.
+    out.close();
+    std::ofstream {path, std::ios::binary} << EVENT_STORE_LOG[1] << "\r\n";
+    index = LogIndex::load_or_build(path.string(), 2);
+    ASSERT_TRUE(index);
+    EXPECT_EQ(index->last_line_num(), 1);
+    EXPECT_EQ(index->marks().size(), 1U);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(sidecar);
+}
+
+TEST(LogParser, parse_line_filtered) {
+    auto lines = EVENT_STORE_LOG;
+    lines.emplace_back("[19:03:14.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [] []");
+    lines.emplace_back("[19:03:xx.000] [] [] [] [Event {836045448945472}: Damage {836045448945501}]");
+    lines.emplace_back("[19:03:16.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [=] [Shock {807663142748160}] [ApplyEffect {836045448945477}: Damage {836045448945501}] (1063* ~1062 kinetic {836045448940873}");
+    // Past midnight, and dropped; the kept line after it is on the next day.
+    lines.emplace_back("[00:00:01.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [] [] [Event {836045448945472}: EnterCombat {836045448945489}]");
+    lines.emplace_back(EVENT_STORE_LOG[2]);
+
+    const ActionFilter damage {.ids = {836045448945501}};
+    LogParser filtered;
+    LogParser full;
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    Timestamps full_ts {std::string("2025-05-15_19_00_00_000000")};
+    std::vector<std::size_t> kept;
+    for (std::size_t i = 0; i < lines.size(); i++) {
+        const auto line_num = static_cast<int>(i + 1);
+        const auto entry = filtered.parse_line_filtered(lines[i], line_num, ts, damage);
+        const auto expected = full.parse_line_view(lines[i], line_num, full_ts);
+        if (entry) {
+            kept.push_back(i);
+            ASSERT_TRUE(expected);
+            EXPECT_EQ(entry->ts, expected->ts);
+            EXPECT_EQ(entry->action.noun.name, "Damage");
+            ASSERT_EQ(entry->value.has_value(), expected->value.has_value());
+            if (entry->value) {
+                EXPECT_EQ(std::get<LogParserTypes::RealValueView>(*entry->value).base_value,
+                          std::get<LogParserTypes::RealValueView>(*expected->value).base_value);
+            }
+        }
+    }
+    // Line 10's value field is malformed; as with parse_line_view(), that's ignored.
+    EXPECT_EQ(kept, (std::vector<std::size_t> {2, 3, 4, 6, 9, 11}));
+    EXPECT_EQ(ts.current_log_timestamp(), full_ts.current_log_timestamp());
+
+    const auto& stats = filtered.filter_stats();
+    EXPECT_EQ(stats.lines, lines.size());
+    EXPECT_EQ(stats.bad_timestamp, 1U);
+    EXPECT_EQ(stats.no_action, 1U);
+    EXPECT_EQ(stats.rejected, 4U);
+    EXPECT_EQ(stats.parse_failed, 0U);
+    EXPECT_EQ(stats.parsed, 6U);
+
+    filtered.reset_filter_stats();
+    EXPECT_EQ(filtered.filter_stats().lines, 0U);
+    EXPECT_FALSE(filtered.parse_line_filtered(lines[0], 1, ts, ActionFilter {}));
+    EXPECT_EQ(filtered.filter_stats().rejected, 1U);
+}
+
+TEST(LogParser, parse_line_projected) {
+    namespace lpt = LogParserTypes;
+    LogParser lp;
+    for (std::size_t i = 0; i < EVENT_STORE_LOG.size(); i++) {
+        const auto& line = EVENT_STORE_LOG[i];
+        const auto line_num = static_cast<int>(i + 1);
+        Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+        const auto full = lp.parse_line_view(line, line_num, ts);
+        ASSERT_TRUE(full);
+
+        const auto timeline = lp.parse_line_projected<ParseFields::TIMELINE>(line, line_num, ts);
+        ASSERT_TRUE(timeline) << line;
+        EXPECT_EQ(timeline->ts, full->ts);
+        EXPECT_EQ(timeline->action.noun.id, full->action.noun.id);
+        EXPECT_FALSE(timeline->source || timeline->target || timeline->ability || timeline->value || timeline->threat);
+
+        const auto damage = lp.parse_line_projected<ParseFields::DAMAGE>(line, line_num, ts);
+        ASSERT_TRUE(damage) << line;
+        ASSERT_EQ(damage->source.has_value(), full->source.has_value());
+        EXPECT_EQ(damage->source->actor.index(), full->source->actor.index());
+        EXPECT_EQ(damage->source->loc, lpt::Location());
+        EXPECT_FALSE(damage->target || damage->threat);
+        EXPECT_EQ(damage->ability.has_value(), full->ability.has_value());
+        ASSERT_EQ(damage->value.has_value(), full->value.has_value());
+        if (const auto* rv = damage->value ? std::get_if<lpt::RealValueView>(&*damage->value) : nullptr) {
+            EXPECT_EQ(rv->base_value, std::get<lpt::RealValueView>(*full->value).base_value);
+        }
+
+        const auto movement = lp.parse_line_projected<ParseFields::MOVEMENT>(line, line_num, ts);
+        ASSERT_TRUE(movement) << line;
+        EXPECT_EQ(movement->source->loc, full->source->loc);
+        EXPECT_EQ(movement->source->health, lpt::Health());
+        ASSERT_EQ(movement->target.has_value(), full->target.has_value());
+        if (movement->target) {
+            EXPECT_EQ(movement->target->loc, full->target->loc);
+        }
+        EXPECT_FALSE(movement->ability || movement->value || movement->threat);
+    }
+
+    // A location that isn't decoded isn't checked, but the line's structure still is.
+    Timestamps ts {std::string("2025-05-15_19_00_00_000000")};
+    const std::string bad_location {"[19:03:10.000] [@Mystic Scriabin#689778209418226|(here)|(1/40729)] [] [] [Event {836045448945472}: EnterCombat {836045448945489}]"};
+    EXPECT_FALSE(lp.parse_line_view(bad_location, 1, ts));
+    EXPECT_TRUE(lp.parse_line_projected<ParseFields::DAMAGE>(bad_location, 1, ts));
+    const std::string unbalanced {"[19:03:10.000] [@Mystic Scriabin#689778209418226|(-0.18,24.30,4.02,179.59)|(1/40729)] [] [] [Event {836045448945472}: EnterCombat {836045448945489}"};
+    EXPECT_FALSE(lp.parse_line_projected<ParseFields::TIMELINE>(unbalanced, 1, ts));
+    EXPECT_FALSE(lp.parse_line_projected<ParseFields::DAMAGE>(unbalanced, 1, ts));
+}
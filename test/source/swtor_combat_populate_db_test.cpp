@@ -1,8 +1,11 @@
 // -*- fil-column: 120; indent-tabs-mode: nil -*-
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 #include <log_parser_types.hpp>
 
 #pragma GCC diagnostic push
@@ -25,6 +28,14 @@ class TestDbPopulator : public DbPopulator {
         : DbPopulator(conn_str, logfile_filename, logfile_ts, existing_logfile_behavior) {
     }
 
+    TestDbPopulator(const DbPopulator::ConnStr& conn_str,
+                    const DbPopulator::LogfileFilename& logfile_filename,
+                    Timestamps::timestamp logfile_ts,
+                    DbPopulator::ExistingLogfileBehavior existing_logfile_behavior,
+                    const DbPopulator::Options& options)
+        : DbPopulator(conn_str, logfile_filename, logfile_ts, existing_logfile_behavior, options) {
+    }
+
     auto mark_fully_parsed(void) -> void {
         DbPopulator::mark_fully_parsed();
     }
@@ -37,6 +48,10 @@ class TestDbPopulator : public DbPopulator {
         return DbPopulator::add_actor(actor);
     }
 
+    auto add_action(const LogParserTypes::Action& action) -> int {
+        return DbPopulator::add_action(action);
+    }
+
     auto add_npc_actor(LogParserTypes::NpcActor npc_actor) -> int {
         return DbPopulator::add_npc_actor(npc_actor);
     }
@@ -102,6 +117,16 @@ class TestDbPopulator : public DbPopulator {
     static constexpr int UNKNOWN_CLASS_ROW_ID {1};
 };
 
+// DbPopulator gives each logfile its own Combat, Event, and Combat_Summary partitions, which deleting the Log_File row
+// leaves behind. Drop them, attached or not, before the Combat ones they reference.
+auto drop_logfile_partitions(pqxx::transaction_base& tx) -> void {
+    for (auto [part] : tx.query<std::string>("SELECT relname FROM pg_class WHERE relkind = 'r'"
+                                             " AND relname ~ '^(event|combat_summary|combat)_lf_[0-9]+$'"
+                                             " AND pg_table_is_visible(oid) ORDER BY relname LIKE 'combat\\_lf\\_%'")) {
+        tx.exec("DROP TABLE " + tx.conn().quote_name(part));
+    }
+}
+
 class DbPopTestFix
     : public ::testing::Test {
   public:
@@ -125,12 +150,14 @@ class DbPopTestFix
     void clear_names() {
         // Ordering must be most dependent to least dependent to satisfy FK constraints.
         m_tx->exec("DELETE FROM Event");
+        m_tx->exec("DELETE FROM Combat_Summary");
         m_tx->exec("DELETE FROM Combat");
         m_tx->exec("DELETE FROM Area WHERE id > 1");
         m_tx->exec("DELETE FROM Action");
         m_tx->exec("DELETE FROM Actor ");
         m_tx->exec("DELETE FROM Advanced_Class WHERE id > 10");
         m_tx->exec("DELETE FROM Name           WHERE id > 10");
+        drop_logfile_partitions(*m_tx);
         m_tx->exec("DELETE FROM Log_File");
     }
 
@@ -155,7 +182,9 @@ TEST(DbPopulator, Construction_EmptyDB_1) {
     pqxx::connection conn {DbPopTestFix::m_conn_str};
     pqxx::nontransaction tx {conn};
     tx.exec("DELETE FROM Event");
+    tx.exec("DELETE FROM Combat_Summary");
     tx.exec("DELETE FROM Combat");
+    drop_logfile_partitions(tx);
     tx.exec("DELETE FROM Log_File");
     conn.close();
 
@@ -168,7 +197,7 @@ TEST(DbPopulator, Construction_EmptyDB_1) {
                     DbPopulator::LogfileFilename(DbPopTestFix::m_lfn),
                     now,
                     DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING));
-    EXPECT_EQ(dbp->db_version(), "1");
+    EXPECT_EQ(dbp->db_version(), "6");
     auto logfile_id = dbp->m_tx->query_value<int>("SELECT id FROM Log_File WHERE filename = $1",
                                                   pqxx::params(DbPopTestFix::m_lfn));
     EXPECT_EQ(logfile_id, dbp->get_logfile_id());
@@ -190,7 +219,9 @@ TEST(DbPopulator, Construction_EmptyDB_2) {
     pqxx::connection conn {DbPopTestFix::m_conn_str};
     pqxx::nontransaction tx {conn};
     tx.exec("DELETE FROM Event");
+    tx.exec("DELETE FROM Combat_Summary");
     tx.exec("DELETE FROM Combat");
+    drop_logfile_partitions(tx);
     tx.exec("DELETE FROM Log_File");
     conn.close();
 
@@ -203,7 +234,7 @@ TEST(DbPopulator, Construction_EmptyDB_2) {
                     DbPopulator::LogfileFilename(DbPopTestFix::m_lfn),
                     now,
                     DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING_UNFINISHED));
-    EXPECT_EQ(dbp->db_version(), "1");
+    EXPECT_EQ(dbp->db_version(), "6");
     auto logfile_id = dbp->m_tx->query_value<int>("SELECT id FROM Log_File WHERE filename = $1",
                                                   pqxx::params(DbPopTestFix::m_lfn));
     EXPECT_EQ(logfile_id, dbp->get_logfile_id());
@@ -231,7 +262,9 @@ TEST(DbPopulator, Construction_LogfileExists1) {
         pqxx::connection conn {DbPopTestFix::m_conn_str};
         pqxx::nontransaction tx {conn};
         tx.exec("DELETE FROM Event");
+        tx.exec("DELETE FROM Combat_Summary");
         tx.exec("DELETE FROM Combat");
+        drop_logfile_partitions(tx);
         tx.exec("DELETE FROM Log_File");
 
         // Populate with a log_file row.
@@ -279,7 +312,9 @@ TEST(DbPopulator, Construction_LogfileExists2) {
         pqxx::connection conn {DbPopTestFix::m_conn_str};
         pqxx::nontransaction tx {conn};
         tx.exec("DELETE FROM Event");
+        tx.exec("DELETE FROM Combat_Summary");
         tx.exec("DELETE FROM Combat");
+        drop_logfile_partitions(tx);
         tx.exec("DELETE FROM Log_File");
 
         // Populate with a log_file row.
@@ -327,7 +362,9 @@ TEST(DbPopulator, Construction_LogfileExists3) {
         pqxx::connection conn {DbPopTestFix::m_conn_str};
         pqxx::nontransaction tx {conn};
         tx.exec("DELETE FROM Event");
+        tx.exec("DELETE FROM Combat_Summary");
         tx.exec("DELETE FROM Combat");
+        drop_logfile_partitions(tx);
         tx.exec("DELETE FROM Log_File");
 
         // Populate with a log_file row.
@@ -375,7 +412,9 @@ TEST(DbPopulator, Construction_LogfileExists4) {
         pqxx::connection conn {DbPopTestFix::m_conn_str};
         pqxx::nontransaction tx {conn};
         tx.exec("DELETE FROM Event");
+        tx.exec("DELETE FROM Combat_Summary");
         tx.exec("DELETE FROM Combat");
+        drop_logfile_partitions(tx);
         tx.exec("DELETE FROM Log_File");
 
         // Populate with a log_file row.
@@ -426,8 +465,10 @@ TEST(DbPopulator, Construction_LogfileExists5) {
         pqxx::connection conn {DbPopTestFix::m_conn_str};
         pqxx::nontransaction tx {conn};
         tx.exec("DELETE FROM Event");
+        tx.exec("DELETE FROM Combat_Summary");
         tx.exec("DELETE FROM Combat");
         tx.exec("DELETE FROM Action");
+        drop_logfile_partitions(tx);
         tx.exec("DELETE FROM Log_File");
         tx.exec("DELETE FROM Name WHERE id > 10");
 
@@ -1515,6 +1556,471 @@ TEST_F(DbPopTestFix, add_event_1) {
     EXPECT_EQ(row[26].as<int>(), m_dbp->m_logfile_id);
 }
 
+TEST_F(DbPopTestFix, add_event_bulk) {
+    // Replace the fixture's populator with one that streams Event rows with COPY two at a time.
+    DbPopulator::Options options;
+    options.bulk_load_rows = 2;
+    m_dbp.reset();
+    ASSERT_NO_THROW(m_dbp = std::make_unique<TestDbPopulator>(
+                                DbPopulator::ConnStr(m_conn_str),
+                                DbPopulator::LogfileFilename(m_lfn),
+                                std::chrono::system_clock::now(),
+                                DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+                                options));
+
+    LogParserTypes::SourceOrTarget src = {.actor = spc, .loc = sloc, .health = shealth};
+    LogParserTypes::ParsedLogLine pll = {
+        .ts = std::chrono::system_clock::now(),
+        .source = src,
+        .target = {},
+        .ability = LogParserTypes::Ability {.name = "Strike", .id = 100},
+        .action = action,
+        .value = rv,
+        .threat = 50.0
+    };
+
+    auto num_events = [this] () {
+        return m_tx->query_value<int>("SELECT COUNT(*) FROM Event WHERE logfile = $1",
+                                      pqxx::params(m_dbp->m_logfile_id));
+    };
+
+    // Event row IDs aren't known until the rows are flushed.
+    EXPECT_EQ(m_dbp->populate_from_entry(pll), 0);
+    EXPECT_EQ(num_events(), 0);
+    EXPECT_EQ(m_dbp->populate_from_entry(pll), 0);
+    EXPECT_EQ(num_events(), 2);
+    EXPECT_EQ(m_dbp->populate_from_entry(pll), 0);
+    EXPECT_EQ(num_events(), 2);
+
+    // Marking the logfile as parsed flushes the remainder.
+    m_dbp->mark_fully_parsed();
+    EXPECT_EQ(num_events(), 3);
+
+    auto row = m_tx->exec("SELECT source_location, source_health, target, value_base, threat_val FROM Event"
+                          " WHERE logfile = $1 LIMIT 1", pqxx::params(m_dbp->m_logfile_id)).one_row();
+    EXPECT_EQ(row[0].as<LogParserTypes::Location>(), sloc);
+    EXPECT_EQ(row[1].as<LogParserTypes::Health>(), shealth);
+    EXPECT_TRUE(row[2].is_null());
+    EXPECT_EQ(row[3].as<uint64_t>(), rv.base_value);
+    EXPECT_EQ(row[4].as<int>(), 50);
+}
+
+TEST_F(DbPopTestFix, reserved_event_ids) {
+    // Bulk load two rows at a time, with IDs reserved three at a time so that a block runs out mid-buffer.
+    DbPopulator::Options options;
+    options.bulk_load_rows = 2;
+    options.event_id_block = 3;
+    m_dbp.reset();
+    ASSERT_NO_THROW(m_dbp = std::make_unique<TestDbPopulator>(
+                                DbPopulator::ConnStr(m_conn_str),
+                                DbPopulator::LogfileFilename(m_lfn),
+                                std::chrono::system_clock::now(),
+                                DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+                                options));
+
+    LogParserTypes::SourceOrTarget src = {.actor = spc, .loc = sloc, .health = shealth};
+    LogParserTypes::ParsedLogLine pll = {.ts = std::chrono::system_clock::now(), .source = src, .target = {},
+                                         .ability = LogParserTypes::Ability {.name = "Strike", .id = 100},
+                                         .action = action, .value = rv, .threat = 50.0};
+
+    // The IDs are known before the rows are written.
+    std::vector<int64_t> ids;
+    for (int i = 0; i < 5; i++) {
+        ids.push_back(m_dbp->populate_from_entry(pll));
+        EXPECT_GT(ids.back(), 0);
+    }
+    EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+    m_dbp->mark_fully_parsed();
+
+    std::vector<int64_t> written;
+    for (auto [id] : m_tx->query<int64_t>("SELECT id FROM Event WHERE logfile = $1 ORDER BY id",
+                                          pqxx::params(m_dbp->m_logfile_id))) {
+        written.push_back(id);
+    }
+    EXPECT_EQ(written, ids);
+}
+
+TEST_F(DbPopTestFix, add_events_pipelined) {
+    LogParserTypes::NpcActor npc {.name_id = {.name = "Droid", .id = 700}, .instance = 7};
+    LogParserTypes::SourceOrTarget npc_src = {.actor = npc, .loc = sloc, .health = shealth};
+    LogParserTypes::SourceOrTarget comp_src = {.actor = comp_actor, .loc = sloc, .health = shealth};
+    LogParserTypes::SourceOrTarget tgt = {.actor = tpc, .loc = tloc, .health = thealth};
+    LogParserTypes::Action heal (LogParserTypes::Action::Verb({.name = "ApplyEffect", .id = 200}),
+                                 LogParserTypes::Action::Noun({.name = "Heal", .id = 202}),
+                                 LogParserTypes::Action::Detail(std::optional<LogParserTypes::NameId>({.name = "Shield", .id = 203})));
+
+    // The target PC is already cached, so only its neighbours need prefetching.
+    auto tpc_row_id = m_dbp->add_pc_actor(tpc);
+
+    std::vector<LogParserTypes::ParsedLogLine> window {
+        {.ts = std::chrono::system_clock::now(), .source = npc_src, .target = tgt,
+         .ability = LogParserTypes::Ability {.name = "Strike", .id = 100}, .action = action, .value = rv},
+        {.ts = std::chrono::system_clock::now(), .source = comp_src, .target = tgt,
+         .ability = LogParserTypes::Ability {.name = "Mend", .id = 101}, .action = heal},
+        {.ts = std::chrono::system_clock::now(), .source = npc_src, .target = tgt,
+         .ability = LogParserTypes::Ability {.name = "Strike", .id = 100}, .action = action, .value = rv},
+    };
+    m_dbp->populate_from_entries(window);
+
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Event WHERE logfile = $1",
+                                     pqxx::params(m_dbp->m_logfile_id)), 3);
+
+    // Each dimension row was added once, and is the same row the add_*() methods resolve to.
+    auto sources = m_tx->exec("SELECT DISTINCT source FROM Event WHERE logfile = $1 ORDER BY source",
+                              pqxx::params(m_dbp->m_logfile_id));
+    ASSERT_EQ(sources.size(), 2);
+    auto npc_row_id = m_dbp->add_npc_actor(npc);
+    auto comp_row_id = m_dbp->add_companion_actor(comp_actor);
+    EXPECT_EQ(std::min(npc_row_id, comp_row_id), sources[0][0].as<int>());
+    EXPECT_EQ(std::max(npc_row_id, comp_row_id), sources[1][0].as<int>());
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(DISTINCT target) FROM Event WHERE logfile = $1 AND target = $2",
+                                     pqxx::params(m_dbp->m_logfile_id, tpc_row_id)), 1);
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Actor AS a JOIN Name AS n ON a.name = n.id"
+                                     " WHERE n.name_id = $1", pqxx::params(npc.name_id.id)), 1);
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Action AS a JOIN Name AS n ON a.noun = n.id"
+                                     " WHERE n.name_id = $1", pqxx::params(202)), 1);
+    EXPECT_EQ(m_tx->query_value<std::string>("SELECT name FROM Name WHERE name_id = $1", pqxx::params(203)), "Shield");
+}
+
+TEST_F(DbPopTestFix, warm_start) {
+    LogParserTypes::NpcActor npc {.name_id = {.name = "Droid", .id = 700}, .instance = 7};
+    auto name_row_id = m_dbp->add_name_id(actor_name);
+    auto npc_row_id = m_dbp->add_npc_actor(npc);
+    auto pc_row_id = m_dbp->add_pc_actor(tpc);
+
+    // A new populator preloads what the previous one added.
+    DbPopulator::Options options;
+    options.warm_start = true;
+    m_dbp.reset();
+    ASSERT_NO_THROW(m_dbp = std::make_unique<TestDbPopulator>(
+                                DbPopulator::ConnStr(m_conn_str),
+                                DbPopulator::LogfileFilename(m_lfn),
+                                std::chrono::system_clock::now(),
+                                DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+                                options));
+
+    auto lookups_saved = [this] () { return m_dbp->warm_start_stats().lookups_saved; };
+    EXPECT_GE(m_dbp->warm_start_stats().rows_loaded, 3);
+    EXPECT_EQ(lookups_saved(), 0);
+    ASSERT_TRUE(m_dbp->m_pcs.contains(tpc.id));
+    EXPECT_EQ(m_dbp->m_pcs[tpc.id].row_id, pc_row_id);
+
+    EXPECT_EQ(m_dbp->add_name_id(actor_name), name_row_id);
+    EXPECT_EQ(lookups_saved(), 1);
+    EXPECT_EQ(m_dbp->add_npc_actor(npc), npc_row_id);
+    EXPECT_EQ(lookups_saved(), 2);
+
+    // Only the first lookup of a preloaded key is saved.
+    EXPECT_EQ(m_dbp->add_name_id(actor_name), name_row_id);
+    EXPECT_EQ(lookups_saved(), 2);
+}
+
+TEST_F(DbPopTestFix, concurrent_populators) {
+    // Populators on their own connections race to add the same dimension rows. Each must resolve every key to the one
+    // row that wins, and no key may end up with two rows.
+    constexpr int NUM_POPULATORS {4};
+    constexpr int NUM_KEYS {50};
+    std::vector<std::vector<int>> row_ids(NUM_POPULATORS);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < NUM_POPULATORS; p++) {
+        threads.emplace_back([&row_ids, p] {
+            TestDbPopulator dbp {DbPopulator::ConnStr(m_conn_str),
+                                 DbPopulator::LogfileFilename("concurrent_" + std::to_string(p) + ".txt"),
+                                 std::chrono::system_clock::now(),
+                                 DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING};
+            for (uint64_t k = 0; k < static_cast<uint64_t>(NUM_KEYS); k++) {
+                LogParserTypes::NpcActor npc {.name_id = {.name = "NPC", .id = 9000 + k}, .instance = k};
+                LogParserTypes::PcActor pc {.name = "PC", .id = 8000 + k};
+                LogParserTypes::Action act (LogParserTypes::Action::Verb({.name = "ApplyEffect", .id = 200}),
+                                            LogParserTypes::Action::Noun({.name = "Noun", .id = 7000 + k}),
+                                            LogParserTypes::Action::Detail(std::optional<LogParserTypes::NameId>()));
+                row_ids[p].push_back(dbp.add_npc_actor(npc));
+                row_ids[p].push_back(dbp.add_pc_actor(pc));
+                row_ids[p].push_back(dbp.add_action(act));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int p = 1; p < NUM_POPULATORS; p++) {
+        EXPECT_EQ(row_ids[p], row_ids[0]);
+    }
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Name WHERE name_id BETWEEN 7000 AND 9999"), 3 * NUM_KEYS);
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Actor"), 2 * NUM_KEYS);
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Action"), NUM_KEYS);
+}
+
+TEST_F(DbPopTestFix, cache_stats) {
+    auto name_stats = [this] () { return m_dbp->cache_stats().front(); };
+    ASSERT_EQ(name_stats().name, "Name");
+
+    LogParserTypes::NameId name_id {.name = "a name", .id = 123};
+    auto row_id = m_dbp->add_name_id(name_id);
+    EXPECT_EQ(name_stats().misses, 1);
+    EXPECT_EQ(name_stats().inserts, 1);
+    EXPECT_EQ(name_stats().hits, 0);
+
+    EXPECT_EQ(m_dbp->add_name_id(name_id), row_id);
+    EXPECT_EQ(name_stats().misses, 1);
+    EXPECT_EQ(name_stats().inserts, 1);
+    EXPECT_EQ(name_stats().hits, 1);
+}
+
+TEST_F(DbPopTestFix, resume_existing) {
+    m_dbp->record_area_entered(DbPopulator::AreaName({.name = "Coruscant", .id = 100}));
+    m_dbp->add_pc_actor(actor_name);
+    const auto pc_row_id = m_dbp->add_class_to_pc_actor(actor_name, pc_class);
+    const auto now = std::chrono::system_clock::now();
+    m_dbp->record_enter_combat(now);
+
+    LogParserTypes::SourceOrTarget src = {.actor = spc, .loc = sloc, .health = shealth};
+    LogParserTypes::ParsedLogLine pll = {.ts = now, .source = src, .target = {},
+                                         .ability = LogParserTypes::Ability {.name = "Strike", .id = 100},
+                                         .action = action, .value = rv, .threat = 50.0};
+    m_dbp->populate_from_entry(pll);
+    m_dbp->populate_from_entry(pll);
+    m_dbp->checkpoint({.offset = 1234, .line_num = 2, .last_ts = now});
+
+    // Written after the checkpoint, as if the run had died before the next one.
+    m_dbp->populate_from_entry(pll);
+    m_dbp->record_exit_combat(now);
+
+    const auto logfile_id = m_dbp->get_logfile_id();
+    const auto area_id = m_dbp->get_area_id();
+    const auto combat_id = m_dbp->get_combat_id();
+    m_dbp.reset();
+
+    ASSERT_NO_THROW(m_dbp = std::make_unique<TestDbPopulator>(
+                                DbPopulator::ConnStr(m_conn_str),
+                                DbPopulator::LogfileFilename(m_lfn),
+                                now,
+                                DbPopulator::ExistingLogfileBehavior::RESUME_EXISTING));
+    EXPECT_EQ(m_dbp->get_logfile_id(), logfile_id);
+    auto rp = m_dbp->resume_point();
+    ASSERT_TRUE(rp);
+    EXPECT_EQ(rp->offset, 1234U);
+    EXPECT_EQ(rp->line_num, 2);
+    EXPECT_EQ(rp->last_ts, std::chrono::floor<std::chrono::milliseconds>(now));
+
+    // The current area, combat, and PC class are as they were at the checkpoint.
+    EXPECT_EQ(m_dbp->get_area_id(), area_id);
+    EXPECT_EQ(m_dbp->get_combat_id(), combat_id);
+    ASSERT_TRUE(m_dbp->m_pcs.peek(actor_name.id));
+    EXPECT_EQ(m_dbp->m_pcs.peek(actor_name.id)->row_id, pc_row_id);
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Event WHERE logfile = $1", pqxx::params(logfile_id)), 2);
+    EXPECT_TRUE(m_tx->exec("SELECT ts_end FROM Combat WHERE id = $1", pqxx::params(*combat_id)).one_row()[0].is_null());
+
+    // A logfile that isn't in the database yet starts from the beginning.
+    TestDbPopulator fresh {DbPopulator::ConnStr(m_conn_str), DbPopulator::LogfileFilename("never_seen.txt"), now,
+                           DbPopulator::ExistingLogfileBehavior::RESUME_EXISTING};
+    EXPECT_FALSE(fresh.resume_point());
+}
+
+TEST_F(DbPopTestFix, replace_logfile_partitions) {
+    auto partition_exists = [this] (const std::string& table, int logfile_id) {
+        return m_tx->query_value<bool>("SELECT to_regclass($1) IS NOT NULL",
+                                       pqxx::params(table + "_lf_" + std::to_string(logfile_id)));
+    };
+
+    LogParserTypes::SourceOrTarget src = {.actor = spc, .loc = sloc, .health = shealth};
+    LogParserTypes::ParsedLogLine pll = {.ts = std::chrono::system_clock::now(), .source = src, .target = {},
+                                         .ability = LogParserTypes::Ability {.name = "Strike", .id = 100},
+                                         .action = action, .value = rv, .threat = 50.0};
+    m_dbp->record_area_entered(DbPopulator::AreaName({.name = "Coruscant", .id = 100}));
+    m_dbp->record_enter_combat(pll.ts);
+    m_dbp->populate_from_entry(pll);
+    const auto old_id = m_dbp->get_logfile_id();
+    EXPECT_TRUE(partition_exists("event", old_id));
+    EXPECT_TRUE(partition_exists("combat", old_id));
+
+    // Replacing the logfile drops its partitions, rows and all, and attaches new ones.
+    m_dbp.reset();
+    init_pop();
+    const auto new_id = m_dbp->get_logfile_id();
+    EXPECT_NE(new_id, old_id);
+    EXPECT_FALSE(partition_exists("event", old_id));
+    EXPECT_FALSE(partition_exists("combat", old_id));
+    EXPECT_TRUE(partition_exists("event", new_id));
+    EXPECT_TRUE(partition_exists("combat", new_id));
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM Event WHERE logfile = $1", pqxx::params(old_id)), 0);
+
+    // New rows land in the new partition.
+    m_dbp->populate_from_entry(pll);
+    EXPECT_EQ(m_tx->query_value<int>("SELECT COUNT(*) FROM event_lf_" + std::to_string(new_id)), 1);
+}
+
+TEST_F(DbPopTestFix, commit_policy) {
+    // Commit every two events, and when a combat ends.
+    DbPopulator::Options options;
+    options.commit_every_events = 2;
+    options.commit_at_combat_end = true;
+    m_dbp.reset();
+    ASSERT_NO_THROW(m_dbp = std::make_unique<TestDbPopulator>(
+                                DbPopulator::ConnStr(m_conn_str),
+                                DbPopulator::LogfileFilename(m_lfn),
+                                std::chrono::system_clock::now(),
+                                DbPopulator::ExistingLogfileBehavior::DELETE_ON_EXISTING,
+                                options));
+
+    LogParserTypes::SourceOrTarget src = {.actor = spc, .loc = sloc, .health = shealth};
+    LogParserTypes::ParsedLogLine pll = {.ts = std::chrono::system_clock::now(), .source = src, .target = {},
+                                         .ability = LogParserTypes::Ability {.name = "Strike", .id = 100},
+                                         .action = action, .value = rv, .threat = 50.0};
+    LogParserTypes::ParsedLogLine exit_combat = pll;
+    exit_combat.action = LogParserTypes::Action(
+        LogParserTypes::Action::Verb({.name = "Event", .id = 836045448945472}),
+        LogParserTypes::Action::Noun({.name = "ExitCombat", .id = LogParserTypes::EXIT_COMBAT_ID}),
+        LogParserTypes::Action::Detail(std::optional<LogParserTypes::NameId>()));
+
+    // The fixture's own connection only sees committed rows.
+    auto num_events = [this] () {
+        return m_tx->query_value<int>("SELECT COUNT(*) FROM Event AS e JOIN Log_File AS lf ON e.logfile = lf.id"
+                                      " WHERE lf.filename = $1", pqxx::params(m_lfn));
+    };
+
+    m_dbp->populate_from_entry(pll);
+    EXPECT_EQ(num_events(), 0);
+    m_dbp->populate_from_entry(pll);
+    EXPECT_EQ(num_events(), 2);
+
+    m_dbp->record_area_entered(DbPopulator::AreaName({.name = "Coruscant", .id = 100}));
+    m_dbp->record_enter_combat(pll.ts);
+    m_dbp->populate_from_entry(exit_combat);
+    EXPECT_EQ(num_events(), 3);
+    EXPECT_FALSE(m_dbp->in_combat());
+
+    // The final, partial batch is committed along with fully_parsed.
+    m_dbp->populate_from_entry(pll);
+    EXPECT_EQ(num_events(), 3);
+    m_dbp->mark_fully_parsed();
+    EXPECT_EQ(num_events(), 4);
+    EXPECT_TRUE(m_tx->query_value<bool>("SELECT fully_parsed FROM Log_File WHERE filename = $1",
+                                        pqxx::params(m_lfn)));
+
+    const auto stats = m_dbp->commit_stats();
+    EXPECT_EQ(stats.commits, 3);
+    EXPECT_EQ(stats.events, 4);
+}
+
+TEST_F(DbPopTestFix, combat_summary) {
+    LogParserTypes::SourceOrTarget src = {.actor = spc, .loc = sloc, .health = shealth};
+    LogParserTypes::ParsedLogLine pll = {.ts = std::chrono::system_clock::now(), .source = src, .target = {},
+                                         .ability = LogParserTypes::Ability {.name = "Strike", .id = 100},
+                                         .action = action, .value = rv, .threat = 50.0};
+    auto summary = [this] () {
+        return m_tx->query01<int64_t, int64_t, int, int, int64_t, int64_t>(
+            "SELECT total, effective, hits, crits, max_hit, threat FROM Combat_Summary WHERE logfile = $1",
+            pqxx::params(m_dbp->get_logfile_id()));
+    };
+
+    // Outside of a combat, events aren't counted.
+    m_dbp->populate_from_entry(pll);
+    m_dbp->record_area_entered(DbPopulator::AreaName({.name = "Coruscant", .id = 100}));
+    m_dbp->record_enter_combat(pll.ts);
+    m_dbp->populate_from_entry(pll);
+    m_dbp->populate_from_entry(pll);
+    m_dbp->checkpoint({.offset = 100, .line_num = 3, .last_ts = pll.ts});
+    EXPECT_FALSE(summary());
+
+    // Resuming recounts the totals of the combat in progress from the Event rows kept at the checkpoint.
+    m_dbp->populate_from_entry(pll);
+    m_dbp.reset();
+    ASSERT_NO_THROW(m_dbp = std::make_unique<TestDbPopulator>(
+                                DbPopulator::ConnStr(m_conn_str),
+                                DbPopulator::LogfileFilename(m_lfn),
+                                pll.ts,
+                                DbPopulator::ExistingLogfileBehavior::RESUME_EXISTING));
+    m_dbp->populate_from_entry(pll);
+    m_dbp->record_exit_combat(pll.ts);
+
+    const auto row = summary();
+    ASSERT_TRUE(row);
+    const auto [total, effective, hits, crits, max_hit, threat] = *row;
+    EXPECT_EQ(total, 3000);
+    EXPECT_EQ(effective, 2997);
+    EXPECT_EQ(hits, 3);
+    EXPECT_EQ(crits, 3);
+    EXPECT_EQ(max_hit, 1000);
+    EXPECT_EQ(threat, 150);
+}
+
+TEST(LocalDbCache, read_through_write_through) {
+    LocalDbCache<uint64_t, int> cache("test");
+    int lookups = 0;
+    int inserts = 0;
+    auto lookup = [&] () -> std::optional<int> { ++lookups; return {}; };
+    auto insert = [&] () { ++inserts; return 42; };
+
+    EXPECT_EQ(cache.get(7, lookup, insert), 42);
+    EXPECT_EQ(cache.get(7, lookup, insert), 42);
+    EXPECT_EQ(lookups, 1);
+    EXPECT_EQ(inserts, 1);
+
+    // Found in the "database", so nothing is inserted.
+    EXPECT_EQ(cache.get(8, [] { return std::optional<int>(9); }, insert), 9);
+    EXPECT_EQ(inserts, 1);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.inserts, 1);
+    EXPECT_EQ(stats.size, 2);
+}
+
+TEST(LocalDbCache, grows) {
+    LocalDbCache<std::tuple<uint64_t, uint64_t>, int> cache("test");
+    for (int i = 0; i < 10000; ++i) {
+        cache.put({i, i * 3}, i);
+    }
+    EXPECT_EQ(cache.size(), 10000);
+    for (int i = 0; i < 10000; ++i) {
+        const auto* v = cache.peek({i, i * 3});
+        ASSERT_NE(v, nullptr);
+        EXPECT_EQ(*v, i);
+    }
+    EXPECT_FALSE(cache.contains({1, 1}));
+    EXPECT_EQ(cache.stats().evictions, 0);
+}
+
+TEST(LocalDbCache, lru_eviction) {
+    LocalDbCache<uint64_t, int> cache("test", 3);
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+
+    // Using 1 makes 2 the least recently used.
+    ASSERT_NE(cache.find(1), nullptr);
+    cache.put(4, 40);
+    EXPECT_TRUE(cache.contains(1));
+    EXPECT_FALSE(cache.contains(2));
+    EXPECT_TRUE(cache.contains(3));
+    EXPECT_TRUE(cache.contains(4));
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_EQ(cache.stats().evictions, 1);
+
+    // Many evictions leave many tombstones; the table must keep working.
+    for (uint64_t k = 100; k < 1100; ++k) {
+        cache.put(k, static_cast<int>(k));
+    }
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_TRUE(cache.contains(1099));
+    EXPECT_TRUE(cache.contains(1097));
+    EXPECT_FALSE(cache.contains(1096));
+}
+
+TEST(LocalDbCache, preloaded_hits) {
+    LocalDbCache<uint64_t, int> cache("test");
+    cache.preload(1, 10);
+    cache.put(2, 20);
+    ASSERT_NE(cache.find(1), nullptr);
+    ASSERT_NE(cache.find(1), nullptr);
+    ASSERT_NE(cache.find(2), nullptr);
+    EXPECT_EQ(cache.stats().preloaded_hits, 1);
+    EXPECT_EQ(cache.stats().hits, 3);
+}
+
 TEST_F(DbPopTestFix, mark_fully_parsed) {
     auto get_fp = [this] () {
         return m_tx->query_value<bool>("SELECT fully_parsed FROM Log_File WHERE id = $1",